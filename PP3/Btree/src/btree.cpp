@@ -6,6 +6,14 @@
  */
 
 #include "btree.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <queue>
+
 #include "filescan.h"
 #include "exceptions/bad_index_info_exception.h"
 #include "exceptions/bad_opcodes_exception.h"
@@ -15,6 +23,7 @@
 #include "exceptions/index_scan_completed_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/file_io_exception.h"
 
 
 //#define DEBUG
@@ -32,21 +41,25 @@ namespace badgerdb
  * 
  * @param relationName The name of the relation on which to build the index. The 
  * constructor should scan this relation (using FileScan) and insert entries for 
- * all the tuples in this relation into the index. You can insert an entry one-by-one, 
- * i.e., don’t worry about implementing a bottom-up bulkloading index construction 
- * mecha- nism.
+ * all the tuples in this relation into the index. The index is bulk loaded bottom-up 
+ * from the sorted entries, see bulkLoad().
  * @param outIndexName The name of the index file; determine this name in the 
  * constructor as shown above, and return the name.
  * @param bufMgrIn The instance of the global buffer manager.
  * @param attrByteOffset The byte offset of the attribute in the tuple on which to 
  * build the index.
  * @param attrType The data type of the attribute we are indexing.
+ * @param fillFactor The fraction of each node filled when the index is built.
+ * @param sortRunEntries The number of entries sorted in memory at a time when the 
+ * index is built.
  **/
 BTreeIndex::BTreeIndex(const std::string & relationName,
 		std::string & outIndexName,
 		BufMgr *bufMgrIn,
 		const int attrByteOffset,
-		const Datatype attrType)
+		const Datatype attrType,
+		const double fillFactor,
+		const std::size_t sortRunEntries)
 {
 	bufMgr = bufMgrIn;
 	leafOccupancy = INTARRAYLEAFSIZE;
@@ -58,6 +71,11 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
 	std :: ostringstream idxStr ;
 	idxStr << relationName <<  '.' << attrByteOffset ;
 	outIndexName = idxStr.str() ; // indexName is the name of the index file
+
+	if (!(fillFactor > 0 && fillFactor <= 1) || sortRunEntries == 0)
+	{
+		throw BadIndexInfoException(outIndexName);
+	}
 	
 	try 
 	{
@@ -67,60 +85,402 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
 		bufMgr->readPage(file, headerPageNum, metaPage);
     	IndexMetaInfo *meta = (IndexMetaInfo *)metaPage;
 		rootPageNum = meta->rootPageNo;
+		depth = meta->depth;
 
 		//check if match
 		if(relationName != meta->relationName || attrType != meta->attrType 
 			|| attrByteOffset != meta->attrByteOffset) 
 		{
+				bufMgr->unPinPage(file, headerPageNum, false);
+				bufMgr->flushFile(file);
+				delete file;
+				file = NULL;
 				throw BadIndexInfoException(outIndexName);
 	  	}
 
 		bufMgr->unPinPage(file, headerPageNum, false);
 
-	} catch (FileNotFoundException e) 
+	} catch (const FileNotFoundException &e) 
 	{
 		file = new BlobFile(outIndexName, true); //no file exists,then create a file
 		Page *metaPage;
+		bufMgr->allocPage(file, headerPageNum, metaPage);
+		memset((void *)metaPage, 0, Page::SIZE);
 
 		// copy the info to header page
 		IndexMetaInfo *meta = (IndexMetaInfo *)metaPage;
 		relationName.copy(meta->relationName, 20, 0);
   		meta->attrByteOffset = attrByteOffset;
   		meta->attrType = attrType;
-
-		// create root node
-		LeafNodeInt *root;
-		bufMgr->allocPage(file, meta->rootPageNo, (Page *&)root);
-		root->rightSibPageNo = 0;
-		depth = 0;
-		
 		bufMgr->unPinPage(file, headerPageNum, true);
-		bufMgr->unPinPage(file, meta->rootPageNo, true);
 
-		FileScan FileScan(relationName, bufMgr);
-		try 
+		try
 		{
-			RecordId id;
-			while (true)
+			bulkLoad(relationName, outIndexName, fillFactor, sortRunEntries);
+		}
+		catch (...)
+		{
+			// don't leave a half-built index to be opened next time
+			try
 			{
-				FileScan.scanNext(id);
-				std::string rstr = FileScan.getRecord();
-				const char* record = rstr.c_str();
-				int key = *((int*)(record + attrByteOffset));
-				insertEntry(&key + attrByteOffset, id);
+				bufMgr->flushFile(file);
 			}
-			
-		} catch (EndOfFileException e) {}
+			catch (const BadgerDbException &e)
+			{
+			}
+			delete file;
+			File::remove(outIndexName);
+			throw;
+		}
 	}
 	
 }
 
+// -----------------------------------------------------------------------------
+// BTreeIndex::bulkLoad
+// -----------------------------------------------------------------------------
+
+namespace
+{
+
+/**
+ * Reads a sorted run of key-rid pairs back from its temporary file, a block at a time.
+ */
+class SortedRun
+{
+ public:
+	SortedRun(const std::string & name)
+		: name(name), stream(name.c_str(), std::ios::in | std::ios::binary), next(0)
+	{
+		if (!stream)
+		{
+			throw FileIOException(name, errno != 0 ? errno : EIO);
+		}
+		fill();
+	}
+
+	bool done() const { return next == block.size(); }
+
+	const RIDKeyPair<int> & front() const { return block[next]; }
+
+	void pop()
+	{
+		if (++next == block.size())
+		{
+			fill();
+		}
+	}
+
+ private:
+	static const std::size_t BLOCK_ENTRIES = 4096;
+
+	void fill()
+	{
+		block.resize(BLOCK_ENTRIES);
+		stream.read((char *)&block[0], BLOCK_ENTRIES * sizeof(RIDKeyPair<int>));
+		if (stream.bad() || stream.gcount() % sizeof(RIDKeyPair<int>) != 0)
+		{
+			throw FileIOException(name, EIO);
+		}
+		block.resize(stream.gcount() / sizeof(RIDKeyPair<int>));
+		next = 0;
+	}
+
+	const std::string name;
+	std::ifstream stream;
+	std::vector<RIDKeyPair<int> > block;
+	std::size_t next;
+};
+
+/**
+ * Orders the runs of a merge so that the one with the smallest pair is on top of the heap.
+ */
+struct LaterRun
+{
+	bool operator()(const SortedRun *r1, const SortedRun *r2) const
+	{
+		return r2->front() < r1->front();
+	}
+};
+
+/**
+ * Temporary files of the sorted runs of a bulk load, removed when it ends however it ends.
+ */
+class RunFiles
+{
+ public:
+	RunFiles(const std::string & indexName)
+		: indexName(indexName)
+	{
+	}
+
+	~RunFiles()
+	{
+		for (std::size_t i = 0; i < names.size(); i++)
+		{
+			std::remove(names[i].c_str());
+		}
+	}
+
+	/**
+	 * Writes a sorted run to a new file.
+	 */
+	void write(const std::vector<RIDKeyPair<int> > & run)
+	{
+		std::ostringstream name;
+		name << indexName << ".run" << names.size();
+		names.push_back(name.str());
+		std::ofstream out(names.back().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		out.write((const char *)&run[0], run.size() * sizeof(RIDKeyPair<int>));
+		out.close();
+		if (!out)
+		{
+			throw FileIOException(names.back(), errno != 0 ? errno : EIO);
+		}
+	}
+
+	bool empty() const { return names.empty(); }
+
+	std::size_t size() const { return names.size(); }
+
+	const std::string & operator[](const std::size_t i) const { return names[i]; }
+
+ private:
+	const std::string indexName;
+	std::vector<std::string> names;
+};
+
+/**
+ * Fills leaves left to right from key-rid pairs given in order, linking each to the next.
+ */
+class LeafLevelBuilder
+{
+ public:
+	LeafLevelBuilder(BufMgr *bufMgr, File *file, const int entriesPerLeaf)
+		: bufMgr(bufMgr), file(file), entriesPerLeaf(entriesPerLeaf), leaf(NULL), count(0)
+	{
+	}
+
+	~LeafLevelBuilder()
+	{
+		if (leaf != NULL)
+		{
+			// abandoned part way, by an exception
+			bufMgr->unPinPage(file, leaves.back().pageNo, true);
+		}
+	}
+
+	void add(const RIDKeyPair<int> & entry)
+	{
+		if (leaf == NULL || count == entriesPerLeaf)
+		{
+			startLeaf(entry.key);
+		}
+		leaf->keyArray[count] = entry.key;
+		leaf->ridArray[count] = entry.rid;
+		count++;
+	}
+
+	/**
+	 * Unpins the last leaf, and returns the first key and page number of every leaf.
+	 */
+	std::vector<PageKeyPair<int> > & finish()
+	{
+		if (leaf == NULL)
+		{
+			// an empty relation still gets a root, an empty leaf
+			startLeaf(0);
+		}
+		bufMgr->unPinPage(file, leaves.back().pageNo, true);
+		leaf = NULL;
+		return leaves;
+	}
+
+ private:
+	void startLeaf(const int firstKey)
+	{
+		PageId pageNo;
+		Page *page;
+		bufMgr->allocPage(file, pageNo, page);
+		memset((void *)page, 0, Page::SIZE);
+		if (leaf != NULL)
+		{
+			leaf->rightSibPageNo = pageNo;
+			bufMgr->unPinPage(file, leaves.back().pageNo, true);
+		}
+		leaf = (LeafNodeInt *)page;
+		count = 0;
+
+		PageKeyPair<int> first;
+		first.set(pageNo, firstKey);
+		leaves.push_back(first);
+	}
+
+	BufMgr *bufMgr;
+	File *file;
+	const int entriesPerLeaf;
+
+	/**
+	 * Leaf being filled, pinned until the next one is started so its sibling link can be set.
+	 */
+	LeafNodeInt *leaf;
+	int count;
+
+	std::vector<PageKeyPair<int> > leaves;
+};
+
+}
+
+void BTreeIndex::bulkLoad(const std::string & relationName, const std::string & indexName,
+		const double fillFactor, const std::size_t runEntries)
+{
+	// sort the pairs in memory, a run at a time, writing out every run but the last
+	std::vector<RIDKeyPair<int> > run;
+	RunFiles runNames(indexName);
+	{
+		FileScan scan(relationName, bufMgr);
+		RecordBatch batch;
+		const std::size_t keyColumn = batch.addColumn(attrByteOffset, sizeof(int));
+		try
+		{
+			while (true)
+			{
+				scan.scanNextBatch(batch, 1024);
+				const int* keys = batch.columnAs<int>(keyColumn);
+				const RecordId* ids = batch.recordIds();
+				for (std::size_t i = 0; i < batch.size(); i++)
+				{
+					if (run.size() == runEntries)
+					{
+						std::sort(run.begin(), run.end());
+						runNames.write(run);
+						run.clear();
+					}
+					RIDKeyPair<int> entry;
+					entry.set(ids[i], keys[i]);
+					run.push_back(entry);
+				}
+			}
+		} catch (const EndOfFileException &e) {}
+	}
+	std::sort(run.begin(), run.end());
+
+	const int entriesPerLeaf = std::max(1, std::min(leafOccupancy, (int)(leafOccupancy * fillFactor)));
+	LeafLevelBuilder leaves(bufMgr, file, entriesPerLeaf);
+	if (runNames.empty())
+	{
+		for (std::size_t i = 0; i < run.size(); i++)
+		{
+			leaves.add(run[i]);
+		}
+	}
+	else
+	{
+		// merge the runs on disk with the one in memory
+		std::vector<std::unique_ptr<SortedRun> > runs;
+		std::priority_queue<SortedRun *, std::vector<SortedRun *>, LaterRun> heap;
+		for (std::size_t i = 0; i < runNames.size(); i++)
+		{
+			runs.push_back(std::unique_ptr<SortedRun>(new SortedRun(runNames[i])));
+			heap.push(runs.back().get());
+		}
+		std::size_t next = 0;
+		while (!heap.empty() || next < run.size())
+		{
+			if (heap.empty() || (next < run.size() && run[next] < heap.top()->front()))
+			{
+				leaves.add(run[next++]);
+				continue;
+			}
+			SortedRun *smallest = heap.top();
+			heap.pop();
+			leaves.add(smallest->front());
+			smallest->pop();
+			if (!smallest->done())
+			{
+				heap.push(smallest);
+			}
+		}
+	}
+	std::vector<RIDKeyPair<int> >().swap(run);
+
+	rootPageNum = buildNonLeafLevels(leaves.finish(), fillFactor);
+
+	Page *metaPage;
+	bufMgr->readPage(file, headerPageNum, metaPage);
+	((IndexMetaInfo *)metaPage)->rootPageNo = rootPageNum;
+	((IndexMetaInfo *)metaPage)->depth = depth;
+	bufMgr->unPinPage(file, headerPageNum, true);
+
+	// the pages were allocated in order, so they go out in one sequential pass
+	bufMgr->flushFile(file);
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::buildNonLeafLevels
+// -----------------------------------------------------------------------------
+
+PageId BTreeIndex::buildNonLeafLevels(std::vector<PageKeyPair<int> > children, const double fillFactor)
+{
+	const std::size_t fanout = std::max(2, std::min(nodeOccupancy + 1, (int)((nodeOccupancy + 1) * fillFactor)));
+	int level = 1;
+	depth = 0;
+	while (children.size() > 1)
+	{
+		// spread the children evenly, so that the last node isn't left with just one
+		const std::size_t numNodes = (children.size() + fanout - 1) / fanout;
+		std::vector<PageKeyPair<int> > nodes;
+		std::size_t child = 0;
+		for (std::size_t i = 0; i < numNodes; i++)
+		{
+			const std::size_t numChildren = children.size() / numNodes + (i < children.size() % numNodes ? 1 : 0);
+
+			PageId pageNo;
+			Page *page;
+			bufMgr->allocPage(file, pageNo, page);
+			memset((void *)page, 0, Page::SIZE);
+			NonLeafNodeInt *node = (NonLeafNodeInt *)page;
+			node->level = level;
+
+			// the key left of each child but the first is the smallest key under it
+			node->pageNoArray[0] = children[child].pageNo;
+			for (std::size_t j = 1; j < numChildren; j++)
+			{
+				node->keyArray[j - 1] = children[child + j].key;
+				node->pageNoArray[j] = children[child + j].pageNo;
+			}
+
+			PageKeyPair<int> first;
+			first.set(pageNo, children[child].key);
+			nodes.push_back(first);
+			child += numChildren;
+			bufMgr->unPinPage(file, pageNo, true);
+		}
+		children.swap(nodes);
+		level = 0;
+		depth++;
+	}
+	return children[0].pageNo;
+}
+
 // -----------------------------------------------------------------------------
 // BTreeIndex::~BTreeIndex -- destructor
 // -----------------------------------------------------------------------------
 
 BTreeIndex::~BTreeIndex()
 {
+	try
+	{
+		if (scanExecuting)
+		{
+			endScan();
+		}
+		bufMgr->flushFile(file);
+	}
+	catch (const BadgerDbException &e)
+	{
+	}
+	delete file;
 }
 
 // -----------------------------------------------------------------------------
@@ -182,90 +542,65 @@ void BTreeIndex::startScan(const void* lowValParm,
 	bufMgr->readPage(file, rootPageNum, currentPageData);
 	currentPageNum = rootPageNum;
 
-	//if root is a nonleaf
-	if(depth != 1) {
+	//if root is a nonleaf, descend to the leaf which would hold lowValInt
+	for (int level = depth; level > 0; level--)
+	{
 		NonLeafNodeInt* currentNode = (NonLeafNodeInt *) currentPageData;
-		bool isfound = false;
-		while (!isfound)
-		{
-			currentNode = (NonLeafNodeInt *) currentPageData;
-			if(currentNode->level == 1) // found the leaf
-			{
-				isfound = true;
-			}
-			PageId numOfNextPage;
-      		findNextNonleafNode(currentNode, numOfNextPage, lowValInt);
-      		// Unpin
-      		bufMgr->unPinPage(file, currentPageNum, false);
-      		currentPageNum = numOfNextPage;
-      		// read nextPage
-      		bufMgr->readPage(file, currentPageNum, currentPageData);
-		}
-		
+		PageId numOfNextPage;
+		findNextNonleafNode(currentNode, numOfNextPage, lowValInt);
+		// Unpin
+		bufMgr->unPinPage(file, currentPageNum, false);
+		currentPageNum = numOfNextPage;
+		// read nextPage
+		bufMgr->readPage(file, currentPageNum, currentPageData);
 	}
 
-	// current node is leaf, find smallest one
-	bool found = false;
-	while (!found)
+	// current node is leaf, find smallest key in range, which may be in a leaf further right
+	while (true)
 	{
 		LeafNodeInt* currNode = (LeafNodeInt *) currentPageData;
-		if(currNode->ridArray[0].page_number == 0) //check if node is empty
-		{
-			throw NoSuchKeyFoundException();
-		}
-
-		// iterate through the leaf
-		for(int i = 0; i < leafOccupancy; i++)
+		for(int i = 0; i < leafOccupancy && currNode->ridArray[i].page_number != 0; i++)
 		{
 			int key = currNode->keyArray[i];
 			// check key if in the range
 			if(check_key(key)) {
-				found = true;
 				nextEntry = i;
 				scanExecuting = true;
-				break;
-			} else if((highOp == LT and key >= highValInt) || (highOp == LTE and key > highValInt))
-			{
-				throw NoSuchKeyFoundException();
-			}
-
-			//if didn't find matching leaf, go to sibpage
-			if(i == leafOccupancy -1) 
+				return;
+			} else if((highOp == LT && key >= highValInt) || (highOp == LTE && key > highValInt))
 			{
 				bufMgr->unPinPage(file, currentPageNum, false);
-				if(currNode->rightSibPageNo == 0)
-				{
-					throw NoSuchKeyFoundException();
-				}
-				currentPageNum = currNode->rightSibPageNo;
-				bufMgr->readPage(file, currentPageNum, currentPageData);
+				throw NoSuchKeyFoundException();
 			}
-			
 		}
 
+		//if didn't find matching leaf, go to sibpage
+		bufMgr->unPinPage(file, currentPageNum, false);
+		if(currNode->rightSibPageNo == 0)
+		{
+			throw NoSuchKeyFoundException();
+		}
+		currentPageNum = currNode->rightSibPageNo;
+		bufMgr->readPage(file, currentPageNum, currentPageData);
 	}
 }
 
 /**
  * Helper: find the next non-leaf node
  **/
-const void BTreeIndex::findNextNonleafNode(NonLeafNodeInt *currentPage, PageId &nextPageId, int key)
+void BTreeIndex::findNextNonleafNode(NonLeafNodeInt *currentPage, PageId &nextPageId, int key)
 {
-	int nodeOccu = nodeOccupancy;
-	while (nodeOccu > 0 && currentPage->pageNoArray[nodeOccu-1] >= key)
-	{
-		nodeOccu--;
-	}
-	while (nodeOccu >= 0 && currentPage->pageNoArray[nodeOccu] == 0)
+	// the keys in use are those left of each child but the first
+	int i = 0;
+	while (i < nodeOccupancy && currentPage->pageNoArray[i + 1] != 0 && currentPage->keyArray[i] < key)
 	{
-		nodeOccu--;
+		i++;
 	}
-	
-	nextPageId = currentPage->pageNoArray[nodeOccu];
+	nextPageId = currentPage->pageNoArray[i];
 }
 
 // helper function for scanNext, used to check if a key is in required range
-const bool BTreeIndex::check_key(int key)
+bool BTreeIndex::check_key(int key)
 {
     if (lowOp == GT && key <= lowValInt)
     {
@@ -305,51 +640,39 @@ const bool BTreeIndex::check_key(int key)
 void BTreeIndex::scanNext(RecordId& outRid) 
 {
     // check if scan has been initialized
-    if (scanExecuting)
+    if (!scanExecuting)
     {
-        // to read this page, cast it to leaf node struct
-        LeafNodeInt* curr = (LeafNodeInt*)currentPageData;
-        // fetch next key and Rid, inc nextEntry
-        int key = curr->keyArray[nextEntry];
-        if (check_key(key) == false)
+        throw ScanNotInitializedException();
+    }
+
+    // to read this page, cast it to leaf node struct
+    LeafNodeInt* curr = (LeafNodeInt*)currentPageData;
+    // check if current page has been scanned to its entirety
+    // leafOccupancy: Number of keys in leaf node, depending upon the type of key.
+    if (nextEntry >= leafOccupancy || curr->ridArray[nextEntry].page_number == 0)
+    {
+        // if there's no more sibling, ie. records, throw exception
+        if (curr->rightSibPageNo == 0)
         {
             throw IndexScanCompletedException();
         }
-        outRid = curr->ridArray[nextEntry];
-        nextEntry = nextEntry + 1;
-        // check if current page has been scanned to its entirety
-        // page_number: Number of page containing this record.
-        // leafOccupancy: Number of keys in leaf node, depending upon the type of key.
-        if (outRid.page_number == 0 || nextEntry >= leafOccupancy)
-        {
-            // if there's no more sibling, ie. records, throw exception
-            if (curr->rightSibPageNo == 0)
-            {
-                throw IndexScanCompletedException();
-            }
-            
-            // otherwise, unpin current page and read right sibling page
-            bufMgr->unPinPage(file,currentPageNum,false);
-            currentPageNum = curr->rightSibPageNo;
-            bufMgr->readPage(file,currentPageNum,currentPageData);
-            LeafNodeInt* curr = (LeafNodeInt*)currentPageData;
-            
-            // reset nextEntry index to zero, and fetch key and Rid again
-            nextEntry = 0;
-            key = curr->keyArray[nextEntry];
-            if (check_key(key) == false)
-            {
-                throw IndexScanCompletedException();
-            }
-            outRid = curr->ridArray[nextEntry];
-            nextEntry = nextEntry + 1;
-        }
+
+        // otherwise, unpin current page and read right sibling page, which
+        // is never empty
+        bufMgr->unPinPage(file, currentPageNum, false);
+        currentPageNum = curr->rightSibPageNo;
+        bufMgr->readPage(file, currentPageNum, currentPageData);
+        curr = (LeafNodeInt*)currentPageData;
+        nextEntry = 0;
     }
-    else
+
+    // fetch next key and Rid, inc nextEntry
+    if (check_key(curr->keyArray[nextEntry]) == false)
     {
-        // scan not initialized, throw exception
-        throw ScanNotInitializedException();
+        throw IndexScanCompletedException();
     }
+    outRid = curr->ridArray[nextEntry];
+    nextEntry = nextEntry + 1;
 }
 
 // -----------------------------------------------------------------------------
@@ -11,6 +11,7 @@
 #include <string>
 #include "string.h"
 #include <sstream>
+#include <vector>
 
 #include "types.h"
 #include "page.h"
@@ -54,6 +55,19 @@ const  int INTARRAYLEAFSIZE = ( Page::SIZE - sizeof( PageId ) ) / ( sizeof( int
 //                                                     level     extra pageNo                  key       pageNo
 const  int INTARRAYNONLEAFSIZE = ( Page::SIZE - sizeof( int ) - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( PageId ) );
 
+/**
+ * @brief Fraction of each node filled when an index is built from its relation. Below 1, the
+ * remainder is left free, which only makes the index larger while insertEntry() is not
+ * implemented.
+ */
+const double BULK_LOAD_FILL_FACTOR = 1.0;
+
+/**
+ * @brief Number of key-rid pairs sorted in memory at a time while an index is built, by default.
+ * A relation with more records is sorted in runs of this many, written to temporary files and merged.
+ */
+const std::size_t BULK_LOAD_RUN_ENTRIES = 1 << 22;
+
 /**
  * @brief Structure to store a key-rid pair. It is used to pass the pair to functions that 
  * add to or make changes to the leaf node pages of the tree. Is templated for the key member.
@@ -128,6 +142,11 @@ struct IndexMetaInfo{
    * Page number of root page of the B+ Tree inside the file index file.
    */
 	PageId rootPageNo;
+
+  /**
+   * Number of levels of non-leaf nodes in the tree, 0 while the root is a leaf.
+   */
+	int depth;
 };
 
 /*
@@ -228,6 +247,52 @@ class BTreeIndex {
    */
 	int			nodeOccupancy;
 
+  /**
+   * Number of levels of non-leaf nodes in the tree, 0 while the root is a leaf.
+   */
+	int			depth;
+
+  /**
+   * Builds the tree bottom-up from the base relation. The key-rid pairs of its records are
+   * sorted, the leaves are filled from them left to right, and each level of non-leaf nodes is
+   * then built over the one below, so the pages are allocated in order and written once.
+   *
+   * @param relationName        Name of the base relation.
+   * @param indexName           Name of the index file, which names any temporary files.
+   * @param fillFactor          Fraction of each node to fill, in (0, 1].
+   * @param runEntries          Number of key-rid pairs to sort in memory at a time.
+   * @throws  FileIOException   If a temporary file can't be written or read back.
+   */
+	void bulkLoad(const std::string & relationName, const std::string & indexName,
+						const double fillFactor, const std::size_t runEntries);
+
+  /**
+   * Builds the non-leaf levels of the tree over a level of nodes, one level at a time, and sets
+   * depth to the number built.
+   *
+   * @param children            First key and page number of each node of the level, in order.
+   * @param fillFactor          Fraction of each node to fill, in (0, 1].
+   * @return  Page number of the root.
+   */
+	PageId buildNonLeafLevels(std::vector<PageKeyPair<int> > children, const double fillFactor);
+
+  /**
+   * Finds the child of a non-leaf node to descend to in search of a key. A key equal to a
+   * separator goes to the child left of it, since equal keys may continue into it.
+   *
+   * @param currentPage         Non-leaf node to search.
+   * @param nextPageId          Returns the page number of the child.
+   * @param key                 Key searched for.
+   */
+	void findNextNonleafNode(NonLeafNodeInt *currentPage, PageId &nextPageId, int key);
+
+  /**
+   * Returns true if a key is in the range of the current scan.
+   *
+   * @param key                 Key to test.
+   */
+	bool check_key(int key);
+
 
 	// MEMBERS SPECIFIC TO SCANNING
 
@@ -304,10 +369,15 @@ class BTreeIndex {
    * @param bufMgrIn						Buffer Manager Instance
    * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
    * @param attrType						Datatype of attribute over which index is built
+   * @param fillFactor					Fraction of each node filled when the index is built, in (0, 1]
+   * @param sortRunEntries			Number of key-rid pairs sorted in memory at a time when the index is built
    * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
+   * @throws  BadIndexInfoException     If fillFactor is out of range or sortRunEntries is 0.
    */
 	BTreeIndex(const std::string & relationName, std::string & outIndexName,
-						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType);
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType,
+						const double fillFactor = BULK_LOAD_FILL_FACTOR,
+						const std::size_t sortRunEntries = BULK_LOAD_RUN_ENTRIES);
 	
 
   /**
@@ -5,14 +5,21 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <cstdlib>
 #include <memory>
+#include <new>
 #include <iostream>
+#include <vector>
 #include "buffer.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/bad_buffer_exception.h"
 #include "exceptions/hash_not_found_exception.h"
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/read_only_file_exception.h"
 
 namespace badgerdb { 
 
@@ -30,29 +37,48 @@ BufMgr::BufMgr(std::uint32_t bufs)
   	bufDescTable[i].valid = false;
   }
 
-  bufPool = new Page[bufs];
+  void* pool;
+  if (posix_memalign(&pool, File::DIRECT_IO_ALIGNMENT, bufs * sizeof(Page)) != 0)
+  {
+    throw std::bad_alloc();
+  }
+  bufPool = static_cast<Page*>(pool);
+  for (FrameId i = 0; i < bufs; i++)
+  {
+    new (&bufPool[i]) Page();
+  }
 
   int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
   hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
 
   clockHand = bufs - 1;
+
+  ioEngine = new IoEngine(IoEngine::DEFAULT_QUEUE_DEPTH);
 }
 
 
 BufMgr::~BufMgr() {
   //Flush out all unwritten pages
+  std::vector<FrameId> frames;
   for (std::uint32_t i = 0; i < numBufs; i++) 
   {
   	BufDesc* tmpbuf = &(bufDescTable[i]);
   	if (tmpbuf->valid == true && tmpbuf->dirty == true)
 		{
-			tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
+			tmpbuf->file->writePageAsync(*ioEngine, tmpbuf->pageNo, &bufPool[i]);
+			frames.push_back(i);
   	}
   }
+	completeWrites(frames);
 
+	delete ioEngine;
 	delete hashTable;
   delete [] bufDescTable;
-  delete [] bufPool;
+  for (std::uint32_t i = 0; i < numBufs; i++)
+  {
+    bufPool[i].~Page();
+  }
+  std::free(bufPool);
 }
 
 void BufMgr::allocBuf(FrameId & frame) 
@@ -120,6 +146,12 @@ void BufMgr::allocBuf(FrameId & frame)
 	
 void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 {
+  // pages of mapped files can't be changed
+  if (file->isMapped())
+  {
+    throw ReadOnlyFileException(file->filename());
+  }
+
   // check to see if it is already in the buffer pool
   // std::cout << "readPage called on file.page " << file << "." << pageNo << endl;
   FrameId frameNo = 0;
@@ -139,8 +171,7 @@ void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 
     // read the page into the new frame
     bufStats.diskreads++;
-    //status = file->readPage(pageNo, &bufPool[frameNo]);
-    bufPool[frameNo] = file->readPage(pageNo);
+    file->readPageInto(pageNo, bufPool[frameNo]);
 
     // set up the entry properly
     bufDescTable[frameNo].Set(file, pageNo);
@@ -152,8 +183,143 @@ void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 }
 
 
+void BufMgr::readPage(File* file, const PageId pageNo, const Page*& page)
+{
+	// mapped files are used in place, bypassing the buffer pool
+	if (file->isMapped())
+	{
+		page = file->mappedPage(pageNo);
+		return;
+	}
+
+	Page* framePage;
+	readPage(file, pageNo, framePage);
+	page = framePage;
+}
+
+void BufMgr::readPages(File* file, const std::vector<PageId>& pageNos, std::vector<Page*>& pages)
+{
+	// pages of mapped files can't be changed
+	if (file->isMapped())
+	{
+		throw ReadOnlyFileException(file->filename());
+	}
+
+	pages.assign(pageNos.size(), NULL);
+
+	// Frames pinned so far, and which of them are still to be read.
+	std::vector<FrameId> pinned;
+	std::vector<std::size_t> misses;
+	try
+	{
+		for (std::size_t i = 0; i < pageNos.size(); i++)
+		{
+			FrameId frameNo = 0;
+			try
+			{
+				hashTable->lookup(file, pageNos[i], frameNo);
+				bufDescTable[frameNo].refbit = true;
+				bufDescTable[frameNo].pinCnt++;
+			}
+			catch(const HashNotFoundException &e)
+			{
+				allocBuf(frameNo);
+				// Pinned and in the page table straight away, so that allocBuf does not hand the frame out again
+				// and a repeated page number finds it.
+				bufDescTable[frameNo].Set(file, pageNos[i]);
+				hashTable->insert(file, pageNos[i], frameNo);
+				misses.push_back(i);
+			}
+			pinned.push_back(frameNo);
+			pages[i] = &bufPool[frameNo];
+		}
+
+		// Read each run of consecutive page numbers with one request.
+		std::vector<Page*> run;
+		for (std::size_t i = 0; i < misses.size(); )
+		{
+			std::size_t j = i + 1;
+			while (j < misses.size() && pageNos[misses[j]] == pageNos[misses[j - 1]] + 1)
+			{
+				j++;
+			}
+			run.clear();
+			for (std::size_t k = i; k < j; k++)
+			{
+				run.push_back(pages[misses[k]]);
+			}
+			file->readPagesInto(pageNos[misses[i]], run);
+			bufStats.diskreads += j - i;
+			i = j;
+		}
+	}
+	catch(...)
+	{
+		// Release every pin taken, then drop the frames which were to be read.
+		for (std::size_t i = 0; i < pinned.size(); i++)
+		{
+			bufDescTable[pinned[i]].pinCnt--;
+		}
+		for (std::size_t i = 0; i < misses.size(); i++)
+		{
+			hashTable->remove(file, pageNos[misses[i]]);
+			bufDescTable[pinned[misses[i]]].Clear();
+		}
+		pages.clear();
+		throw;
+	}
+}
+
+void BufMgr::readPages(File* file, const std::vector<PageId>& pageNos, std::vector<const Page*>& pages)
+{
+	// mapped files are used in place, bypassing the buffer pool
+	if (file->isMapped())
+	{
+		pages.assign(pageNos.size(), NULL);
+		for (std::size_t i = 0; i < pageNos.size(); i++)
+		{
+			pages[i] = file->mappedPage(pageNos[i]);
+		}
+		return;
+	}
+
+	std::vector<Page*> framePages;
+	readPages(file, pageNos, framePages);
+	pages.assign(framePages.begin(), framePages.end());
+}
+
+void BufMgr::readPages(File* file, const PageId firstPageNo, const std::uint32_t numPages, std::vector<Page*>& pages)
+{
+	std::vector<PageId> pageNos(numPages);
+	for (std::uint32_t i = 0; i < numPages; i++)
+	{
+		pageNos[i] = firstPageNo + i;
+	}
+	readPages(file, pageNos, pages);
+}
+
 void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty) 
 {
+  releasePage(file, pageNo, dirty);
+
+  // let the file see the change before the page is written back
+  if (dirty)
+  {
+    FrameId frameNo = 0;
+    hashTable->lookup(file, pageNo, frameNo);
+    file->pageChanged(pageNo, bufPool[frameNo]);
+  }
+}
+
+void BufMgr::releasePage(File* file, const PageId pageNo, const bool dirty)
+{
+  // pages of mapped files are never pinned
+  if (file->isMapped())
+  {
+    if (dirty) throw ReadOnlyFileException(file->filename());
+    return;
+  }
+
   // lookup in hashtable
   FrameId frameNo = 0;
   hashTable->lookup(file, pageNo, frameNo);
@@ -189,6 +355,7 @@ void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page)
 
 void BufMgr::flushFile(const File* file) 
 {
+  std::vector<FrameId> frames;
   for (std::uint32_t i = 0; i < numBufs; i++)
 	{
   	BufDesc* tmpbuf = &(bufDescTable[i]);
@@ -197,19 +364,218 @@ void BufMgr::flushFile(const File* file)
 	    if (tmpbuf->pinCnt > 0)
   			throw PagePinnedException(file->filename(), tmpbuf->pageNo, tmpbuf->frameNo);
 
-	    if (tmpbuf->dirty == true)
-			{
-				//if ((status = tmpbuf->file->writePage(tmpbuf->pageNo, &(bufPool[i]))) != OK)
-				tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
-				tmpbuf->dirty = false;
-    	}
-
-    	hashTable->remove(file,tmpbuf->pageNo);
-    	tmpbuf->Clear();
+	    frames.push_back(i);
   	}
 		else if (tmpbuf->valid == false && tmpbuf->file == file)
   		throw BadBufferException(tmpbuf->frameNo, tmpbuf->dirty, tmpbuf->valid, tmpbuf->refbit);
   }
+
+	// Queue all the dirty pages first so that their writes are in flight together.
+	std::vector<FrameId> written;
+	try
+	{
+		for (std::size_t i = 0; i < frames.size(); i++)
+		{
+			BufDesc* tmpbuf = &(bufDescTable[frames[i]]);
+			if (tmpbuf->dirty == true)
+			{
+				tmpbuf->file->writePageAsync(*ioEngine, tmpbuf->pageNo, &bufPool[frames[i]]);
+				written.push_back(frames[i]);
+			}
+		}
+	}
+	catch(...)
+	{
+		abandonWrites(written);
+		throw;
+	}
+	completeWrites(written);
+
+	for (std::size_t i = 0; i < frames.size(); i++)
+	{
+  	BufDesc* tmpbuf = &(bufDescTable[frames[i]]);
+		tmpbuf->dirty = false;
+  	hashTable->remove(file,tmpbuf->pageNo);
+  	tmpbuf->Clear();
+	}
+}
+
+std::uint32_t BufMgr::writeFile(const File* file)
+{
+	std::vector<FrameId> frames;
+	try
+	{
+		for (std::uint32_t i = 0; i < numBufs; i++)
+		{
+			BufDesc* tmpbuf = &(bufDescTable[i]);
+			if (tmpbuf->valid == true && tmpbuf->file == file && tmpbuf->dirty == true && tmpbuf->pinCnt == 0)
+			{
+				tmpbuf->file->writePageAsync(*ioEngine, tmpbuf->pageNo, &bufPool[i]);
+				frames.push_back(i);
+			}
+		}
+	}
+	catch(...)
+	{
+		abandonWrites(frames);
+		throw;
+	}
+	completeWrites(frames);
+
+	for (std::size_t i = 0; i < frames.size(); i++)
+	{
+		bufDescTable[frames[i]].dirty = false;
+		bufStats.diskwrites++;
+	}
+	return frames.size();
+}
+
+void BufMgr::syncFile(const File* file)
+{
+	for (std::uint32_t i = 0; i < numBufs; i++)
+	{
+		BufDesc* tmpbuf = &(bufDescTable[i]);
+		if (tmpbuf->valid == true && tmpbuf->file == file && tmpbuf->dirty == true && tmpbuf->pinCnt > 0)
+			throw PagePinnedException(file->filename(), tmpbuf->pageNo, tmpbuf->frameNo);
+	}
+	writeFile(file);
+}
+
+void BufMgr::prefetch(File* file, const PageId firstPageNo, const std::uint32_t numPages)
+{
+	if (file->isMapped())
+	{
+		return;		// the kernel reads mapped files ahead itself
+	}
+
+	std::vector<FrameId> frames;
+	try
+	{
+		for (PageId pageNo = firstPageNo; pageNo - firstPageNo < numPages; pageNo++)
+		{
+			FrameId frameNo = 0;
+			try
+			{
+				hashTable->lookup(file, pageNo, frameNo);
+				continue;		// already in the buffer pool
+			}
+			catch(const HashNotFoundException &e)
+			{
+			}
+
+			try
+			{
+				allocBuf(frameNo);
+			}
+			catch(const BufferExceededException &e)
+			{
+				break;		// every frame is pinned; prefetch what we have
+			}
+
+			// Keep the frame pinned while the read is in flight so that allocBuf does not hand it out again.
+			bufDescTable[frameNo].Set(file, pageNo);
+			hashTable->insert(file, pageNo, frameNo);
+			try
+			{
+				file->readPageAsync(*ioEngine, pageNo, &bufPool[frameNo]);
+			}
+			catch(const InvalidPageException &e)
+			{
+				// Past the end of the file.
+				hashTable->remove(file, pageNo);
+				bufDescTable[frameNo].Clear();
+				break;
+			}
+			frames.push_back(frameNo);
+			bufStats.diskreads++;
+		}
+		ioEngine->drain();
+	}
+	catch(...)
+	{
+		for (std::size_t i = 0; i < frames.size(); i++)
+		{
+			hashTable->remove(file, bufDescTable[frames[i]].pageNo);
+			bufDescTable[frames[i]].Clear();
+		}
+		throw;
+	}
+
+	for (std::size_t i = 0; i < frames.size(); i++)
+	{
+		BufDesc* tmpbuf = &(bufDescTable[frames[i]]);
+		if (file->checkPage(tmpbuf->pageNo, bufPool[frames[i]]))
+		{
+			tmpbuf->pinCnt = 0;
+		}
+		else
+		{
+			hashTable->remove(file, tmpbuf->pageNo);
+			tmpbuf->Clear();
+		}
+	}
+}
+
+std::uint32_t BufMgr::writeBack(const std::uint32_t numFrames)
+{
+	std::vector<FrameId> frames;
+	FrameId frameNo = clockHand;
+	try
+	{
+		for (std::uint32_t i = 0; i < numFrames && i < numBufs; i++)
+		{
+			frameNo = (frameNo + 1) % numBufs;
+			BufDesc* tmpbuf = &(bufDescTable[frameNo]);
+			if (tmpbuf->valid == true && tmpbuf->dirty == true && tmpbuf->pinCnt == 0)
+			{
+				tmpbuf->file->writePageAsync(*ioEngine, tmpbuf->pageNo, &bufPool[frameNo]);
+				frames.push_back(frameNo);
+			}
+		}
+	}
+	catch(...)
+	{
+		abandonWrites(frames);
+		throw;
+	}
+	completeWrites(frames);
+
+	for (std::size_t i = 0; i < frames.size(); i++)
+	{
+		bufDescTable[frames[i]].dirty = false;
+		bufStats.diskwrites++;
+	}
+	return frames.size();
+}
+
+void BufMgr::completeWrites(const std::vector<FrameId>& frames)
+{
+	ioEngine->drain();
+
+	// Let each file write out what the writes changed, once per file.
+	std::vector<File*> files;
+	for (std::size_t i = 0; i < frames.size(); i++)
+	{
+		File* file = bufDescTable[frames[i]].file;
+		if (std::find(files.begin(), files.end(), file) == files.end())
+		{
+			files.push_back(file);
+			file->finishWrites();
+		}
+	}
+}
+
+void BufMgr::abandonWrites(const std::vector<FrameId>& frames)
+{
+	// The writes already queued point into the frames, so they must not outlive the call.  Their pages stay
+	// dirty and are written again later; the exception on its way out is the one to report.
+	try
+	{
+		completeWrites(frames);
+	}
+	catch(...)
+	{
+	}
 }
 
 void BufMgr::disposePage(File* file, const PageId pageNo)
@@ -228,6 +594,274 @@ void BufMgr::disposePage(File* file, const PageId pageNo)
   file->deletePage(pageNo);
 }
 
+RecordId BufMgr::placeRecord(PageFile* file, const std::string& data)
+{
+	// The page directory may be behind a page which is still pinned, so check the page it suggests.
+	PageId pageNo = file->findPageWithSpace(data.length() + sizeof(PageSlot));
+	Page* page = NULL;
+	if (pageNo != Page::INVALID_NUMBER)
+	{
+		readPage(file, pageNo, page);
+		if (!page->hasSpaceForRecord(data))
+		{
+			unPinPage(file, pageNo, false);
+			page = NULL;
+		}
+	}
+	if (page == NULL)
+		allocPage(file, pageNo, page);
+
+	RecordId rid;
+	try
+	{
+		rid = page->insertRecord(data);
+	}
+	catch (...)
+	{
+		unPinPage(file, pageNo, false);
+		throw;
+	}
+	file->recordChanged(pageNo, *page, NULL, &data);
+	releasePage(file, pageNo, true);
+	return rid;
+}
+
+RecordId BufMgr::insertRecord(PageFile* file, const std::string& data)
+{
+	// Long attributes go out of line first, and are freed again if the record can't be inserted.
+	const std::string record = file->storeOverflow(data);
+	try
+	{
+		return placeRecord(file, record);
+	}
+	catch (...)
+	{
+		file->freeOverflow(record, &data);
+		throw;
+	}
+}
+
+std::string BufMgr::readRecord(PageFile* file, const RecordId& rid)
+{
+	const Page* page;
+	readPage(file, rid.page_number, page);
+	RecordId location = rid;
+	try
+	{
+		if (page->isForwarded(rid))
+			location = page->getForwardingAddress(rid);
+	}
+	catch (...)
+	{
+		unPinPage(file, rid.page_number, false);
+		throw;
+	}
+	if (location != rid)
+	{
+		unPinPage(file, rid.page_number, false);
+		readPage(file, location.page_number, page);
+	}
+
+	std::string record;
+	try
+	{
+		record = page->getRecord(location);
+	}
+	catch (...)
+	{
+		unPinPage(file, location.page_number, false);
+		throw;
+	}
+	unPinPage(file, location.page_number, false);
+	return record;
+}
+
+void BufMgr::updateRecord(PageFile* file, const RecordId& rid, const std::string& data)
+{
+	if (file->overflowFile() == NULL)
+	{
+		replaceRecord(file, rid, data);
+		return;
+	}
+	// The old version tells which out-of-line values are no longer held once the new one is stored.
+	const std::string oldRecord = readRecord(file, rid);
+	const std::string record = file->storeOverflow(data);
+	try
+	{
+		replaceRecord(file, rid, record);
+	}
+	catch (...)
+	{
+		file->freeOverflow(record, &data);
+		throw;
+	}
+	file->freeOverflow(oldRecord, &record);
+}
+
+void BufMgr::replaceRecord(PageFile* file, const RecordId& rid, const std::string& data)
+{
+	Page* home;
+	readPage(file, rid.page_number, home);
+	try
+	{
+		RecordId oldLocation = rid;
+		std::string oldRecord;
+		if (home->isForwarded(rid))
+		{
+			oldLocation = home->getForwardingAddress(rid);
+		}
+		else
+		{
+			oldRecord = home->getRecord(rid);
+			try
+			{
+				home->updateRecord(rid, data);
+				file->recordChanged(rid.page_number, *home, &oldRecord, &data);
+				releasePage(file, rid.page_number, true);
+				return;
+			}
+			catch (InsufficientSpaceException&)
+			{
+				// Move it to another page below.
+			}
+		}
+
+		const Page empty_page;
+		if (!empty_page.hasSpaceForMovedRecord(data))
+			throw InsufficientSpaceException(Page::INVALID_NUMBER, data.length(), empty_page.getFreeSpace());
+
+		if (oldLocation != rid)
+		{
+			// Update the record where it is if it still fits there.
+			Page* page;
+			readPage(file, oldLocation.page_number, page);
+			bool updated = true;
+			try
+			{
+				const std::string movedRecord = page->getRecord(oldLocation);
+				try
+				{
+					page->updateRecord(oldLocation, data);
+					file->recordChanged(oldLocation.page_number, *page, &movedRecord, &data);
+				}
+				catch (InsufficientSpaceException&)
+				{
+					updated = false;
+				}
+			}
+			catch (...)
+			{
+				unPinPage(file, oldLocation.page_number, false);
+				throw;
+			}
+			releasePage(file, oldLocation.page_number, updated);
+			if (updated)
+			{
+				unPinPage(file, rid.page_number, false);
+				return;
+			}
+		}
+
+		// Copy the record to its new location and point the stub there before taking it off the page it moved
+		// to last, so that it is never lost if either step fails.  The stub keeps pointing straight at the
+		// record rather than forwarding twice.
+		const RecordId location = moveRecord(file, rid, data);
+		try
+		{
+			home->forwardRecord(rid, location);
+		}
+		catch (...)
+		{
+			removeRecord(file, location);
+			throw;
+		}
+		if (oldLocation != rid)
+		{
+			removeRecord(file, oldLocation);
+		}
+		file->recordChanged(rid.page_number, *home, oldLocation == rid ? &oldRecord : NULL, NULL);
+	}
+	catch (...)
+	{
+		unPinPage(file, rid.page_number, true);
+		throw;
+	}
+	releasePage(file, rid.page_number, true);
+}
+
+void BufMgr::deleteRecord(PageFile* file, const RecordId& rid)
+{
+	if (file->overflowFile() == NULL)
+	{
+		removeRecord(file, rid);
+		return;
+	}
+	const std::string record = readRecord(file, rid);
+	removeRecord(file, rid);
+	file->freeOverflow(record, NULL);
+}
+
+void BufMgr::removeRecord(PageFile* file, const RecordId& rid)
+{
+	Page* page;
+	readPage(file, rid.page_number, page);
+	try
+	{
+		// a stub takes no record off the page
+		std::string record;
+		const bool forwarded = page->isForwarded(rid);
+		if (forwarded)
+		{
+			const RecordId location = page->getForwardingAddress(rid);
+			removeRecord(file, location);
+		}
+		else
+		{
+			record = page->getRecord(rid);
+		}
+		page->deleteRecord(rid);
+		file->recordChanged(rid.page_number, *page, forwarded ? NULL : &record, NULL);
+	}
+	catch (...)
+	{
+		unPinPage(file, rid.page_number, true);
+		throw;
+	}
+	releasePage(file, rid.page_number, true);
+}
+
+RecordId BufMgr::moveRecord(PageFile* file, const RecordId& homeRid, const std::string& data)
+{
+	// The page directory may be behind a page which is still pinned, so check the page it suggests.
+	PageId pageNo = file->findPageWithSpace(data.length() + sizeof(RecordId) + sizeof(PageSlot));
+	Page* page = NULL;
+	if (pageNo != Page::INVALID_NUMBER && pageNo != homeRid.page_number)
+	{
+		readPage(file, pageNo, page);
+		if (!page->hasSpaceForMovedRecord(data))
+		{
+			unPinPage(file, pageNo, false);
+			page = NULL;
+		}
+	}
+	if (page == NULL)
+		allocPage(file, pageNo, page);
+
+	RecordId location;
+	try
+	{
+		location = page->insertMovedRecord(homeRid, data);
+	}
+	catch (...)
+	{
+		unPinPage(file, pageNo, false);
+		throw;
+	}
+	file->recordChanged(pageNo, *page, NULL, &data);
+	releasePage(file, pageNo, true);
+	return location;
+}
+
 void BufMgr::printSelf(void) 
 {
   BufDesc* tmpbuf;
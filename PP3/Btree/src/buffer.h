@@ -9,6 +9,7 @@
 
 #include "file.h"
 #include "bufHashTbl.h"
+#include "io_engine.h"
 #include <iostream>
 
 namespace badgerdb {
@@ -186,6 +187,11 @@ class BufMgr
 	 */
   BufStats bufStats;
 
+	/**
+   * Engine used to keep batches of page reads and writes in flight together
+	 */
+  IoEngine *ioEngine;
+
 	/**
    * Advance clock to next frame in the buffer pool
 	 */
@@ -202,9 +208,66 @@ class BufMgr
 	 */
   void allocBuf(FrameId & frame);
 
+	/**
+	 * Unpins a page without telling its file that it changed, for callers which report the change
+	 * themselves.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number
+	 * @param dirty		True if the page to be unpinned needs to be marked dirty
+	 * @throws  PageNotPinnedException If the page is not already pinned
+	 * @throws  ReadOnlyFileException If the file is memory-mapped and dirty is true
+	 */
+  void releasePage(File* file, const PageId pageNo, const bool dirty);
+
+	/**
+	 * Waits for the writes queued for the given frames, then lets each of their files finish them.
+	 *
+	 * @param frames  Frames whose pages were queued with writePageAsync
+   * @throws FileIOException If the operating system reports an error while writing
+	 */
+  void completeWrites(const std::vector<FrameId>& frames);
+
+	/**
+	 * Completes the writes queued for the given frames as completeWrites() does when an exception is
+	 * already leaving the caller, so that no request on the shared I/O engine outlives it.  Any further
+	 * error is dropped in favour of the first.
+	 *
+	 * @param frames  Frames whose pages were queued with writePageAsync
+	 */
+  void abandonWrites(const std::vector<FrameId>& frames);
+
+	/**
+	 * Inserts a record which is moving off its home page into another page of the file with room for
+	 * it, or into a new page.
+	 *
+	 * @param file   	File object
+	 * @param homeRid  ID the record keeps
+	 * @param data  	Bytes that compose the record
+	 * @return  ID of the record's new location
+	 */
+  RecordId moveRecord(PageFile* file, const RecordId& homeRid, const std::string& data);
+
+	/**
+	 * Inserts a record as insertRecord() does, as stored, without going through the overflow file.
+	 */
+  RecordId placeRecord(PageFile* file, const std::string& data);
+
+	/**
+	 * Updates a record as updateRecord() does, as stored, without going through the overflow file.
+	 */
+  void replaceRecord(PageFile* file, const RecordId& rid, const std::string& data);
+
+	/**
+	 * Deletes a record as deleteRecord() does, leaving the values it holds in the overflow file.
+	 */
+  void removeRecord(PageFile* file, const RecordId& rid);
+
  public:
 	/**
-   * Actual buffer pool from which frames are allocated
+   * Actual buffer pool from which frames are allocated.  Frames are aligned to
+   * File::DIRECT_IO_ALIGNMENT so that files opened for direct I/O can read and
+   * write them in place.
 	 */
   Page* bufPool;
 
@@ -226,9 +289,59 @@ class BufMgr
 	 * @param file   	File object
 	 * @param PageNo  Page number in the file to be read
 	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+	 * @throws ReadOnlyFileException If the file is memory-mapped; its pages can only be read through the overload
+	 *                               taking a const page pointer
 	 */
   void readPage(File* file, const PageId PageNo, Page*& page);
 
+	/**
+	 * Reads the given page for reading only, as readPage() does for changing it.  For memory-mapped files
+	 * (File::isMapped()) no frame is used: the pointer returned points into the mapping.  The page is
+	 * unpinned with unPinPage() either way.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param page  	Reference to page pointer. Used to fetch the page.
+	 */
+  void readPage(File* file, const PageId PageNo, const Page*& page);
+
+	/**
+	 * Reads the given pages of the file into the buffer pool and pins them all, as readPage() would one by one.
+	 * The page table is probed once per page; pages not in the buffer pool are grouped into runs of consecutive
+	 * page numbers and each run is read with a single vectored read straight into its frames.
+	 * If any page can't be read, no page is left pinned.
+	 *
+	 * @param file   	File object
+	 * @param pageNos  Numbers of pages to read; a page may appear more than once, and is then pinned once per appearance
+	 * @param pages  	Receives a pointer to each page, in the order of pageNos
+	 * @throws BufferExceededException If there are not enough unpinned frames for all the pages
+	 * @throws InvalidPageException If any page doesn't exist in the file or is not currently used
+	 * @throws ReadOnlyFileException If the file is memory-mapped; its pages can only be read through the overload
+	 *                               taking const page pointers
+	 */
+  void readPages(File* file, const std::vector<PageId>& pageNos, std::vector<Page*>& pages);
+
+	/**
+	 * Reads the given pages for reading only, as readPages() does for changing them.  For memory-mapped files
+	 * (File::isMapped()) no frames are used: the pointers returned point into the mapping.
+	 *
+	 * @param file   	File object
+	 * @param pageNos  Numbers of pages to read
+	 * @param pages  	Receives a pointer to each page, in the order of pageNos
+	 */
+  void readPages(File* file, const std::vector<PageId>& pageNos, std::vector<const Page*>& pages);
+
+	/**
+	 * Reads the run of <numPages> pages starting at <firstPageNo> into the buffer pool and pins them all.
+	 *
+	 * @see readPages(File*, const std::vector<PageId>&, std::vector<Page*>&)
+	 * @param file   	File object
+	 * @param firstPageNo  Number of first page to read
+	 * @param numPages  Number of pages to read
+	 * @param pages  	Receives a pointer to each page, in page number order
+	 */
+  void readPages(File* file, const PageId firstPageNo, const std::uint32_t numPages, std::vector<Page*>& pages);
+
 	/**
 	 * Unpin a page from memory since it is no longer required for it to remain in memory.
 	 *
@@ -236,6 +349,7 @@ class BufMgr
 	 * @param PageNo  Page number
 	 * @param dirty		True if the page to be unpinned needs to be marked dirty	
    * @throws  PageNotPinnedException If the page is not already pinned
+   * @throws  ReadOnlyFileException If the file is memory-mapped and dirty is true
 	 */
   void unPinPage(File* file, const PageId PageNo, const bool dirty);
 
@@ -260,6 +374,49 @@ class BufMgr
 	 */
   void flushFile(const File* file);
 
+	/**
+	 * Writes out the dirty, unpinned pages of the file, keeping them in the buffer pool, unlike
+	 * flushFile.  All writes are submitted to the I/O engine together.
+	 *
+	 * @param file   	File object
+	 * @return  Number of pages written
+	 */
+  std::uint32_t writeFile(const File* file);
+
+	/**
+	 * Writes out the dirty pages of the file as writeFile does, for readers which go to the file directly
+	 * rather than through the buffer pool; afterwards the file on disk holds every change made in the pool.
+	 *
+	 * @param file   	File object
+   * @throws PagePinnedException If a dirty page of the file is pinned, and so may still be changing
+	 */
+  void syncFile(const File* file);
+
+	/**
+	 * Reads a run of pages of the file into the buffer pool ahead of use, without pinning them.
+	 * All reads are submitted to the I/O engine together.  Pages already in the buffer pool are skipped.
+	 * Prefetching is only a hint: it stops quietly at the end of the file or when no unpinned frame is left,
+	 * and pages which turn out not to be in use are dropped again.  Memory-mapped files are not prefetched.
+	 *
+	 * @param file   	File object
+	 * @param firstPageNo  Number of first page to read
+	 * @param numPages  Number of pages to read
+   * @throws FileIOException If the operating system reports an error while reading
+	 */
+  void prefetch(File* file, const PageId firstPageNo, const std::uint32_t numPages);
+
+	/**
+	 * Writes back dirty, unpinned pages in the next <numFrames> frames the clock will visit, so that
+	 * allocBuf finds them clean and does not have to write while evicting.  All writes are submitted
+	 * to the I/O engine together, but the call is synchronous: it returns only once they have all
+	 * completed, so run it between operations rather than expecting it to overlap with them.  Pages
+	 * stay in the buffer pool.
+	 *
+	 * @param numFrames  Number of frames ahead of the clock hand to look at
+	 * @return  Number of pages written
+	 */
+  std::uint32_t writeBack(const std::uint32_t numFrames);
+
 	/**
 	 * Delete page from file and also from buffer pool if present.
 	 * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
@@ -270,6 +427,57 @@ class BufMgr
   void disposePage(File* file, const PageId PageNo);
 
 	/**
+	 * Inserts a record into a page of the file with room for it, or into a new page.  Pages which
+	 * records were deleted from are found through the page directory as soon as they are unpinned,
+	 * before they are written back.  Long attributes are moved to the file's overflow file first, if
+	 * it has one (see PageFile::setOverflowAttributes()).
+	 *
+	 * @param file   	File object
+	 * @param data  	Bytes that compose the record
+	 * @return  ID of the new record
+	 * @throws InsufficientSpaceException If the record does not fit on an empty page
+	 */
+  RecordId insertRecord(PageFile* file, const std::string& data);
+
+	/**
+	 * Returns a copy of the record with the given ID, following its forwarding stub if the record has
+	 * moved to another page.
+	 *
+	 * @param file   	File object
+	 * @param rid  	ID of record
+	 * @return  The record
+	 * @throws InvalidRecordException If the ID does not refer to a record of the file
+	 */
+  std::string readRecord(PageFile* file, const RecordId& rid);
+
+	/**
+	 * Updates the record with the given ID without changing its ID, so that indexes pointing at it stay
+	 * valid.  The record is updated in place on its page if it fits there.  A record which outgrows its
+	 * page moves to another page with room, or a new page, and a forwarding stub with its new location
+	 * takes its place; it moves on again rather than forwarding twice if it outgrows that page too.
+	 * Long attributes of the new version go to the file's overflow file, and values the old version
+	 * held there alone are freed.
+	 *
+	 * @param file   	File object
+	 * @param rid  	ID of record
+	 * @param data  	Updated bytes that compose the record
+	 * @throws InvalidRecordException If the ID does not refer to a record of the file
+	 * @throws InsufficientSpaceException If the record does not fit on an empty page, or its stub does
+	 *                                    not fit on its page
+	 */
+  void updateRecord(PageFile* file, const RecordId& rid, const std::string& data);
+
+	/**
+	 * Deletes the record with the given ID, along with its forwarding stub if it has moved, and frees
+	 * the values it held in the file's overflow file.
+	 *
+	 * @param file   	File object
+	 * @param rid  	ID of record
+	 * @throws InvalidRecordException If the ID does not refer to a record of the file
+	 */
+  void deleteRecord(PageFile* file, const RecordId& rid);
+
+	/**
    * Print member variable values. 
 	 */
   void  printSelf();
@@ -0,0 +1,43 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a file is asked to keep zone maps
+ *        for attributes it can't summarize.
+ */
+class BadZoneAttributeException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a bad zone attribute exception for the given file.
+   *
+   * @param name    Name of file.
+   * @param reason  What is wrong with the attributes.
+   */
+  BadZoneAttributeException(const std::string& name,
+                            const std::string& reason);
+
+  /**
+   * Returns the name of the file that caused this exception.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+ protected:
+  /**
+   * Name of file that caused this exception.
+   */
+  const std::string filename_;
+};
+
+}
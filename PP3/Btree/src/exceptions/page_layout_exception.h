@@ -0,0 +1,43 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when an operation is not supported by
+ *        the layout of a page.
+ */
+class PageLayoutException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a page layout exception for the given page.
+   *
+   * @param page_num  Number of page.
+   * @param reason    Why the operation is not supported.
+   */
+  PageLayoutException(const PageId page_num, const std::string& reason);
+
+  /**
+   * Returns the page number of the page which caused this exception.
+   */
+  virtual PageId page_number() const { return page_number_; }
+
+ protected:
+  /**
+   * Page number of the page which caused this exception.
+   */
+  const PageId page_number_;
+};
+
+}
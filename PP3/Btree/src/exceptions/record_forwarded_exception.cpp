@@ -0,0 +1,29 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "record_forwarded_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+RecordForwardedException::RecordForwardedException(
+    const RecordId& rec_id, const RecordId& new_location)
+    : BadgerDbException(""),
+      record_id_(rec_id),
+      new_location_(new_location) {
+  std::stringstream ss;
+  ss << "Record has been moved to another page."
+     << " Record {page=" << record_id_.page_number
+     << ", slot=" << record_id_.slot_number
+     << "} now at {page=" << new_location_.page_number
+     << ", slot=" << new_location_.slot_number << "}";
+  message_.assign(ss.str());
+}
+
+}
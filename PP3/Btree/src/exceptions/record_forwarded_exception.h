@@ -0,0 +1,54 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a record is read or updated through
+ *        a page which only holds a forwarding stub for it.
+ */
+class RecordForwardedException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a record forwarded exception for the given record ID.
+   *
+   * @param rec_id        Requested record ID.
+   * @param new_location  Where the record is stored now.
+   */
+  RecordForwardedException(const RecordId& rec_id,
+                           const RecordId& new_location);
+
+  /**
+   * Returns the requested record ID that caused this exception.
+   */
+  virtual const RecordId& record_id() const { return record_id_; }
+
+  /**
+   * Returns where the record is stored now.
+   */
+  virtual const RecordId& new_location() const { return new_location_; }
+
+ protected:
+  /**
+   * Record ID which caused this exception.
+   */
+  const RecordId record_id_;
+
+  /**
+   * Where the record is stored now.
+   */
+  const RecordId new_location_;
+};
+
+}
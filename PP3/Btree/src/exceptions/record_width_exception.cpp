@@ -0,0 +1,28 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "record_width_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+RecordWidthException::RecordWidthException(const PageId page_num,
+                                           const std::size_t page_width,
+                                           const std::size_t record_width)
+    : BadgerDbException(""),
+      page_number_(page_num),
+      page_width_(page_width),
+      record_width_(record_width) {
+  std::stringstream ss;
+  ss << "Record width " << record_width_ << " does not match page format."
+     << " Page: " << page_number_ << " Fixed record width: " << page_width_;
+  message_.assign(ss.str());
+}
+
+}
@@ -0,0 +1,68 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "badgerdb_exception.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a record doesn't match the fixed
+ *        record width of a page, or a page is used with the wrong format.
+ */
+class RecordWidthException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a record width exception for the given page.
+   *
+   * @param page_num      Number of page.
+   * @param page_width    Fixed record width of the page, or 0 if the page
+   *                      holds variable-length records.
+   * @param record_width  Width of the record or page format requested.
+   */
+  RecordWidthException(const PageId page_num, const std::size_t page_width,
+                       const std::size_t record_width);
+
+  /**
+   * Returns the page number of the page which caused this exception.
+   */
+  virtual PageId page_number() const { return page_number_; }
+
+  /**
+   * Returns the fixed record width of the page, or 0 if it holds
+   * variable-length records.
+   */
+  virtual std::size_t page_width() const { return page_width_; }
+
+  /**
+   * Returns the width of the record or page format requested.
+   */
+  virtual std::size_t record_width() const { return record_width_; }
+
+ protected:
+  /**
+   * Page number of the page which caused this exception.
+   */
+  const PageId page_number_;
+
+  /**
+   * Fixed record width of the page, or 0 for variable-length records.
+   */
+  const std::size_t page_width_;
+
+  /**
+   * Width of the record or page format requested.
+   */
+  const std::size_t record_width_;
+};
+
+}
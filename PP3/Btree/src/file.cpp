@@ -7,24 +7,126 @@
 
 #include "file.h"
 
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <new>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <string>
 #include <cstdio>
 #include <cassert>
 
+#include "exceptions/bad_zone_attribute_exception.h"
 #include "exceptions/file_exists_exception.h"
+#include "exceptions/file_format_exception.h"
+#include "exceptions/file_io_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
+#include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/read_only_file_exception.h"
 #include "file_iterator.h"
+#include "io_engine.h"
+#include "overflow_file.h"
 #include "page.h"
+#include "page_codec.h"
+#include "page_iterator.h"
 
 namespace badgerdb {
 
-File::StreamMap File::open_streams_;
+File::DescriptorMap File::open_fds_;
 File::CountMap File::open_counts_;
+File::MetadataMap File::open_metadata_;
+
+namespace {
+
+/**
+ * Block of memory aligned for direct I/O, freed when it goes out of scope.
+ */
+class AlignedBuffer {
+ public:
+  explicit AlignedBuffer(const std::size_t size) : data_(NULL) {
+    void* data;
+    if (posix_memalign(&data, File::DIRECT_IO_ALIGNMENT, size) != 0) {
+      throw std::bad_alloc();
+    }
+    data_ = static_cast<char*>(data);
+  }
+
+  ~AlignedBuffer() { std::free(data_); }
+
+  char* get() const { return data_; }
+
+ private:
+  AlignedBuffer(const AlignedBuffer&);
+  AlignedBuffer& operator=(const AlignedBuffer&);
+
+  char* data_;
+};
+
+/**
+ * Largest number of buffers handed to a single preadv call.
+ */
+#ifdef IOV_MAX
+const std::size_t MAX_IOVECS = IOV_MAX;
+#else
+const std::size_t MAX_IOVECS = 1024;
+#endif
+
+bool isAligned(const void* buffer, const std::size_t length,
+               const off_t offset) {
+  return reinterpret_cast<uintptr_t>(buffer) % File::DIRECT_IO_ALIGNMENT == 0 &&
+      length % File::DIRECT_IO_ALIGNMENT == 0 &&
+      offset % File::DIRECT_IO_ALIGNMENT == 0;
+}
+
+/**
+ * Returns the value of a zone attribute in a record, or NaN if the record is
+ * too short to have it.
+ */
+double zoneValue(const ZoneAttribute& attribute, const char* record,
+                 const std::size_t size) {
+  if (attribute.type == ZoneAttribute::INTEGER &&
+      attribute.offset + sizeof(int) <= size) {
+    int int_value;
+    std::memcpy(&int_value, record + attribute.offset, sizeof(int));
+    return int_value;
+  }
+  if (attribute.type == ZoneAttribute::DOUBLE &&
+      attribute.offset + sizeof(double) <= size) {
+    double value;
+    std::memcpy(&value, record + attribute.offset, sizeof(double));
+    return value;
+  }
+  return std::numeric_limits<double>::quiet_NaN();
+}
+
+/**
+ * Widens a zone to take in a value; NaN, which no range excludes, widens it
+ * to everything.
+ */
+void widenZone(PageZone& zone, const double value) {
+  if (value != value) {
+    zone.min = -std::numeric_limits<double>::infinity();
+    zone.max = std::numeric_limits<double>::infinity();
+  } else {
+    zone.min = std::min(zone.min, value);
+    zone.max = std::max(zone.max, value);
+  }
+}
+
+}
 
 void File::remove(const std::string& filename) {
   if (!exists(filename)) {
@@ -64,24 +166,44 @@ PageId File::getFirstPageNo() {
   return header.first_used_page;
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
-  openIfNeeded(create_new);
+void File::setExtentSize(const PageId extent_pages) {
+  FileHeader header = readHeader();
+  header.extent_pages = extent_pages;
+  writeHeader(header);
+}
+
+PageId File::extentSize() const {
+  const FileHeader header = readHeader();
+  return header.extent_pages > 1 ? header.extent_pages : 1;
+}
+
+File::File(const std::string& name, const bool create_new,
+           const bool direct_io, const bool compress)
+    : filename_(name), fd_(-1), direct_(false),
+      first_page_offset_(sizeof(FileHeader)), compressed_(false),
+      slot_size_(Page::SIZE) {
+  openIfNeeded(create_new, direct_io, compress);
 
   if (create_new) {
     // File starts with 1 page (the header).
-    FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
-                         0 /* num_free_pages */, 0 /* first_free_page */};
+    FileHeader header = {FileHeader::FORMAT_VERSION,
+                         1 /* num_pages */, 0 /* first_used_page */,
+                         0 /* num_free_pages */, 0 /* first_free_page */,
+                         direct_io || compress ? FileHeader::ALIGNED_LAYOUT : 0,
+                         0 /* extent_pages */, compress};
     writeHeader(header);
   }
 }
 
-void File::openIfNeeded(const bool create_new) {
-  if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
+void File::openIfNeeded(const bool create_new, const bool direct_io,
+                        const bool compress) {
+  const bool first_open = open_counts_.find(filename_) == open_counts_.end();
+  if (!first_open) {	//exists an entry already
     ++open_counts_[filename_];
-    stream_ = open_streams_[filename_];
+    fd_ = open_fds_[filename_];
+    metadata_ = open_metadata_[filename_];
   } else {
-    std::ios_base::openmode mode =
-        std::fstream::in | std::fstream::out | std::fstream::binary;
+    int flags = O_RDWR;
     const bool already_exists = exists(filename_);
     if (create_new) {
       // Error if we try to overwrite an existing file.
@@ -89,59 +211,382 @@ void File::openIfNeeded(const bool create_new) {
         throw FileExistsException(filename_);
       }
       // New files have to be truncated on open.
-      mode = mode | std::fstream::trunc;
+      flags |= O_CREAT | O_TRUNC;
     } else {
       // Error if we try to open a file that doesn't exist.
       if (!already_exists) {
         throw FileNotFoundException(filename_);
       }
     }
-    stream_.reset(new std::fstream(filename_, mode));
-    open_streams_[filename_] = stream_;
+#ifdef O_DIRECT
+    if (direct_io) {
+      fd_ = ::open(filename_.c_str(), flags | O_DIRECT, 0666);
+      if (fd_ < 0 && errno != EINVAL) {
+        throw FileIOException(filename_, errno);
+      }
+      // EINVAL: the filesystem does not support direct I/O; use the page cache.
+    }
+#endif
+    if (fd_ < 0) {
+      fd_ = ::open(filename_.c_str(), flags, 0666);
+    }
+    if (fd_ < 0) {
+      throw FileIOException(filename_, errno);
+    }
+    open_fds_[filename_] = fd_;
     open_counts_[filename_] = 1;
+    metadata_.reset(new Metadata());
+    open_metadata_[filename_] = metadata_;
+  }
+
+#ifdef O_DIRECT
+  direct_ = (fcntl(fd_, F_GETFL) & O_DIRECT) != 0;
+#endif
+  if (!create_new && first_open) {
+    readBytes(&metadata_->header, sizeof(FileHeader), 0 /* offset */);
+    if (metadata_->header.format_version != FileHeader::FORMAT_VERSION) {
+      close();
+      throw FileFormatException(filename_);
+    }
+  }
+  // Compressed files release the unused blocks of each page slot, which only
+  // works if slots start on block boundaries; hence the aligned layout.
+  bool aligned_layout = direct_io || compress;
+  compressed_ = compress;
+  if (!create_new) {
+    const FileHeader header = readHeader();
+    aligned_layout = header.aligned_layout == FileHeader::ALIGNED_LAYOUT;
+    compressed_ = header.compressed != 0;
+  }
+  first_page_offset_ = aligned_layout ? Page::SIZE : sizeof(FileHeader);
+  slot_size_ = compressed_ ? Page::SIZE + DIRECT_IO_ALIGNMENT : Page::SIZE;
+#ifdef O_DIRECT
+  if (direct_ && !aligned_layout) {
+    // Pages of packed files straddle alignment boundaries, so every transfer
+    // would need a bounce buffer; buffered I/O is cheaper.
+    fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT);
+    direct_ = false;
   }
+#endif
 }
 
 void File::close() {
 	if(open_counts_[filename_] > 0)
   	--open_counts_[filename_];
 
-  stream_.reset();
 	assert(open_counts_[filename_] >= 0);
 
   if (open_counts_[filename_] == 0) {
-    open_streams_.erase(filename_);
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+    open_fds_.erase(filename_);
     open_counts_.erase(filename_);
+    open_metadata_.erase(filename_);
   }
+  metadata_.reset();
+  fd_ = -1;
+  direct_ = false;
 }
 
-FileHeader File::readHeader() const {
-  FileHeader header;
-  stream_->seekg(0 /* pos */, std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(FileHeader));
-  return header;
+void File::reserveSpace(const FileHeader& header,
+                        const PageId last_page_number) {
+  if (header.extent_pages <= 1) {
+    return;
+  }
+  const off_t end = pagePosition(last_page_number + 1);
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    throw FileIOException(filename_, errno);
+  }
+  if (end <= st.st_size) {
+    return;
+  }
+  // Grow to the end of the extent starting at the first missing page.
+  const PageId first_missing = (st.st_size <= first_page_offset_) ? 1
+      : (st.st_size - first_page_offset_) / slot_size_ + 1;
+  PageId extent_end = first_missing + header.extent_pages;
+  if (extent_end < last_page_number + 1) {
+    extent_end = last_page_number + 1;
+  }
+  // Failures (e.g. a filesystem without fallocate support) are not fatal;
+  // the writes which follow report any real problem.
+  posix_fallocate(fd_, st.st_size, pagePosition(extent_end) - st.st_size);
 }
 
 void File::writeHeader(const FileHeader& header) {
-  stream_->seekp(0 /* pos */, std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
-  stream_->flush();
+  writeBytes(&header, sizeof(FileHeader), 0 /* offset */);
+  metadata_->header = header;
+}
+
+void File::readBytes(void* buffer, const std::size_t length,
+                     const off_t offset) const {
+  if (direct_ && !isAligned(buffer, length, offset)) {
+    const off_t start = offset - offset % DIRECT_IO_ALIGNMENT;
+    const std::size_t span = (offset + length - start + DIRECT_IO_ALIGNMENT - 1)
+        / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+    AlignedBuffer bounce(span);
+    readFully(bounce.get(), span, start);
+    std::memcpy(buffer, bounce.get() + (offset - start), length);
+    return;
+  }
+  readFully(buffer, length, offset);
+}
+
+void File::writeBytes(const void* buffer, const std::size_t length,
+                      const off_t offset) {
+  if (direct_ && !isAligned(buffer, length, offset)) {
+    const off_t start = offset - offset % DIRECT_IO_ALIGNMENT;
+    const std::size_t span = (offset + length - start + DIRECT_IO_ALIGNMENT - 1)
+        / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+    AlignedBuffer bounce(span);
+    readFully(bounce.get(), span, start);
+    std::memcpy(bounce.get() + (offset - start), buffer, length);
+    writeFully(bounce.get(), span, start);
+    return;
+  }
+  writeFully(buffer, length, offset);
+}
+
+void File::readPageSlot(const PageId page_number, Page& page) const {
+  if (!compressed_) {
+    readBytes(&page, Page::SIZE, pagePosition(page_number));
+    return;
+  }
+  AlignedBuffer slot(slot_size_);
+  readUsedSlot(page_number, slot.get());
+  decodePageSlot(page_number, slot.get(), page);
+}
+
+void File::readUsedSlot(const PageId page_number, char* slot) const {
+  const off_t position = pagePosition(page_number);
+  readBytes(slot, DIRECT_IO_ALIGNMENT, position);
+  PageSlotHeader header;
+  std::memcpy(&header, slot, sizeof(PageSlotHeader));
+  if (header.encoding == PageSlotHeader::EMPTY) {
+    return;
+  }
+  // A corrupt length is caught when the slot is decoded; just don't read past
+  // the slot meanwhile.
+  const std::size_t used = usedSlotBytes(
+      std::min<std::size_t>(header.length,
+                            slot_size_ - sizeof(PageSlotHeader)));
+  if (used > DIRECT_IO_ALIGNMENT) {
+    readBytes(slot + DIRECT_IO_ALIGNMENT, used - DIRECT_IO_ALIGNMENT,
+              position + DIRECT_IO_ALIGNMENT);
+  }
+}
+
+void File::writePageSlot(const PageId page_number, const Page& page,
+                         const bool compress) {
+  if (!compressed_) {
+    writeBytes(&page, Page::SIZE, pagePosition(page_number));
+    return;
+  }
+  AlignedBuffer slot(slot_size_);
+  PageSlotHeader header;
+  char* data = slot.get() + sizeof(PageSlotHeader);
+  // The page header stays raw, so that it can be read and written in place.
+  std::memcpy(data, &page.header_, sizeof(PageHeader));
+  std::size_t length = 0;
+  if (compress) {
+    // Only worth it if the compressed page takes fewer blocks than a raw one.
+    length = PageCodec::compress(page.data_, Page::DATA_SIZE,
+                                 data + sizeof(PageHeader),
+                                 Page::DATA_SIZE - sizeof(PageSlotHeader));
+  }
+  header.length = sizeof(PageHeader) + length;
+  header.encoding = PageSlotHeader::COMPRESSED;
+  if (length == 0) {
+    header.length = Page::SIZE;
+    header.encoding = PageSlotHeader::RAW;
+    std::memcpy(data, &page, Page::SIZE);
+  }
+  std::memcpy(slot.get(), &header, sizeof(PageSlotHeader));
+
+  const std::size_t used = usedSlotBytes(header.length);
+  std::memset(data + header.length, 0,
+              used - sizeof(PageSlotHeader) - header.length);
+  const off_t position = pagePosition(page_number);
+  writeBytes(slot.get(), used, position);
+#ifdef FALLOC_FL_PUNCH_HOLE
+  // Give the rest of the slot back to the filesystem.  If it can't, the stale
+  // bytes are simply never read.
+  fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, position + used,
+            slot_size_ - used);
+#endif
+}
+
+void File::decodePageSlot(const PageId page_number, const char* slot,
+                          Page& page) const {
+  PageSlotHeader header;
+  std::memcpy(&header, slot, sizeof(PageSlotHeader));
+  const char* data = slot + sizeof(PageSlotHeader);
+  char* dest = reinterpret_cast<char*>(&page);
+  switch (header.encoding) {
+    case PageSlotHeader::EMPTY:
+      std::memset(dest, 0, Page::SIZE);
+      return;
+    case PageSlotHeader::RAW:
+      if (header.length == Page::SIZE) {
+        std::memcpy(dest, data, Page::SIZE);
+        return;
+      }
+      break;
+    case PageSlotHeader::COMPRESSED:
+      if (header.length >= sizeof(PageHeader) &&
+          header.length <= slot_size_ - sizeof(PageSlotHeader) &&
+          PageCodec::decompress(data + sizeof(PageHeader),
+                                header.length - sizeof(PageHeader),
+                                page.data_, Page::DATA_SIZE)) {
+        std::memcpy(&page.header_, data, sizeof(PageHeader));
+        return;
+      }
+      break;
+  }
+  throw InvalidPageException(page_number, filename_);
+}
+
+void File::readFully(void* buffer, const std::size_t length,
+                     const off_t offset) const {
+  char* dest = static_cast<char*>(buffer);
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t result = ::pread(fd_, dest + done, length - done,
+                                   offset + done);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(filename_, errno);
+    }
+    if (result == 0) {
+      // Past the end of the file.
+      std::memset(dest + done, 0, length - done);
+      break;
+    }
+    done += result;
+  }
+}
+
+void File::writeFully(const void* buffer, const std::size_t length,
+                      const off_t offset) {
+  const char* src = static_cast<const char*>(buffer);
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t result = ::pwrite(fd_, src + done, length - done,
+                                    offset + done);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(filename_, errno);
+    }
+    done += result;
+  }
+}
+
+void File::readPagesInto(const PageId first_page_number,
+                         const std::vector<Page*>& pages) const {
+  if (compressed_) {
+    // Reading the slots whole would read the blocks they leave free too, so
+    // read each page's blocks on their own.
+    AlignedBuffer slot(slot_size_);
+    for (std::size_t i = 0; i < pages.size(); ++i) {
+      readUsedSlot(first_page_number + i, slot.get());
+      decodePageSlot(first_page_number + i, slot.get(), *pages[i]);
+    }
+    return;
+  }
+  if (direct_) {
+    for (std::size_t i = 0; i < pages.size(); ++i) {
+      if (!isAligned(pages[i], Page::SIZE, 0 /* offset */)) {
+        // preadv can't bounce; read the pages one at a time instead.
+        for (std::size_t j = 0; j < pages.size(); ++j) {
+          readBytes(pages[j], Page::SIZE, pagePosition(first_page_number + j));
+        }
+        return;
+      }
+    }
+  }
+
+  // Pages completely read so far, and bytes read of the page after them.
+  std::size_t done = 0;
+  std::size_t partial = 0;
+  while (done < pages.size()) {
+    const std::size_t num_iovecs = std::min(pages.size() - done, MAX_IOVECS);
+    std::vector<iovec> iovecs(num_iovecs);
+    for (std::size_t i = 0; i < num_iovecs; ++i) {
+      iovecs[i].iov_base = reinterpret_cast<char*>(pages[done + i]);
+      iovecs[i].iov_len = Page::SIZE;
+    }
+    iovecs[0].iov_base = static_cast<char*>(iovecs[0].iov_base) + partial;
+    iovecs[0].iov_len -= partial;
+
+    const ssize_t result = ::preadv(fd_, &iovecs[0], num_iovecs,
+                                    pagePosition(first_page_number + done) +
+                                    partial);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(filename_, errno);
+    }
+    if (result == 0) {
+      // Past the end of the file.
+      std::memset(reinterpret_cast<char*>(pages[done]) + partial, 0,
+                  Page::SIZE - partial);
+      for (std::size_t i = done + 1; i < pages.size(); ++i) {
+        std::memset(static_cast<void*>(pages[i]), 0, Page::SIZE);
+      }
+      break;
+    }
+    partial += result;
+    done += partial / Page::SIZE;
+    partial %= Page::SIZE;
+  }
+}
+
+void File::readPageAsync(IoEngine& engine, const PageId page_number,
+                         Page* page) const {
+  // Compressed pages are decoded as they are read, so they can't be left to
+  // the engine; neither can direct reads into unaligned buffers.
+  if (compressed_ ||
+      (direct_ && !isAligned(page, Page::SIZE, pagePosition(page_number)))) {
+    readPageSlot(page_number, *page);
+    return;
+  }
+  engine.prepareRead(fd_, pagePosition(page_number), page, Page::SIZE,
+                     filename_);
 }
 
+void File::writePageAsync(IoEngine& engine, const PageId page_number,
+                          Page* page) {
+  if (compressed_ ||
+      (direct_ && !isAligned(page, Page::SIZE, pagePosition(page_number)))) {
+    writePageSlot(page_number, *page);
+    return;
+  }
+  engine.prepareWrite(fd_, pagePosition(page_number), page, Page::SIZE,
+                      filename_);
+}
 
 
 
 
-PageFile PageFile::create(const std::string& filename) {
-  return PageFile(filename, true /* create_new */);
+
+PageFile PageFile::create(const std::string& filename, const bool direct_io,
+                       const bool compress) {
+  return PageFile(filename, true /* create_new */, direct_io, compress);
 }
 
-PageFile PageFile::open(const std::string& filename) {
-  return PageFile(filename, false /* create_new */);
+PageFile PageFile::open(const std::string& filename, const bool direct_io) {
+  return PageFile(filename, false /* create_new */, direct_io);
 }
 
-PageFile::PageFile(const std::string& name, const bool create_new)
-: File(name, create_new)
+PageFile::PageFile(const std::string& name, const bool create_new,
+                   const bool direct_io, const bool compress)
+: File(name, create_new, direct_io, compress)
 {
 }
 
@@ -149,7 +594,7 @@ PageFile::~PageFile() {
 }
 
 PageFile::PageFile(const PageFile& other)
-: File(other.filename_, false /* create_new */)
+: File(other.filename_, false /* create_new */, other.direct_)
 {
 }
 
@@ -158,98 +603,107 @@ PageFile& PageFile::operator=(const PageFile& rhs) {
   // same file.
   close();	//close my file and associate me with the new one
   filename_ = rhs.filename_;
-  openIfNeeded(false /* create_new */);
+  openIfNeeded(false /* create_new */, rhs.direct_);
   return *this;
 }
 
 Page PageFile::allocatePage(PageId &new_page_number) {
   FileHeader header = readHeader();
   Page new_page;
-  Page existing_page;
   if (header.num_free_pages > 0) {
     new_page = readPage(header.first_free_page, true /* allow_free */);
     new_page.set_page_number(header.first_free_page);
-		new_page_number = new_page.page_number();
     header.first_free_page = new_page.next_page_number();
     --header.num_free_pages;
 
-    if (header.first_used_page == Page::INVALID_NUMBER ||
-        header.first_used_page > new_page.page_number()) {
-      // Either have no pages used or the head of the used list is a page later
-      // than the one we just allocated, so add the new page to the head.
-      if (header.first_used_page > new_page.page_number()) {
-        new_page.set_next_page_number(header.first_used_page);
-      }
-      header.first_used_page = new_page.page_number();
-    } else {
-      // New page is reused from somewhere after the beginning, so we need to
-      // find where in the used list to insert it.
-      PageId next_page_number = Page::INVALID_NUMBER;
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        next_page_number = (*iter).next_page_number();
-        if (next_page_number > new_page.page_number() ||
-            next_page_number == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      existing_page.set_next_page_number(new_page.page_number());
-      new_page.set_next_page_number(next_page_number);
-    }
-
     assert((header.num_free_pages == 0) ==
            (header.first_free_page == Page::INVALID_NUMBER));
   }
 	else
 	{
-    new_page.set_page_number(header.num_pages);
-		new_page_number = new_page.page_number();
-
-    if (header.first_used_page == Page::INVALID_NUMBER)
-		{
-      header.first_used_page = new_page.page_number();
-    }
-		else
-		{
-      // If we have pages allocated, we need to add the new page to the tail
-      // of the linked list.
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        if ((*iter).next_page_number() == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      assert(existing_page.isUsed());
-      existing_page.set_next_page_number(new_page.page_number());
+    if (isDirectoryPage(header.num_pages)) {
+      // The page at the end of the file is reserved for the page directory
+      // covering the pages after it, so lay down an empty directory first.
+      Page directory_page;
+      writePage(header.num_pages, directory_page.header_, directory_page);
+      ++header.num_pages;
     }
+    new_page.set_page_number(header.num_pages);
     ++header.num_pages;
+    reserveSpace(header, new_page.page_number());
   }
-  writePage(new_page_number, new_page.header_, new_page);
-  if (existing_page.page_number() != Page::INVALID_NUMBER) {
-    // If we updated an existing page by inserting the new page into the
-    // used list, we need to write it out.
-    writePage(existing_page.page_number(), existing_page.header_, existing_page);
+	new_page_number = new_page.page_number();
+
+  // Link the new page into the used list right after the closest used page
+  // before it, which the page directory tells us without walking the list.
+  const PageId prev_page_number = findPreviousUsedPage(new_page_number);
+  PageId next_page_number;
+  if (prev_page_number == Page::INVALID_NUMBER) {
+    next_page_number = header.first_used_page;
+    header.first_used_page = new_page_number;
+  } else {
+    PageHeader prev_header = readPageHeader(prev_page_number);
+    next_page_number = prev_header.next_page_number;
+    prev_header.next_page_number = new_page_number;
+    writePageHeader(prev_page_number, prev_header);
+    PageDirectoryEntry prev_entry = readDirectoryEntry(prev_page_number);
+    prev_entry.next_page_number = new_page_number;
+    writeDirectoryEntry(prev_page_number, prev_entry);
   }
+  new_page.set_next_page_number(next_page_number);
+  if (next_page_number != Page::INVALID_NUMBER) {
+    PageDirectoryEntry next_entry = readDirectoryEntry(next_page_number);
+    next_entry.prev_page_number = new_page_number;
+    writeDirectoryEntry(next_page_number, next_entry);
+  }
+
+  PageDirectoryEntry entry = {prev_page_number, next_page_number,
+                              new_page.getFreeSpace(), true /* used */,
+                              0 /* reserved */, {}};
+  summarizePage(new_page, header, entry);
+  writeDirectoryEntry(new_page_number, entry);
+  writePage(new_page_number, new_page.header_, new_page);
   writeHeader(header);
 
   return new_page;
 }
 
 Page PageFile::readPage(const PageId page_number) const {
-  FileHeader header = readHeader();
+	Page page;
+	readPageInto(page_number, page);
+	return page;
+}
 
-	if (page_number >= header.num_pages)
+void PageFile::readPageInto(const PageId page_number, Page& page) const {
+	if (page_number == Page::INVALID_NUMBER)
 	{
 		throw InvalidPageException(page_number, filename_);
 	}
-	return readPage(page_number, false /* allow_free */);
+  // No need to check the page number against the file header (an extra
+  // device read with direct I/O): pages past the end of the file read as
+  // zeros, which the used check below rejects.
+  readPageSlot(page_number, page);
+  if (!page.isUsed()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+}
+
+void PageFile::readPagesInto(const PageId first_page_number,
+                             const std::vector<Page*>& pages) const {
+  if (first_page_number == Page::INVALID_NUMBER) {
+    throw InvalidPageException(first_page_number, filename_);
+  }
+  File::readPagesInto(first_page_number, pages);
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    if (!pages[i]->isUsed()) {
+      throw InvalidPageException(first_page_number + i, filename_);
+    }
+  }
 }
 
 Page PageFile::readPage(const PageId page_number, const bool allow_free) const {
   Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(PageHeader));
-  stream_->read(&page.data_[0], Page::DATA_SIZE);
+  readPageSlot(page_number, page);
   if (!allow_free && !page.isUsed()) {
     throw InvalidPageException(page_number, filename_);
   }
@@ -258,55 +712,474 @@ Page PageFile::readPage(const PageId page_number, const bool allow_free) const {
 }
 
 void PageFile::writePage(const PageId new_page_number, const Page& new_page) {
-	PageHeader header = readPageHeader(new_page_number);
-	if (header.current_page_number == Page::INVALID_NUMBER)
-	{
-		// Page has been deleted since it was read.
-		throw InvalidPageException(new_page_number, filename_);
-	}
+	// Throws if the page has been deleted since it was read.
+	const PageDirectoryEntry entry = readUsedDirectoryEntry(new_page_number);
 	// Page on disk may have had its next page pointer updated since it was read;
 	// we don't modify that, but we do keep all the other modifications to the
-	// page header.
-	const PageId next_page_number = header.next_page_number;
-	header = new_page.header_;
-	header.next_page_number = next_page_number;
+	// page header.  The page directory holds the pointer as it is on disk.
+	PageHeader header = new_page.header_;
+	header.next_page_number = entry.next_page_number;
 	writePage(new_page_number, header, new_page);
+	updateDirectoryEntry(new_page_number, new_page, true /* save */);
 }
 
 void PageFile::deletePage(const PageId page_number) {
   FileHeader header = readHeader();
 
-  Page existing_page = readPage(page_number);
-  Page previous_page;
-  // If this page is the head of the used list, update the header to point to
-  // the next page in line.
-  if (page_number == header.first_used_page) {
-    header.first_used_page = existing_page.next_page_number();
+  // The file header and directory pages are never on the used list.
+  if (page_number == Page::INVALID_NUMBER || isDirectoryPage(page_number) ||
+      page_number >= header.num_pages) {
+    throw InvalidPageException(page_number, filename_);
+  }
+
+  // Unlink the page using the pointers kept in the page directory.
+  const PageDirectoryEntry entry = readUsedDirectoryEntry(page_number);
+  const PageId next_page_number = entry.next_page_number;
+  if (entry.prev_page_number == Page::INVALID_NUMBER) {
+    header.first_used_page = next_page_number;
   } else {
-    // Walk the used list so we can update the page that points to this one.
-    for (FileIterator iter = begin(); iter != end(); ++iter) {
-      previous_page = *iter;
-      if (previous_page.next_page_number() == existing_page.page_number()) {
-        previous_page.set_next_page_number(existing_page.next_page_number());
-        break;
-      }
-    }
+    PageHeader prev_header = readPageHeader(entry.prev_page_number);
+    prev_header.next_page_number = next_page_number;
+    writePageHeader(entry.prev_page_number, prev_header);
+    PageDirectoryEntry prev_entry = readDirectoryEntry(entry.prev_page_number);
+    prev_entry.next_page_number = next_page_number;
+    writeDirectoryEntry(entry.prev_page_number, prev_entry);
+  }
+  if (next_page_number != Page::INVALID_NUMBER) {
+    PageDirectoryEntry next_entry = readDirectoryEntry(next_page_number);
+    next_entry.prev_page_number = entry.prev_page_number;
+    writeDirectoryEntry(next_page_number, next_entry);
   }
+  const PageDirectoryEntry free_entry = {Page::INVALID_NUMBER,
+                                         Page::INVALID_NUMBER,
+                                         0 /* free_space */, false /* used */,
+                                         0 /* reserved */, {}};
+  writeDirectoryEntry(page_number, free_entry);
+
   // Clear the page and add it to the head of the free list.
-  existing_page.initialize();
+  Page existing_page;
   existing_page.set_next_page_number(header.first_free_page);
   header.first_free_page = page_number;
   ++header.num_free_pages;
-  if (previous_page.isUsed()) {
-    writePage(previous_page.page_number(), previous_page.header_, previous_page);
-  }
   writePage(page_number, existing_page.header_, existing_page);
   writeHeader(header);
 }
 
+void PageFile::readPageAsync(IoEngine& engine, const PageId page_number,
+                             Page* page) const {
+  const FileHeader header = readHeader();
+  if (page_number >= header.num_pages) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  File::readPageAsync(engine, page_number, page);
+}
+
+void PageFile::writePageAsync(IoEngine& engine, const PageId page_number,
+                              Page* page) {
+  // Throws if the page has been deleted since it was read.
+  const PageDirectoryEntry entry = readUsedDirectoryEntry(page_number);
+  // Same as writePage(): the used list on disk wins over the cached copy.
+  page->header_.next_page_number = entry.next_page_number;
+
+  updateDirectoryEntry(page_number, *page, false /* save */);
+  File::writePageAsync(engine, page_number, page);
+}
+
+void PageFile::finishWrites() {
+  std::vector<CachedDirectoryPage>& directory = metadata_->directory;
+  for (std::size_t i = 0; i < directory.size(); ++i) {
+    CachedDirectoryPage& cached = directory[i];
+    if (!cached.loaded || std::find(cached.unsaved.begin(),
+                                    cached.unsaved.end(), true) ==
+                          cached.unsaved.end()) {
+      continue;
+    }
+    Page directory_page;
+    std::memcpy(&directory_page.data_[0], &cached.entries[0],
+                DIRECTORY_ENTRIES * sizeof(PageDirectoryEntry));
+    writePage(FIRST_DIRECTORY_PAGE + i * (DIRECTORY_ENTRIES + 1),
+              directory_page.header_, directory_page);
+    cached.unsaved.assign(DIRECTORY_ENTRIES, false);
+  }
+}
+
+void PageFile::pageChanged(const PageId page_number, const Page& page) {
+  if (page_number == 0 || isDirectoryPage(page_number)) {
+    return;
+  }
+  const PageId directory_page_number = directoryPageFor(page_number);
+  const std::size_t index = page_number - directory_page_number - 1;
+  CachedDirectoryPage& cached = cachedDirectoryPage(directory_page_number);
+  const PageDirectoryEntry& entry = cached.entries[index];
+  if (!entry.used) {
+    return;
+  }
+  // Whatever changed, summarize the page now, so that scans skipping pages by
+  // zone see its records before it is written back.
+  PageDirectoryEntry new_entry = entry;
+  new_entry.free_space = page.getFreeSpace();
+  summarizePage(page, metadata_->header, new_entry);
+  if (std::memcmp(&new_entry, &entry, sizeof(PageDirectoryEntry)) != 0) {
+    cacheDirectoryEntry(page_number, new_entry, false /* saved */);
+  }
+  cached.zone_states[index] = CachedDirectoryPage::ZONES_TRACKED;
+}
+
+void PageFile::recordChanged(const PageId page_number, const Page& page,
+                             const std::string* removed,
+                             const std::string* added) {
+  const PageId directory_page_number = directoryPageFor(page_number);
+  const std::size_t index = page_number - directory_page_number - 1;
+  CachedDirectoryPage& cached = cachedDirectoryPage(directory_page_number);
+  PageDirectoryEntry entry = cached.entries[index];
+  if (!entry.used) {
+    return;
+  }
+  entry.free_space = page.getFreeSpace();
+  CachedDirectoryPage::ZoneState state = cached.zone_states[index];
+  if (state != CachedDirectoryPage::ZONES_STALE) {
+    state = CachedDirectoryPage::ZONES_TRACKED;
+  }
+  // Zones always take in what is added; a stale zone is only ever too wide.
+  const FileHeader& header = metadata_->header;
+  for (std::size_t i = 0; i < FileHeader::MAX_ZONE_ATTRIBUTES &&
+       header.zone_attributes[i].type != ZoneAttribute::NONE; ++i) {
+    PageZone& zone = entry.zones[i];
+    if (removed != NULL) {
+      // Only the records left can tell the new bound if this one set it.
+      const double value = zoneValue(header.zone_attributes[i],
+                                     removed->data(), removed->size());
+      if (value != value || value <= zone.min || value >= zone.max) {
+        state = CachedDirectoryPage::ZONES_STALE;
+      }
+    }
+    if (added != NULL) {
+      widenZone(zone, zoneValue(header.zone_attributes[i], added->data(),
+                                added->size()));
+    }
+  }
+  cacheDirectoryEntry(page_number, entry, false /* saved */);
+  cached.zone_states[index] = state;
+}
+
+PageId PageFile::findPageWithSpace(const std::size_t bytes) const {
+  const PageId num_pages = metadata_->header.num_pages;
+  for (PageId directory_page_number = FIRST_DIRECTORY_PAGE;
+       directory_page_number < num_pages;
+       directory_page_number += DIRECTORY_ENTRIES + 1) {
+    CachedDirectoryPage& cached = cachedDirectoryPage(directory_page_number);
+    if (cached.max_free_space < bytes) {
+      continue;
+    }
+    std::uint16_t max_free_space = 0;
+    for (std::size_t i = 0; i < DIRECTORY_ENTRIES; ++i) {
+      const PageId page_number = directory_page_number + 1 + i;
+      if (page_number >= num_pages) {
+        break;
+      }
+      const PageDirectoryEntry& entry = cached.entries[i];
+      if (entry.used) {
+        if (entry.free_space >= bytes) {
+          return page_number;
+        }
+        max_free_space = std::max(max_free_space, entry.free_space);
+      }
+    }
+    // No page here has enough; later searches can skip the directory page
+    // until one of its pages gains space.
+    cached.max_free_space = max_free_space;
+  }
+  return Page::INVALID_NUMBER;
+}
+
+void PageFile::allocateExtent(const PageId num_pages,
+                              std::vector<PageId>& page_numbers) {
+  appendPages(num_pages, NULL /* contents */, page_numbers);
+}
+
+void PageFile::appendRecords(const std::vector<std::string>& records,
+                             std::vector<RecordId>& record_ids) {
+  record_ids.clear();
+  record_ids.reserve(records.size());
+  std::vector<Page> pages;
+  std::vector<std::size_t> page_record_counts;
+  std::vector<PageId> page_numbers;
+  std::size_t next_record = 0;
+  while (next_record < records.size()) {
+    pages.clear();
+    page_record_counts.clear();
+    while (next_record < records.size() && pages.size() < APPEND_RUN_PAGES) {
+      pages.push_back(Page());
+      const std::size_t num_inserted =
+          pages.back().insertRecords(records, next_record);
+      if (num_inserted == 0) {
+        pages.pop_back();
+        break;
+      }
+      page_record_counts.push_back(num_inserted);
+      next_record += num_inserted;
+    }
+
+    if (!pages.empty()) {
+      appendPages(pages.size(), &pages[0], page_numbers);
+      for (std::size_t i = 0; i < page_numbers.size(); ++i) {
+        for (std::size_t slot = 1; slot <= page_record_counts[i]; ++slot) {
+          const RecordId record_id = {page_numbers[i],
+                                      static_cast<SlotId>(slot), 0};
+          record_ids.push_back(record_id);
+        }
+      }
+    }
+    if (pages.size() < APPEND_RUN_PAGES && next_record < records.size()) {
+      const Page empty_page;
+      throw InsufficientSpaceException(Page::INVALID_NUMBER,
+                                       records[next_record].length(),
+                                       empty_page.getFreeSpace());
+    }
+  }
+}
+
+void PageFile::appendPages(const PageId num_pages, const Page* contents,
+                           std::vector<PageId>& page_numbers) {
+  page_numbers.clear();
+  if (num_pages == 0) {
+    return;
+  }
+  FileHeader header = readHeader();
+  const PageId first_page_number = header.num_pages;
+
+  // Number the new pages, skipping any slots reserved for directory pages.
+  PageId page_number = first_page_number;
+  while (page_numbers.size() < num_pages) {
+    if (!isDirectoryPage(page_number)) {
+      page_numbers.push_back(page_number);
+    }
+    ++page_number;
+  }
+  const PageId span = page_number - first_page_number;
+
+  // Link the pages in after the last used page in the file.
+  const PageId prev_page_number = findPreviousUsedPage(page_numbers.front());
+  PageId next_page_number;
+  if (prev_page_number == Page::INVALID_NUMBER) {
+    next_page_number = header.first_used_page;
+    header.first_used_page = page_numbers.front();
+  } else {
+    PageHeader prev_header = readPageHeader(prev_page_number);
+    next_page_number = prev_header.next_page_number;
+    prev_header.next_page_number = page_numbers.front();
+    writePageHeader(prev_page_number, prev_header);
+    PageDirectoryEntry prev_entry = readDirectoryEntry(prev_page_number);
+    prev_entry.next_page_number = page_numbers.front();
+    writeDirectoryEntry(prev_page_number, prev_entry);
+  }
+  if (next_page_number != Page::INVALID_NUMBER) {
+    PageDirectoryEntry next_entry = readDirectoryEntry(next_page_number);
+    next_entry.prev_page_number = page_numbers.back();
+    writeDirectoryEntry(next_page_number, next_entry);
+  }
+
+  // Lay out the whole run, directory pages included, in one buffer.
+  AlignedBuffer buffer(span * Page::SIZE);
+  Page* pages = reinterpret_cast<Page*>(buffer.get());
+  for (PageId i = 0; i < span; ++i) {
+    new (&pages[i]) Page();
+  }
+  // Entries for pages covered by the directory page before the run, which
+  // are contiguous in that directory page.
+  std::vector<PageDirectoryEntry> old_directory_entries;
+  std::vector<PageDirectoryEntry> entries(page_numbers.size());
+  for (std::size_t i = 0; i < page_numbers.size(); ++i) {
+    Page& page = pages[page_numbers[i] - first_page_number];
+    if (contents != NULL) {
+      page = contents[i];
+    }
+    page.set_page_number(page_numbers[i]);
+    page.set_next_page_number(i + 1 < page_numbers.size() ? page_numbers[i + 1]
+                                                          : next_page_number);
+    PageDirectoryEntry entry = {
+        i > 0 ? page_numbers[i - 1] : prev_page_number,
+        page.next_page_number(), page.getFreeSpace(), true /* used */,
+        0 /* reserved */, {}};
+    summarizePage(page, header, entry);
+    entries[i] = entry;
+    const PageId directory_page_number = directoryPageFor(page_numbers[i]);
+    if (directory_page_number < first_page_number) {
+      old_directory_entries.push_back(entry);
+    } else {
+      PageDirectoryEntry* directory_entries =
+          reinterpret_cast<PageDirectoryEntry*>(
+              &pages[directory_page_number - first_page_number].data_[0]);
+      directory_entries[page_numbers[i] - directory_page_number - 1] = entry;
+    }
+  }
+  if (!old_directory_entries.empty()) {
+    const PageId directory_page_number = directoryPageFor(page_numbers.front());
+    const std::size_t first_index =
+        page_numbers.front() - directory_page_number - 1;
+    writeBytes(&old_directory_entries[0],
+               old_directory_entries.size() * sizeof(PageDirectoryEntry),
+               pageHeaderPosition(directory_page_number) + sizeof(PageHeader) +
+               first_index * sizeof(PageDirectoryEntry));
+  }
+
+  header.num_pages += span;
+  reserveSpace(header, header.num_pages - 1);
+  if (compressed_) {
+    for (PageId i = 0; i < span; ++i) {
+      writePageSlot(first_page_number + i, pages[i],
+                    !isDirectoryPage(first_page_number + i));
+    }
+  } else {
+    writeBytes(pages, span * Page::SIZE, pagePosition(first_page_number));
+  }
+  for (std::size_t i = 0; i < page_numbers.size(); ++i) {
+    cacheDirectoryEntry(page_numbers[i], entries[i], true /* saved */);
+  }
+  writeHeader(header);
+}
+
+void PageFile::setZoneAttributes(const std::vector<ZoneAttribute>& attributes) {
+  if (attributes.size() > FileHeader::MAX_ZONE_ATTRIBUTES) {
+    throw BadZoneAttributeException(filename_, "too many attributes");
+  }
+  FileHeader header = readHeader();
+  for (std::size_t i = 0; i < FileHeader::MAX_ZONE_ATTRIBUTES; ++i) {
+    header.zone_attributes[i].type = ZoneAttribute::NONE;
+    header.zone_attributes[i].offset = 0;
+    if (i < attributes.size()) {
+      if (attributes[i].type != ZoneAttribute::INTEGER &&
+          attributes[i].type != ZoneAttribute::DOUBLE) {
+        throw BadZoneAttributeException(filename_, "unknown attribute type");
+      }
+      header.zone_attributes[i] = attributes[i];
+    }
+  }
+  writeHeader(header);
+
+  // Summarize the existing pages, a directory page at a time.
+  for (PageId directory_page_number = FIRST_DIRECTORY_PAGE;
+       directory_page_number < header.num_pages;
+       directory_page_number += DIRECTORY_ENTRIES + 1) {
+    std::vector<PageDirectoryEntry> entries =
+        cachedDirectoryPage(directory_page_number).entries;
+    for (std::size_t i = 0; i < DIRECTORY_ENTRIES; ++i) {
+      const PageId page_number = directory_page_number + 1 + i;
+      if (page_number >= header.num_pages) {
+        break;
+      }
+      if (entries[i].used) {
+        summarizePage(readPage(page_number, true /* allow_free */), header,
+                      entries[i]);
+      }
+    }
+    Page directory;
+    std::memcpy(&directory.data_[0], &entries[0],
+                DIRECTORY_ENTRIES * sizeof(PageDirectoryEntry));
+    writePage(directory_page_number, directory.header_, directory);
+    CachedDirectoryPage& cached = cachedDirectoryPage(directory_page_number);
+    cached.entries = entries;
+    cached.unsaved.assign(DIRECTORY_ENTRIES, false);
+    // Pages changed in the buffer pool were summarized as they are on disk.
+    for (std::size_t i = 0; i < DIRECTORY_ENTRIES; ++i) {
+      if (cached.zone_states[i] != CachedDirectoryPage::ZONES_WRITTEN) {
+        cached.zone_states[i] = CachedDirectoryPage::ZONES_STALE;
+      }
+    }
+  }
+}
+
+std::vector<ZoneAttribute> PageFile::zoneAttributes() const {
+  const FileHeader header = readHeader();
+  std::vector<ZoneAttribute> attributes;
+  for (std::size_t i = 0; i < FileHeader::MAX_ZONE_ATTRIBUTES &&
+       header.zone_attributes[i].type != ZoneAttribute::NONE; ++i) {
+    attributes.push_back(header.zone_attributes[i]);
+  }
+  return attributes;
+}
+
+void PageFile::setOverflowAttributes(OverflowFile* overflow,
+                                     const std::size_t offset,
+                                     const std::size_t count) {
+  metadata_->overflow = overflow;
+  metadata_->overflow_offset = offset;
+  metadata_->overflow_count = count;
+}
+
+std::string PageFile::storeOverflow(const std::string& record) {
+  if (metadata_->overflow == NULL) {
+    return record;
+  }
+  return metadata_->overflow->storeAttributes(
+      record, metadata_->overflow_offset, metadata_->overflow_count);
+}
+
+void PageFile::freeOverflow(const std::string& record,
+                            const std::string* kept) {
+  if (metadata_->overflow != NULL) {
+    metadata_->overflow->freeAttributes(record, metadata_->overflow_offset,
+                                        metadata_->overflow_count, kept);
+  }
+}
+
+void PageFile::summarizePage(const Page& page, const FileHeader& header,
+                             PageDirectoryEntry& entry) {
+  const double infinity = std::numeric_limits<double>::infinity();
+  for (std::size_t i = 0; i < FileHeader::MAX_ZONE_ATTRIBUTES; ++i) {
+    entry.zones[i].min = infinity;
+    entry.zones[i].max = -infinity;
+  }
+  if (header.zone_attributes[0].type == ZoneAttribute::NONE) {
+    return;
+  }
+  for (PageIterator iter = page.begin(); iter != page.end(); ++iter) {
+    const RecordView record = *iter;
+    for (std::size_t i = 0; i < FileHeader::MAX_ZONE_ATTRIBUTES &&
+         header.zone_attributes[i].type != ZoneAttribute::NONE; ++i) {
+      widenZone(entry.zones[i], zoneValue(header.zone_attributes[i],
+                                          record.data(), record.size()));
+    }
+  }
+}
+
+void PageFile::updateDirectoryEntry(const PageId page_number,
+                                    const Page& page, const bool save) {
+  const PageId directory_page_number = directoryPageFor(page_number);
+  const std::size_t index = page_number - directory_page_number - 1;
+  CachedDirectoryPage& cached = cachedDirectoryPage(directory_page_number);
+  const PageDirectoryEntry& entry = cached.entries[index];
+  PageDirectoryEntry new_entry = entry;
+  new_entry.free_space = page.getFreeSpace();
+  // A zone map kept up to date record by record needs no summarizing.
+  if (cached.zone_states[index] != CachedDirectoryPage::ZONES_TRACKED) {
+    summarizePage(page, metadata_->header, new_entry);
+  }
+  if (save && (cached.unsaved[index] ||
+               std::memcmp(&new_entry, &entry,
+                           sizeof(PageDirectoryEntry)) != 0)) {
+    writeDirectoryEntry(page_number, new_entry);
+  } else if (std::memcmp(&new_entry, &entry, sizeof(PageDirectoryEntry)) != 0) {
+    cacheDirectoryEntry(page_number, new_entry, false /* saved */);
+  }
+  cached.zone_states[index] = CachedDirectoryPage::ZONES_WRITTEN;
+}
+
+PageDirectoryEntry PageFile::readUsedDirectoryEntry(
+    const PageId page_number) const {
+  if (page_number == Page::INVALID_NUMBER || isDirectoryPage(page_number) ||
+      page_number >= readHeader().num_pages) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  const PageDirectoryEntry entry = readDirectoryEntry(page_number);
+  if (!entry.used) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  return entry;
+}
+
 FileIterator PageFile::begin() {
-  const FileHeader& header = readHeader();
-  return FileIterator(this, header.first_used_page);
+  return FileIterator(this);
 }
 
 FileIterator PageFile::end() {
@@ -315,39 +1188,298 @@ FileIterator PageFile::end() {
 
 void PageFile::writePage(const PageId page_number, const PageHeader& header,
                      const Page& new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(PageHeader));
-  stream_->write(&new_page.data_[0], Page::DATA_SIZE);
-  stream_->flush();
+  // Directory pages stay raw, so that their entries can be written in place.
+  const bool compress = !isDirectoryPage(page_number);
+  if (std::memcmp(&header, &new_page.header_, sizeof(PageHeader)) == 0) {
+    writePageSlot(page_number, new_page, compress);
+    return;
+  }
+  // Write header and data together, so that the page goes out in one request.
+  Page page = new_page;
+  page.header_ = header;
+  writePageSlot(page_number, page, compress);
 }
 
 PageHeader PageFile::readPageHeader(PageId page_number) const {
   PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(PageHeader));
+  readBytes(&header, sizeof(PageHeader), pageHeaderPosition(page_number));
   return header;
 }
 
+void PageFile::writePageHeader(const PageId page_number,
+                               const PageHeader& header) {
+  if (compressed_) {
+    // A slot never written has no room set aside for the header yet.
+    PageSlotHeader slot_header;
+    readBytes(&slot_header, sizeof(PageSlotHeader), pagePosition(page_number));
+    if (slot_header.encoding == PageSlotHeader::EMPTY) {
+      Page page;
+      page.header_ = header;
+      writePageSlot(page_number, page);
+      return;
+    }
+  }
+  writeBytes(&header, sizeof(PageHeader), pageHeaderPosition(page_number));
+}
+
+CachedDirectoryPage& PageFile::cachedDirectoryPage(
+    const PageId directory_page_number) const {
+  const std::size_t index =
+      (directory_page_number - FIRST_DIRECTORY_PAGE) / (DIRECTORY_ENTRIES + 1);
+  std::vector<CachedDirectoryPage>& directory = metadata_->directory;
+  if (index >= directory.size()) {
+    directory.resize(index + 1);
+  }
+  CachedDirectoryPage& cached = directory[index];
+  if (!cached.loaded) {
+    cached.entries.assign(DIRECTORY_ENTRIES, PageDirectoryEntry());
+    cached.unsaved.assign(DIRECTORY_ENTRIES, false);
+    cached.zone_states.assign(DIRECTORY_ENTRIES,
+                              CachedDirectoryPage::ZONES_WRITTEN);
+    cached.max_free_space = 0;
+    // A directory page past the end of the file has not been laid down yet,
+    // and describes no pages.
+    if (directory_page_number < metadata_->header.num_pages) {
+      const Page page = readPage(directory_page_number, true /* allow_free */);
+      std::memcpy(&cached.entries[0], &page.data_[0],
+                  DIRECTORY_ENTRIES * sizeof(PageDirectoryEntry));
+      for (std::size_t i = 0; i < DIRECTORY_ENTRIES; ++i) {
+        if (cached.entries[i].used) {
+          cached.max_free_space = std::max(cached.max_free_space,
+                                           cached.entries[i].free_space);
+        }
+      }
+    }
+    cached.loaded = true;
+  }
+  return cached;
+}
+
+void PageFile::cacheDirectoryEntry(const PageId page_number,
+                                   const PageDirectoryEntry& entry,
+                                   const bool saved) {
+  const PageId directory_page_number = directoryPageFor(page_number);
+  const std::size_t index = page_number - directory_page_number - 1;
+  CachedDirectoryPage& cached = cachedDirectoryPage(directory_page_number);
+  cached.entries[index] = entry;
+  cached.unsaved[index] = !saved;
+  if (entry.used) {
+    cached.max_free_space = std::max(cached.max_free_space, entry.free_space);
+  }
+}
+
+PageDirectoryEntry PageFile::readDirectoryEntry(const PageId page_number) const {
+  const PageId directory_page_number = directoryPageFor(page_number);
+  return cachedDirectoryPage(directory_page_number)
+      .entries[page_number - directory_page_number - 1];
+}
+
+void PageFile::writeDirectoryEntry(const PageId page_number,
+                                   const PageDirectoryEntry& entry) {
+  const PageId directory_page_number = directoryPageFor(page_number);
+  const std::size_t index = page_number - directory_page_number - 1;
+  writeBytes(&entry, sizeof(PageDirectoryEntry),
+             pageHeaderPosition(directory_page_number) + sizeof(PageHeader) +
+             index * sizeof(PageDirectoryEntry));
+  cacheDirectoryEntry(page_number, entry, true /* saved */);
+}
+
+PageId PageFile::findPreviousUsedPage(const PageId page_number) const {
+  PageId directory_page_number = directoryPageFor(page_number);
+  PageId end_page_number = page_number;
+  while (true) {
+    const std::vector<PageDirectoryEntry>& entries =
+        cachedDirectoryPage(directory_page_number).entries;
+    for (PageId i = end_page_number - 1; i > directory_page_number; --i) {
+      if (entries[i - directory_page_number - 1].used) {
+        return i;
+      }
+    }
+    if (directory_page_number == FIRST_DIRECTORY_PAGE) {
+      return Page::INVALID_NUMBER;
+    }
+    end_page_number = directory_page_number;
+    directory_page_number -= DIRECTORY_ENTRIES + 1;
+  }
+}
+
+
+
+
+MappedFile MappedFile::open(const std::string& filename,
+                            const AccessPattern pattern) {
+  return MappedFile(filename, pattern);
+}
+
+MappedFile::MappedFile(const std::string& name, const AccessPattern pattern)
+: PageFile(name, false /* create_new */),
+  pattern_(pattern),
+  mapping_(NULL),
+  mapping_size_(0)
+{
+  map();
+}
+
+MappedFile::MappedFile(const MappedFile& other)
+: PageFile(other),
+  pattern_(other.pattern_),
+  mapping_(NULL),
+  mapping_size_(0)
+{
+  map();
+}
+
+MappedFile& MappedFile::operator=(const MappedFile& rhs) {
+  if (this != &rhs) {
+    unmap();
+    PageFile::operator=(rhs);
+    pattern_ = rhs.pattern_;
+    map();
+  }
+  return *this;
+}
+
+MappedFile::~MappedFile() {
+  unmap();
+}
+
+void MappedFile::map() {
+  if (compressed_) {
+    throw FileIOException(filename_, EOPNOTSUPP);
+  }
+  const FileHeader header = readHeader();
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    throw FileIOException(filename_, errno);
+  }
+  // Only map whole pages which are in the file; touching the mapping past the
+  // end of the file would fault.
+  std::size_t size = pagePosition(header.num_pages);
+  if (static_cast<off_t>(size) > st.st_size) {
+    size = st.st_size;
+  }
+  if (size == 0) {
+    return;
+  }
+  void* mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, fd_, 0);
+  if (mapping == MAP_FAILED) {
+    throw FileIOException(filename_, errno);
+  }
+  mapping_ = static_cast<const char*>(mapping);
+  mapping_size_ = size;
+  advise(pattern_);
+}
+
+void MappedFile::unmap() {
+  if (mapping_ != NULL) {
+    munmap(const_cast<char*>(mapping_), mapping_size_);
+    mapping_ = NULL;
+    mapping_size_ = 0;
+  }
+}
+
+void MappedFile::advise(const AccessPattern pattern) {
+  pattern_ = pattern;
+  if (mapping_ == NULL) {
+    return;
+  }
+  int advice = MADV_NORMAL;
+  if (pattern == SEQUENTIAL) {
+    advice = MADV_SEQUENTIAL;
+  } else if (pattern == RANDOM) {
+    advice = MADV_RANDOM;
+  }
+  // Only a hint, so failure is not an error.
+  madvise(const_cast<char*>(mapping_), mapping_size_, advice);
+}
+
+const Page* MappedFile::pageAt(const PageId page_number) const {
+  if (page_number == Page::INVALID_NUMBER ||
+      pagePosition(page_number) + Page::SIZE > mapping_size_) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  const Page* page =
+      reinterpret_cast<const Page*>(mapping_ + pagePosition(page_number));
+  if (page->page_number() == Page::INVALID_NUMBER) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  return page;
+}
 
+Page MappedFile::allocatePage(PageId &new_page_number) {
+  throw ReadOnlyFileException(filename_);
+}
 
+void MappedFile::allocateExtent(const PageId num_pages,
+                                std::vector<PageId>& page_numbers) {
+  throw ReadOnlyFileException(filename_);
+}
 
-BlobFile BlobFile::create(const std::string& filename) {
-  return BlobFile(filename, true /* create_new */);
+void MappedFile::appendRecords(const std::vector<std::string>& records,
+                               std::vector<RecordId>& record_ids) {
+  throw ReadOnlyFileException(filename_);
 }
 
-BlobFile BlobFile::open(const std::string& filename) {
-  return BlobFile(filename, false /* create_new */);
+void MappedFile::setZoneAttributes(
+    const std::vector<ZoneAttribute>& attributes) {
+  throw ReadOnlyFileException(filename_);
 }
 
-BlobFile::BlobFile(const std::string& name, const bool create_new)
-: File(name, create_new) {
+Page MappedFile::readPage(const PageId page_number) const {
+  return *pageAt(page_number);
+}
+
+void MappedFile::readPageInto(const PageId page_number, Page& page) const {
+  page = *pageAt(page_number);
+}
+
+void MappedFile::readPagesInto(const PageId first_page_number,
+                               const std::vector<Page*>& pages) const {
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    *pages[i] = *pageAt(first_page_number + i);
+  }
+}
+
+void MappedFile::writePage(const PageId page_number, const Page& new_page) {
+  throw ReadOnlyFileException(filename_);
+}
+
+void MappedFile::deletePage(const PageId page_number) {
+  throw ReadOnlyFileException(filename_);
+}
+
+void MappedFile::readPageAsync(IoEngine& engine, const PageId page_number,
+                               Page* page) const {
+  *page = *pageAt(page_number);
+}
+
+void MappedFile::writePageAsync(IoEngine& engine, const PageId page_number,
+                                Page* page) {
+  throw ReadOnlyFileException(filename_);
+}
+
+
+
+
+BlobFile BlobFile::create(const std::string& filename, const bool direct_io,
+                       const bool compress) {
+  return BlobFile(filename, true /* create_new */, direct_io, compress);
+}
+
+BlobFile BlobFile::open(const std::string& filename, const bool direct_io) {
+  return BlobFile(filename, false /* create_new */, direct_io);
+}
+
+BlobFile::BlobFile(const std::string& name, const bool create_new,
+                   const bool direct_io, const bool compress)
+: File(name, create_new, direct_io, compress) {
 }
 
 BlobFile::~BlobFile() {
 }
 
 BlobFile::BlobFile(const BlobFile& other)
-: File(other.filename_, false /* create_new */)
+: File(other.filename_, false /* create_new */, other.direct_)
 {
 }
 
@@ -356,7 +1488,7 @@ BlobFile& BlobFile::operator=(const BlobFile& rhs) {
   // same file.
   close();	//close my file and associate me with the new one
   filename_ = rhs.filename_;
-  openIfNeeded(false /* create_new */);
+  openIfNeeded(false /* create_new */, rhs.direct_);
   return *this;
 }
 
@@ -372,6 +1504,7 @@ Page BlobFile::allocatePage(PageId &new_page_number) {
 
 	++header.num_pages;
 
+	reserveSpace(header, new_page_number);
 	writePage(new_page_number, new_page);
 	writeHeader(header);
 
@@ -380,15 +1513,16 @@ Page BlobFile::allocatePage(PageId &new_page_number) {
 
 Page BlobFile::readPage(const PageId page_number) const {
 	Page page;
-	stream_->seekg(pagePosition(page_number), std::ios::beg);
-	stream_->read(reinterpret_cast<char*>(&page), Page::SIZE);
+	readPageInto(page_number, page);
 	return page;
 }
 
+void BlobFile::readPageInto(const PageId page_number, Page& page) const {
+	readPageSlot(page_number, page);
+}
+
 void BlobFile::writePage(const PageId new_page_number, const Page& new_page) {
-	stream_->seekp(pagePosition(new_page_number), std::ios::beg);
-	stream_->write(reinterpret_cast<const char*>(&new_page), Page::SIZE);
-	stream_->flush();
+	writePageSlot(new_page_number, new_page);
 }
 
 //delePage should not be called for a blob_file, not supported
@@ -7,21 +7,98 @@
 
 #pragma once
 
-#include <fstream>
+#include <sys/types.h>
+#include <cstring>
 #include <string>
 #include <map>
 #include <memory>
+#include <vector>
 
 #include "page.h"
 
 namespace badgerdb {
 
 class FileIterator;
+class IoEngine;
+class OverflowFile;
+
+/**
+ * @brief Attribute of the records of a PageFile which the file keeps a zone
+ *        map for (see PageFile::setZoneAttributes).
+ */
+struct ZoneAttribute {
+  /**
+   * Type of the attribute: one of NONE, INTEGER and DOUBLE.
+   */
+  std::uint16_t type;
+
+  /**
+   * Offset of the attribute within each record, in bytes.
+   */
+  std::uint16_t offset;
+
+  /**
+   * No attribute declared.
+   */
+  static const std::uint16_t NONE = 0;
+
+  /**
+   * A native int.
+   */
+  static const std::uint16_t INTEGER = 1;
+
+  /**
+   * A native double.
+   */
+  static const std::uint16_t DOUBLE = 2;
+};
+
+/**
+ * @brief Range of values a zone attribute takes on one page.
+ *
+ * An empty page has <min> greater than <max>.  A page holding a record too
+ * short to have the attribute, or a NaN, has the range of all values, so that
+ * it is never skipped.
+ */
+struct PageZone {
+  /**
+   * Smallest value of the attribute on the page.
+   */
+  double min;
+
+  /**
+   * Largest value of the attribute on the page.
+   */
+  double max;
+
+  /**
+   * Returns true if the page may hold a value in [low, high].
+   *
+   * @param low   Lower bound, inclusive.
+   * @param high  Upper bound, inclusive.
+   */
+  bool overlaps(const double low, const double high) const {
+    return min <= high && max >= low;
+  }
+};
 
 /**
  * @brief Header metadata for files on disk which contain pages.
  */
 struct FileHeader {
+  /**
+   * FORMAT_VERSION for files in the current format.  Files in any other
+   * format are refused when opened.
+   */
+  std::uint32_t format_version;
+
+  /**
+   * Marks a BadgerDB file in its high half, and counts the changes to the
+   * layout of files and pages which old files can't be read with in its low
+   * half.
+   */
+  static const std::uint32_t FORMAT_VERSION = 0x42440003;
+
   /**
    * Number of pages allocated in the file.
    */
@@ -42,6 +119,49 @@ struct FileHeader {
    */
   PageId first_free_page;
 
+  /**
+   * ALIGNED_LAYOUT if the file uses the aligned layout, in which the header is
+   * padded to a full page so that every page starts at a multiple of
+   * Page::SIZE.  Direct I/O is only possible on files with the aligned layout.
+   */
+  std::uint32_t aligned_layout;
+
+  /**
+   * Value of aligned_layout marking the aligned layout.  Anything else means
+   * the packed layout, with page 1 straight after the header.
+   */
+  static const std::uint32_t ALIGNED_LAYOUT = 0x414c4e44;
+
+  /**
+   * Number of pages the file grows by at a time.  Whenever the file has to
+   * grow, space for this many pages is reserved from the filesystem in one
+   * go, so that pages allocated one after another are physically contiguous.
+   * 0 or 1 means no preallocation.
+   */
+  std::uint32_t extent_pages;
+
+  /**
+   * Nonzero if pages are stored compressed.  Compressed files use the aligned
+   * layout, and every page has a slot of Page::SIZE + File::DIRECT_IO_ALIGNMENT
+   * bytes, starting with a PageSlotHeader and the uncompressed page header,
+   * followed by the page data; only the blocks of the slot which hold data are
+   * written, and the rest of the slot is released to the filesystem, so
+   * reading a page only costs the blocks its compressed form takes.  Page
+   * directory pages are always stored raw.
+   */
+  std::uint32_t compressed;
+
+  /**
+   * Number of zone attributes a file can declare.
+   */
+  static const std::size_t MAX_ZONE_ATTRIBUTES = 2;
+
+  /**
+   * Attributes the page directory keeps zone maps for, declared ones first;
+   * the rest have type ZoneAttribute::NONE.
+   */
+  ZoneAttribute zone_attributes[MAX_ZONE_ATTRIBUTES];
+
   /**
    * Returns true if this file header is equal to the other.
    *
@@ -49,24 +169,183 @@ struct FileHeader {
    * @return  True if the other header is equal to this one.
    */
   bool operator==(const FileHeader& rhs) const {
-    return num_pages == rhs.num_pages &&
+    return format_version == rhs.format_version &&
+        num_pages == rhs.num_pages &&
         num_free_pages == rhs.num_free_pages &&
         first_used_page == rhs.first_used_page &&
-        first_free_page == rhs.first_free_page;
+        first_free_page == rhs.first_free_page &&
+        aligned_layout == rhs.aligned_layout &&
+        extent_pages == rhs.extent_pages &&
+        compressed == rhs.compressed &&
+        std::memcmp(zone_attributes, rhs.zone_attributes,
+                    sizeof(zone_attributes)) == 0;
   }
 };
 
+/**
+ * @brief Entry in a page directory page describing one data page of a
+ *        PageFile.
+ *
+ * Directory pages are interleaved with data pages at fixed positions, so the
+ * entry for any page can be located with arithmetic alone.  Besides the
+ * approximate free space of the page, each entry records the previous used
+ * page so that a page can be unlinked from the used list without walking it,
+ * and the page's zone map: the range of each of the file's zone attributes
+ * over its records, which lets scans skip pages that can't match.
+ */
+struct PageDirectoryEntry {
+  /**
+   * Number of the previous used page in the file, or Page::INVALID_NUMBER if
+   * this page is the head of the used list.
+   */
+  PageId prev_page_number;
+
+  /**
+   * Number of the next used page in the file, or Page::INVALID_NUMBER if
+   * this page is the tail of the used list.  The same as the next page
+   * pointer in the page's header on disk, so that a page can be written back
+   * without reading that header first.
+   */
+  PageId next_page_number;
+
+  /**
+   * Free space of the page in bytes as of the last time it was written.
+   */
+  std::uint16_t free_space;
+
+  /**
+   * Whether the page described by this entry is currently in use.
+   */
+  std::uint16_t used;
+
+  /**
+   * Unused.  Keeps the zones aligned without padding, so that entries can be
+   * compared and written out byte for byte.
+   */
+  std::uint32_t reserved;
+
+  /**
+   * Range of each zone attribute of the file over the page's records as of
+   * the last time the page was written, in the order of
+   * FileHeader::zone_attributes.
+   */
+  PageZone zones[FileHeader::MAX_ZONE_ATTRIBUTES];
+};
+
+/**
+ * @brief Header at the start of each page slot of a compressed file.
+ */
+struct PageSlotHeader {
+  /**
+   * How the page is stored in the slot: one of EMPTY, RAW and COMPRESSED.
+   */
+  std::uint32_t encoding;
+
+  /**
+   * Number of bytes following this header: the page header, then the page
+   * data, raw or compressed.
+   */
+  std::uint32_t length;
+
+  /**
+   * Slot never written; the page reads as zeros.
+   */
+  static const std::uint32_t EMPTY = 0;
+
+  /**
+   * Page stored as is, because compressing it would not save a block or it is
+   * a page directory page.
+   */
+  static const std::uint32_t RAW = 1;
+
+  /**
+   * Page data compressed with PageCodec, after the raw page header.
+   */
+  static const std::uint32_t COMPRESSED = 2;
+};
+
+/**
+ * @brief In-memory copy of a page directory page of a PageFile.
+ */
+struct CachedDirectoryPage {
+  /**
+   * True once the entries have been read from the file.
+   */
+  bool loaded;
+
+  /**
+   * Bound on the free space of the used pages described: no page has more.
+   * Raised as entries change, and lowered to the largest free space when
+   * PageFile::findPageWithSpace() finds no page with enough.
+   */
+  std::uint16_t max_free_space;
+
+  /**
+   * Entries for the pages the directory page describes, in page number order,
+   * with the free space of pages changed in the buffer pool and not yet
+   * written back.
+   */
+  std::vector<PageDirectoryEntry> entries;
+
+  /**
+   * For each entry, true if it has changed since it was written to the file.
+   */
+  std::vector<bool> unsaved;
+
+  /**
+   * How an entry's zone map stands against its page in the buffer pool.
+   */
+  enum ZoneState {
+    /**
+     * As summarized when the page was last written; no change to the page's
+     * records has been reported since.
+     */
+    ZONES_WRITTEN,
+
+    /**
+     * Kept up to date through PageFile::recordChanged() since; the page needs
+     * no summarizing when it is written.
+     */
+    ZONES_TRACKED,
+
+    /**
+     * Covers every record of the page but may be wider than they now are;
+     * the page is summarized when it is written.
+     */
+    ZONES_STALE
+  };
+
+  /**
+   * For each entry, how its zone map stands.
+   */
+  std::vector<ZoneState> zone_states;
+
+  CachedDirectoryPage() : loaded(false), max_free_space(0) {}
+};
+
 /**
  * @brief Class which represents a file in the filesystem containing database
  *        pages.
  *
- * The File class wraps a stream to an underlying file on disk.  Files contain
- * fixed-sized pages, and they never deallocate space (though they do reuse
- * deleted pages if possible).  If multiple File objects refer to the same
- * underlying file, they will share the stream in memory.
+ * The File class wraps a descriptor for an underlying file on disk.  Files
+ * contain fixed-sized pages, and they never deallocate space (though they do
+ * reuse deleted pages if possible).  If multiple File objects refer to the same
+ * underlying file, they will share the descriptor.
  * If a file that has already been opened (possibly by another query), then the File class
- * detects this (by looking in the open_streams_ map) and just returns a file object with
- * the already created stream for the file without actually opening the UNIX file again. 
+ * detects this (by looking in the open_fds_ map) and just returns a file object with
+ * the already opened descriptor for the file without actually opening the UNIX file again. 
+ *
+ * Files may be opened for direct I/O, which bypasses the operating system's
+ * page cache so that pages cached in the buffer pool are not cached twice.
+ * Direct I/O needs buffers and file offsets aligned to DIRECT_IO_ALIGNMENT,
+ * so it is only used for files created with the aligned layout; smaller or
+ * unaligned transfers (file header, page directory entries) are bounced
+ * through an aligned buffer.  Because File objects for the same file share a
+ * descriptor, the first one to open a file decides whether it uses direct I/O.
+ *
+ * Files may also store their pages compressed (see FileHeader::compressed).
+ * Pages are compressed on write and decompressed on read in this class, so
+ * callers, including the buffer manager, always see plain Pages.
  *
  * @warning This class is not threadsafe.
  */
@@ -74,18 +353,30 @@ struct FileHeader {
 
 class File {
  public:
+  /**
+   * Alignment in bytes of buffers, offsets and lengths for direct I/O.
+   */
+  static const std::size_t DIRECT_IO_ALIGNMENT = 4096;
 
   /**
    * Constructs a file object representing a file on the filesystem.
    *
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param direct_io   Whether to bypass the OS page cache.  New files get the
+   *                    aligned layout if this is set.  Falls back to buffered
+   *                    I/O if the file or filesystem does not allow it.
+   * @param compress    Whether a new file stores its pages compressed.
+   *                    Ignored when opening an existing file.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  FileFormatException     If the existing file is not in the
+   *                                  current format.
    */
-  File(const std::string& name, const bool create_new);
+  File(const std::string& name, const bool create_new,
+       const bool direct_io = false, const bool compress = false);
 
   /**
    * Deletes an existing file.
@@ -134,6 +425,29 @@ class File {
    */
   virtual Page readPage(const PageId page_number) const = 0;
 
+  /**
+   * Reads an existing page from the file straight into <page>, such as a
+   * buffer pool frame, without going through a temporary copy.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page to read into.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  virtual void readPageInto(const PageId page_number, Page& page) const = 0;
+
+  /**
+   * Reads the run of consecutive pages starting at <first_page_number>, one
+   * into each buffer of <pages>, using a single vectored read (preadv) where
+   * possible.  Pages past the end of the file read as zeros.
+   *
+   * @param first_page_number   Number of first page to read.
+   * @param pages               Buffers to read the pages into, in order.
+   * @throws  FileIOException   If the operating system reports an error.
+   */
+  virtual void readPagesInto(const PageId first_page_number,
+                             const std::vector<Page*>& pages) const;
+
   /**
    * Writes a page into the file at the given page number.
    * No bounds checking is performed.
@@ -150,6 +464,76 @@ class File {
    */
   virtual void deletePage(const PageId page_number) = 0;
 
+  /**
+   * Queues a read of an existing page into <page> on the given I/O engine.
+   * The contents of <page> are undefined until the engine reports the request
+   * complete; use checkPage() afterwards to validate what was read.
+   *
+   * @param engine        I/O engine to queue the request on.
+   * @param page_number   Number of page to read.
+   * @param page          Page to read into.  Must stay valid until completion.
+   * @throws  InvalidPageException  If the page doesn't exist in the file.
+   */
+  virtual void readPageAsync(IoEngine& engine, const PageId page_number,
+                             Page* page) const;
+
+  /**
+   * Queues a write of <page> to the given page number on the I/O engine.
+   * No bounds checking is performed.
+   *
+   * @param engine        I/O engine to queue the request on.
+   * @param page_number   Number of page whose contents to replace.
+   * @param page          Page to write.  Must stay valid until completion.
+   */
+  virtual void writePageAsync(IoEngine& engine, const PageId page_number,
+                              Page* page);
+
+  /**
+   * Returns true if <page>, filled in by readPageAsync(), holds the given
+   * page in a state that readPage() would have returned.
+   *
+   * @param page_number   Number of page that was read.
+   * @param page          Page contents read from disk.
+   */
+  virtual bool checkPage(const PageId page_number, const Page& page) const {
+    return true;
+  }
+
+  /**
+   * Notes that the given page, held in a buffer pool frame, has been changed
+   * and not yet written back.  The buffer manager calls this when the page is
+   * unpinned dirty.
+   *
+   * @param page_number   Number of page.
+   * @param page          Page as changed.
+   */
+  virtual void pageChanged(const PageId page_number, const Page& page) {}
+
+  /**
+   * Completes writes queued with writePageAsync(), once the engine has
+   * carried them out, by writing out any bookkeeping they changed.
+   */
+  virtual void finishWrites() {}
+
+  /**
+   * Returns true if pages of this file can be used in place through
+   * mappedPage() rather than being read into a buffer pool frame.
+   */
+  virtual bool isMapped() const { return false; }
+
+  /**
+   * Returns a pointer to the given page where it lies in memory, for files
+   * which are mapped into memory.  The page must not be modified.
+   *
+   * @param page_number   Number of page.
+   * @return  The page, or NULL if the file is not mapped.
+   * @throws  InvalidPageException  If the file is mapped but the page doesn't
+   *                                exist in it or is not currently used.
+   */
+  virtual const Page* mappedPage(const PageId page_number) const {
+    return NULL;
+  }
+
   /**
    * Returns the name of the file this object represents.
    *
@@ -157,6 +541,16 @@ class File {
    */
   const std::string& filename() const { return filename_; }
 
+  /**
+   * Returns true if I/O on this file bypasses the OS page cache.
+   */
+  bool isDirect() const { return direct_; }
+
+  /**
+   * Returns true if pages of this file are stored compressed.
+   */
+  bool isCompressed() const { return compressed_; }
+
  	/**
    * Returns pageid of first page in the file.
    *
@@ -164,6 +558,19 @@ class File {
    */
 	PageId getFirstPageNo();
 
+  /**
+   * Sets the number of pages the file grows by at a time.  The setting is
+   * kept in the file header, so it lasts for the life of the file.
+   *
+   * @param extent_pages  Pages per extent; 0 or 1 turns preallocation off.
+   */
+  void setExtentSize(const PageId extent_pages);
+
+  /**
+   * Returns the number of pages the file grows by at a time.
+   */
+  PageId extentSize() const;
+
  protected:
   /**
    * Returns the position of the page with the given number in the file (as an
@@ -172,36 +579,65 @@ class File {
    * @param page_number   Number of page.
    * @return  Position of page in file.
    */
-  static std::streampos pagePosition(const PageId page_number) {
-    return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
+  off_t pagePosition(const PageId page_number) const {
+    return first_page_offset_ + (off_t(page_number) - 1) * slot_size_;
+  }
+
+  /**
+   * Returns the position of the header of the page with the given number in
+   * the file.  Compressed files keep page headers uncompressed right after the
+   * PageSlotHeader, so they can be read and written on their own there too.
+   *
+   * @param page_number   Number of page.
+   * @return  Position of page header in file.
+   */
+  off_t pageHeaderPosition(const PageId page_number) const {
+    return pagePosition(page_number) +
+        (compressed_ ? sizeof(PageSlotHeader) : 0);
   }
 
   /**
    * Opens the underlying file named in filename_.
    * This method only opens the file if no other File objects exist that access
-   * the same filesystem file; otherwise, it reuses the existing stream.
+   * the same filesystem file; otherwise, it reuses the existing descriptor.
    *
    * @param create_new  Whether to create a new file.
+   * @param direct_io   Whether to open the file for direct I/O.
+   * @param compress    Whether a new file stores its pages compressed.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  void openIfNeeded(const bool create_new);
+  void openIfNeeded(const bool create_new, const bool direct_io,
+                    const bool compress = false);
+
+  /**
+   * Makes sure the filesystem has space allocated for pages up to and
+   * including <last_page_number>.  If the file has to grow, it grows by whole
+   * extents (see FileHeader::extent_pages), reserved with posix_fallocate so
+   * that the filesystem can place them contiguously.  Reservation is only an
+   * optimization: if the filesystem can't do it, writes extend the file as
+   * before.
+   *
+   * @param header            Current header of the file.
+   * @param last_page_number  Number of the last page about to be written.
+   */
+  void reserveSpace(const FileHeader& header, const PageId last_page_number);
 
   /**
-   * Closes the underlying file stream in <stream_>.
+   * Closes the underlying file descriptor in <fd_>.
    * This method only closes the file if no other File objects exist that access
    * the same file.
    */
   void close();
 
   /**
-   * Reads the header for this file from disk.
+   * Returns the header for this file, from the copy kept in memory.
    *
    * @return  The file header.
    */
-  FileHeader readHeader() const;
+  FileHeader readHeader() const { return metadata_->header; }
 
   /**
    * Writes the given header to the disk as the header for this file.
@@ -210,28 +646,190 @@ class File {
    */
   void writeHeader(const FileHeader& header);
 
-  typedef std::map<std::string, std::shared_ptr<std::fstream> > StreamMap;
+  /**
+   * Reads <length> bytes at <offset> in the file into <buffer>.  Bytes past
+   * the end of the file read as zero.  In direct I/O mode, unaligned requests
+   * go through an aligned bounce buffer.
+   *
+   * @throws  FileIOException   If the operating system reports an error.
+   */
+  void readBytes(void* buffer, const std::size_t length,
+                 const off_t offset) const;
+
+  /**
+   * Writes <length> bytes from <buffer> at <offset> in the file.  In direct
+   * I/O mode, unaligned requests read, patch and write back the enclosing
+   * aligned blocks.
+   *
+   * @throws  FileIOException   If the operating system reports an error.
+   */
+  void writeBytes(const void* buffer, const std::size_t length,
+                  const off_t offset);
+
+  /**
+   * Reads the whole page with the given number into <page>, decompressing it
+   * if the file is compressed.  No bounds checking is performed.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page to read into.
+   * @throws  FileIOException       If the operating system reports an error.
+   * @throws  InvalidPageException  If a compressed page is corrupt.
+   */
+  void readPageSlot(const PageId page_number, Page& page) const;
+
+  /**
+   * Writes the whole of <page> as the page with the given number, compressing
+   * its data if the file is compressed.  No bounds checking is performed.
+   *
+   * @param page_number   Number of page to write.
+   * @param page          Page to write.
+   * @param compress      False to store the page raw even in a compressed
+   *                      file, so that parts of it can be written in place.
+   * @throws  FileIOException   If the operating system reports an error.
+   */
+  void writePageSlot(const PageId page_number, const Page& page,
+                     const bool compress = true);
+
+  /**
+   * Reads the blocks of a compressed file's page slot that hold the page: the
+   * first block, and then as many more as its PageSlotHeader says it takes
+   * up.  The rest of the slot is left unread.
+   *
+   * @param page_number   Number of page to read.
+   * @param slot          Buffer of slot_size_ bytes to read into.
+   * @throws  FileIOException   If the operating system reports an error.
+   */
+  void readUsedSlot(const PageId page_number, char* slot) const;
+
+  /**
+   * Returns the number of bytes at the start of a compressed file's page slot
+   * which hold a page taking up <length> bytes after its PageSlotHeader: the
+   * blocks which are written and read.
+   *
+   * @param length  PageSlotHeader::length of the page.
+   */
+  static std::size_t usedSlotBytes(const std::size_t length) {
+    return (sizeof(PageSlotHeader) + length + DIRECT_IO_ALIGNMENT - 1) /
+        DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+  }
+
+  /**
+   * Decodes a compressed file's page slot read into memory.
+   *
+   * @param page_number   Number of page, for error reporting.
+   * @param slot          Contents of the slot.
+   * @param page          Page to decode into.
+   * @throws  InvalidPageException  If the slot is corrupt.
+   */
+  void decodePageSlot(const PageId page_number, const char* slot,
+                      Page& page) const;
+
+  /**
+   * Reads <length> bytes at <offset> with pread, retrying short reads.  Bytes
+   * past the end of the file read as zero.
+   *
+   * @throws  FileIOException   If the operating system reports an error.
+   */
+  void readFully(void* buffer, const std::size_t length,
+                 const off_t offset) const;
+
+  /**
+   * Writes <length> bytes at <offset> with pwrite, retrying short writes.
+   *
+   * @throws  FileIOException   If the operating system reports an error.
+   */
+  void writeFully(const void* buffer, const std::size_t length,
+                  const off_t offset);
+
+  /**
+   * @brief Metadata of an open file kept in memory: its header and, for a
+   *        PageFile, its page directory.  Like the descriptor, it is shared
+   *        by all File objects open on the file, and they keep it up to date
+   *        as they write the metadata, so it is only read from disk once.
+   */
+  struct Metadata {
+    /**
+     * Header of the file, as on disk.
+     */
+    FileHeader header;
+
+    /**
+     * Page directory pages read so far, in file order (see PageFile).
+     */
+    std::vector<CachedDirectoryPage> directory;
+
+    /**
+     * Companion file holding the records' long attributes, or NULL (see
+     * PageFile::setOverflowAttributes()).  Not owned.
+     */
+    OverflowFile* overflow;
+
+    /**
+     * Offset in each record of the first attribute kept in <overflow>.
+     */
+    std::size_t overflow_offset;
+
+    /**
+     * Number of attributes, one after another, kept in <overflow>.
+     */
+    std::size_t overflow_count;
+
+    Metadata() : overflow(NULL), overflow_offset(0), overflow_count(0) {}
+  };
+
+  typedef std::map<std::string, int> DescriptorMap;
   typedef std::map<std::string, int> CountMap;
+  typedef std::map<std::string, std::shared_ptr<Metadata> > MetadataMap;
 
   /**
-   * Streams for opened files.
+   * Descriptors for opened files.
    */
-  static StreamMap open_streams_;
+  static DescriptorMap open_fds_;
 
   /**
    * Counts for opened files.
    */
   static CountMap open_counts_;
 
+  /**
+   * Metadata of opened files.
+   */
+  static MetadataMap open_metadata_;
+
   /**
    * Name of the file this object represents.
    */
   std::string filename_;
 
   /**
-   * Stream for underlying filesystem object.
+   * Descriptor for underlying filesystem object, or -1 if closed.
+   */
+  int fd_;
+
+  /**
+   * True if <fd_> was opened for direct I/O.
    */
-  std::shared_ptr<std::fstream> stream_;
+  bool direct_;
+
+  /**
+   * Offset in the file of page number 1; depends on the file's layout.
+   */
+  off_t first_page_offset_;
+
+  /**
+   * True if pages are stored compressed.
+   */
+  bool compressed_;
+
+  /**
+   * Distance in bytes between the starts of consecutive pages in the file.
+   */
+  std::size_t slot_size_;
+
+  /**
+   * Metadata of the file, shared with the other File objects open on it.
+   */
+  std::shared_ptr<Metadata> metadata_;
 
   friend class FileIterator;
 };
@@ -243,33 +841,42 @@ class PageFile : public File {
    * Creates a new file.
    *
    * @param filename  Name of the file.
+   * @param direct_io Whether to bypass the OS page cache; the file is created
+   *                  with the aligned layout if set.
+   * @param compress  Whether to store pages compressed.
    * @throws  FileExistsException     If the requested file already exists.
    */
-  static PageFile create(const std::string& filename);
+  static PageFile create(const std::string& filename, const bool direct_io = false,
+                       const bool compress = false);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
-	 * It first checks if the file is already open. If so, then the new File object created uses the same input-output stream to read to or write fom
+	 * It first checks if the file is already open. If so, then the new File object created uses the same file descriptor to read to or write fom
 	 * that already open file. Reference count (open_counts_ static variable inside the File object) is incremented whenever an already open file is
-	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the stream associated with this File object are inserted into the
-	 * open_streams_ map.
+	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the descriptor associated with this File object are inserted into the
+	 * open_fds_ map.
    *
    * @param filename  Name of the file.
+   * @param direct_io Whether to bypass the OS page cache, if the file's layout
+   *                  allows it.
    * @throws  FileNotFoundException   If the requested file doesn't exist.
    */
-  static PageFile open(const std::string& filename);
+  static PageFile open(const std::string& filename, const bool direct_io = false);
 
   /**
    * Constructs a file object representing a file on the filesystem.
    *
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param direct_io   Whether to bypass the OS page cache.
+   * @param compress    Whether a new file stores its pages compressed.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  PageFile(const std::string& name, const bool create_new);
+  PageFile(const std::string& name, const bool create_new,
+           const bool direct_io = false, const bool compress = false);
 
   /**
    * Copy constructor.
@@ -300,6 +907,94 @@ class PageFile : public File {
    */
   Page allocatePage(PageId &new_page_number) override;
 
+  /**
+   * Allocates a run of new, empty pages at the end of the file, for callers
+   * which know they are about to fill several pages in order (bulk loads, a
+   * level of a B+ tree).  Free pages are not reused, so the pages are
+   * physically adjacent apart from any page directory pages in between, and
+   * follow each other in the file's used page list.  All pages are written
+   * with a single request.
+   *
+   * @param num_pages     Number of pages to allocate.
+   * @param page_numbers  Receives the numbers of the new pages, in order.
+   */
+  virtual void allocateExtent(const PageId num_pages,
+                              std::vector<PageId>& page_numbers);
+
+  /**
+   * Packs the given records, in order, into as few new pages as possible and
+   * appends the pages to the file as allocateExtent() does.  Pages are
+   * written APPEND_RUN_PAGES at a time, each run with a single request.
+   *
+   * @param records     Records to append.
+   * @param record_ids  Receives the IDs of the new records, in order.
+   * @throws  InsufficientSpaceException  If a record doesn't fit on an empty
+   *                                      page.  Records before it have been
+   *                                      appended.
+   */
+  virtual void appendRecords(const std::vector<std::string>& records,
+                             std::vector<RecordId>& record_ids);
+
+  /**
+   * Declares the attributes of the file's records to keep zone maps for,
+   * replacing any declared before, and summarizes every page of the file.
+   * From then on each page's zone map is refreshed whenever the page is
+   * written, and FileScan::setZoneRange() can skip pages by it.
+   *
+   * @param attributes  Attributes, at most FileHeader::MAX_ZONE_ATTRIBUTES.
+   * @throws  BadZoneAttributeException  If there are too many attributes or
+   *                                     one has an unknown type.
+   */
+  virtual void setZoneAttributes(const std::vector<ZoneAttribute>& attributes);
+
+  /**
+   * Returns the attributes the file keeps zone maps for.
+   *
+   * @return  Declared attributes, in order.
+   */
+  std::vector<ZoneAttribute> zoneAttributes() const;
+
+  /**
+   * Keeps the long attributes of the file's records in the given overflow
+   * file, for as long as this file is open.  Records inserted or updated
+   * through BufMgr hold <count> attributes encoded by
+   * OverflowFile::encodeAttribute() one after another from byte <offset>;
+   * those held inline and longer than OverflowFile::DEFAULT_THRESHOLD are
+   * moved out of line as the record is stored.  Out-of-line values of
+   * records deleted or updated through BufMgr are freed once no longer held.
+   *
+   * @param overflow  Overflow file, or NULL to stop.  Not owned; must stay
+   *                  open while this file is.
+   * @param offset    Offset of the first encoded attribute in each record.
+   * @param count     Number of encoded attributes.
+   */
+  void setOverflowAttributes(OverflowFile* overflow, const std::size_t offset,
+                             const std::size_t count);
+
+  /**
+   * Returns the overflow file set by setOverflowAttributes(), or NULL.
+   */
+  OverflowFile* overflowFile() const { return metadata_->overflow; }
+
+  /**
+   * Returns a record to store in place of <record>: the same, with its long
+   * inline attributes moved to the overflow file, if there is one.
+   *
+   * @param record  Record with attributes encoded as setOverflowAttributes()
+   *                describes.
+   * @return  Record to store.
+   */
+  std::string storeOverflow(const std::string& record);
+
+  /**
+   * Frees the out-of-line values of a record no longer stored, if there is
+   * an overflow file, except values <kept> still points to.
+   *
+   * @param record  Record no longer stored.
+   * @param kept    Record stored in its place, or NULL.
+   */
+  void freeOverflow(const std::string& record, const std::string* kept);
+
   /**
    * Reads an existing page from the file.
    *
@@ -310,6 +1005,28 @@ class PageFile : public File {
    */
   Page readPage(const PageId page_number) const override;
 
+  /**
+   * Reads an existing page from the file straight into <page>.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page to read into.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  void readPageInto(const PageId page_number, Page& page) const override;
+
+  /**
+   * Reads the run of consecutive pages starting at <first_page_number>, one
+   * into each buffer of <pages>, with a single vectored read where possible.
+   *
+   * @param first_page_number   Number of first page to read.
+   * @param pages               Buffers to read the pages into, in order.
+   * @throws  InvalidPageException  If any of the pages doesn't exist in the
+   *                                file or is not currently used.
+   */
+  void readPagesInto(const PageId first_page_number,
+                     const std::vector<Page*>& pages) const override;
+
   /**
    * Writes a page into the file at the given page number.
    * No bounds checking is performed.
@@ -323,9 +1040,94 @@ class PageFile : public File {
    * Deletes a page from the file.
    *
    * @param page_number   Number of page to delete.
+   * @throws  InvalidPageException  If the page is not a used page of the
+   *                                file.
    */
   void deletePage(const PageId page_number) override;
 
+  /**
+   * Queues a read of an existing page into <page> on the given I/O engine.
+   *
+   * @param engine        I/O engine to queue the request on.
+   * @param page_number   Number of page to read.
+   * @param page          Page to read into.  Must stay valid until completion.
+   * @throws  InvalidPageException  If the page doesn't exist in the file.
+   */
+  void readPageAsync(IoEngine& engine, const PageId page_number,
+                     Page* page) const override;
+
+  /**
+   * Queues a write of <page> on the given I/O engine.  As with writePage(),
+   * the next page pointer on disk is kept; it is copied into <page> from the
+   * page directory before the write is queued.  Nothing is read or written
+   * until the engine runs the request: the page's directory entry is only
+   * updated in memory, and goes out with its directory page in
+   * finishWrites().
+   *
+   * @param engine        I/O engine to queue the request on.
+   * @param page_number   Number of page whose contents to replace.
+   * @param page          Page to write.  Must stay valid until completion.
+   * @throws  InvalidPageException  If the page has been deleted.
+   */
+  void writePageAsync(IoEngine& engine, const PageId page_number,
+                      Page* page) override;
+
+  /**
+   * Writes out each page directory page holding entries changed since they
+   * were last written, a whole directory page at a time.
+   */
+  void finishWrites() override;
+
+  /**
+   * Returns true if <page> is the used page with the given number.
+   *
+   * @param page_number   Number of page that was read.
+   * @param page          Page contents read from disk.
+   */
+  bool checkPage(const PageId page_number, const Page& page) const override {
+    return page.page_number() == page_number;
+  }
+
+  /**
+   * Notes a page changed in the buffer pool, summarizing its free space and
+   * zone map into the cached page directory, so that findPageWithSpace() and
+   * scans skipping pages by zone see the change before the page is written
+   * back.
+   *
+   * @param page_number   Number of page.
+   * @param page          Page as changed.
+   */
+  void pageChanged(const PageId page_number, const Page& page) override;
+
+  /**
+   * Notes a single record put on or taken off a page held in a buffer pool
+   * frame, keeping the page's free space and zone map in the page directory
+   * up to date without summarizing the page again when it is written.  Zones
+   * always take in the added record.  Taking off a record which sets a bound
+   * of the zone map leaves the zone possibly too wide, never too narrow, and
+   * the page to be summarized when it is written.
+   *
+   * @param page_number   Number of page.
+   * @param page          Page as changed.
+   * @param removed       Record taken off the page, or NULL.
+   * @param added         Record put on the page, or NULL.
+   */
+  void recordChanged(const PageId page_number, const Page& page,
+                     const std::string* removed, const std::string* added);
+
+  /**
+   * Finds a used page which has at least the given amount of free space, as
+   * of the last time it was written or unpinned dirty in the buffer pool.
+   * Page directory pages whose pages are all known to have less space are
+   * skipped without looking at their entries.
+   *
+   * @param bytes   Free space required, in bytes.  Callers inserting a record
+   *                should include the space for a new slot.
+   * @return  Number of a page with enough space, or Page::INVALID_NUMBER if no
+   *          page in the file has enough space.
+   */
+  PageId findPageWithSpace(const std::size_t bytes) const;
+
   /**
    * Returns an iterator at the first page in the file.
    *
@@ -341,14 +1143,147 @@ class PageFile : public File {
    */
   FileIterator end();
 
+  /**
+   * Number of data pages described by each page directory page.
+   */
+  static const std::size_t DIRECTORY_ENTRIES =
+      Page::DATA_SIZE / sizeof(PageDirectoryEntry);
+
+  /**
+   * Number of pages appendRecords() fills before writing them out.
+   */
+  static const PageId APPEND_RUN_PAGES = 128;
+
  private:
+  /**
+   * Appends a run of new pages to the file and links them into the used page
+   * list, writing them and any page directory pages between them with a
+   * single request.
+   *
+   * @param num_pages     Number of pages to append.
+   * @param contents      Initial contents of the pages, or NULL for empty
+   *                      pages.  Page numbers and links are filled in.
+   * @param page_numbers  Receives the numbers of the new pages, in order.
+   */
+  void appendPages(const PageId num_pages, const Page* contents,
+                   std::vector<PageId>& page_numbers);
+
+  /**
+   * Computes the zone map of a page for the given file header's zone
+   * attributes into the page's directory entry.
+   *
+   * @param page    Page to summarize.
+   * @param header  File header.
+   * @param entry   Directory entry of the page.
+   */
+  static void summarizePage(const Page& page, const FileHeader& header,
+                            PageDirectoryEntry& entry);
+
+  /**
+   * Refreshes the free space and zone map of a page's directory entry after
+   * the page has been written, writing the entry out if it changed.
+   *
+   * @param page_number   Number of page.
+   * @param page          Page as written.
+   * @param save          Whether to write the entry out now, rather than
+   *                      leave it for finishWrites().
+   */
+  void updateDirectoryEntry(const PageId page_number, const Page& page,
+                            const bool save);
+
+  /**
+   * Returns the page directory entry of a data page which is in use, from the
+   * copy of the directory kept in memory.
+   *
+   * @param page_number   Number of page.
+   * @return  Directory entry of the page.
+   * @throws  InvalidPageException  If the page is not a used data page.
+   */
+  PageDirectoryEntry readUsedDirectoryEntry(const PageId page_number) const;
+
+  /**
+   * Number of the first page directory page in the file.  Directory page
+   * number <n> describes the DIRECTORY_ENTRIES pages which immediately follow
+   * it; the next directory page comes right after those.
+   */
+  static const PageId FIRST_DIRECTORY_PAGE = 1;
+
+  /**
+   * Returns true if the page with the given number is a page directory page.
+   *
+   * @param page_number   Number of page.
+   */
+  static bool isDirectoryPage(const PageId page_number) {
+    return (page_number - FIRST_DIRECTORY_PAGE) % (DIRECTORY_ENTRIES + 1) == 0;
+  }
+
+  /**
+   * Returns the number of the page directory page describing the given page.
+   *
+   * @param page_number   Number of a data page.
+   * @return  Number of its page directory page.
+   */
+  static PageId directoryPageFor(const PageId page_number) {
+    return page_number -
+        (page_number - FIRST_DIRECTORY_PAGE) % (DIRECTORY_ENTRIES + 1);
+  }
+
+  /**
+   * Returns the in-memory copy of the given page directory page, reading it
+   * from disk the first time it is needed.
+   *
+   * @param directory_page_number   Number of a page directory page.
+   * @return  Copy of the directory page, kept in the file's metadata.
+   */
+  CachedDirectoryPage& cachedDirectoryPage(
+      const PageId directory_page_number) const;
+
+  /**
+   * Returns the page directory entry of the given page, from the copy of the
+   * directory kept in memory.
+   *
+   * @param page_number   Number of a data page.
+   * @return  Directory entry of the page.
+   */
+  PageDirectoryEntry readDirectoryEntry(const PageId page_number) const;
+
+  /**
+   * Sets the page directory entry of the given page in the copy of the
+   * directory kept in memory.
+   *
+   * @param page_number   Number of a data page.
+   * @param entry         Directory entry.
+   * @param saved         Whether the entry is as written to disk.
+   */
+  void cacheDirectoryEntry(const PageId page_number,
+                           const PageDirectoryEntry& entry, const bool saved);
+
+  /**
+   * Writes the page directory entry of the given page to disk, and to the
+   * copy of the directory kept in memory.
+   *
+   * @param page_number   Number of a data page.
+   * @param entry         Directory entry to write.
+   */
+  void writeDirectoryEntry(const PageId page_number,
+                           const PageDirectoryEntry& entry);
+
+  /**
+   * Returns the highest-numbered used page before the given page, which is
+   * its predecessor in the used list.  Found by scanning the page directory
+   * backwards, so only directory pages are read.
+   *
+   * @param page_number   Number of page.
+   * @return  Number of previous used page, or Page::INVALID_NUMBER if none.
+   */
+  PageId findPreviousUsedPage(const PageId page_number) const;
 
   /**
    * Reads a page from the file.  If <allow_free> is not set, an exception
    * will be thrown if the page read from disk is not currently in use.
    *
-   * No bounds checking is performed; the underlying file stream will throw
-   * an exception if the page is past the end of the file.
+   * No bounds checking is performed; bytes past the end of the file read as
+   * zero, so such a page comes back free.
    *
    * @param page_number   Number of page to read.
    * @param allow_free    Whether to allow reading a free (unused) page.
@@ -379,9 +1314,218 @@ class PageFile : public File {
    */
   PageHeader readPageHeader(const PageId page_number) const;
 
+  /**
+   * Writes only the header of the given page to disk, leaving the record data
+   * and slot table untouched.  No bounds checking is performed.
+   *
+   * @param page_number   Number of page whose header is to be written.
+   * @param header        Header to write.
+   */
+  void writePageHeader(const PageId page_number, const PageHeader& header);
+
   friend class FileIterator;
 };
 
+/**
+ * @brief Read-only view of a PageFile through a memory mapping.
+ *
+ * Pages are used where they lie in the mapping instead of being copied into
+ * buffer pool frames: BufMgr::readPage() hands out pointers into the mapping
+ * for mapped files, and pinning and eviction do not apply to them.  Meant for
+ * read-only replicas; allocating, writing or deleting pages throws.  Files
+ * whose pages are stored compressed can't be mapped.  The
+ * mapping covers the pages in the file when it was opened, so pages other
+ * File objects allocate afterwards are not visible through it.
+ *
+ * @warning This class is not threadsafe.
+ */
+class MappedFile : public PageFile {
+ public:
+  /**
+   * How the mapping is expected to be accessed, passed on to the kernel as a
+   * readahead hint.
+   */
+  enum AccessPattern {
+    /** No particular pattern. */
+    NORMAL,
+    /** Pages read in order, as by a FileScan; read ahead aggressively. */
+    SEQUENTIAL,
+    /** Pages read in no particular order, as by B+ tree lookups; no readahead. */
+    RANDOM
+  };
+
+  /**
+   * Opens an existing PageFile and maps it into memory.
+   *
+   * @param filename  Name of the file.
+   * @param pattern   Expected access pattern.
+   * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  FileIOException         If the file can't be mapped, or is
+   *                                  compressed.
+   */
+  static MappedFile open(const std::string& filename,
+                         const AccessPattern pattern = NORMAL);
+
+  /**
+   * Constructs a mapped file object for an existing file on the filesystem.
+   *
+   * @param name      Name of file.
+   * @param pattern   Expected access pattern.
+   * @throws  FileNotFoundException   If the underlying file doesn't exist.
+   * @throws  FileIOException         If the file can't be mapped, or is
+   *                                  compressed.
+   */
+  MappedFile(const std::string& name, const AccessPattern pattern = NORMAL);
+
+  /**
+   * Copy constructor.  The copy has a mapping of its own.
+   *
+   * @param other File object to copy.
+   */
+  MappedFile(const MappedFile& other);
+
+  /**
+   * Assignment operator.
+   *
+   * @param rhs File object to assign.
+   * @return    Newly assigned file object.
+   */
+  MappedFile& operator=(const MappedFile& rhs);
+
+  /**
+   * Unmaps the file, and closes it if no other File objects are using it.
+   */
+  ~MappedFile();
+
+  /**
+   * Changes the access pattern hint for the whole mapping.
+   *
+   * @param pattern   Expected access pattern.
+   */
+  void advise(const AccessPattern pattern);
+
+  /**
+   * Returns a pointer to the given page in the mapping.
+   *
+   * @param page_number   Number of page.
+   * @return  The page.
+   * @throws  InvalidPageException  If the page doesn't exist in the mapping or
+   *                                is not currently used.
+   */
+  const Page* pageAt(const PageId page_number) const;
+
+  /**
+   * Throws ReadOnlyFileException; mapped files are read-only.
+   */
+  Page allocatePage(PageId &new_page_number) override;
+
+  /**
+   * Throws ReadOnlyFileException; mapped files are read-only.
+   */
+  void allocateExtent(const PageId num_pages,
+                      std::vector<PageId>& page_numbers) override;
+
+  /**
+   * Throws ReadOnlyFileException; mapped files are read-only.
+   */
+  void appendRecords(const std::vector<std::string>& records,
+                     std::vector<RecordId>& record_ids) override;
+
+  /**
+   * Throws ReadOnlyFileException; mapped files are read-only.
+   */
+  void setZoneAttributes(const std::vector<ZoneAttribute>& attributes) override;
+
+  /**
+   * Returns a copy of the given page from the mapping.
+   *
+   * @param page_number   Number of page to read.
+   * @return  The page.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  Page readPage(const PageId page_number) const override;
+
+  /**
+   * Copies the given page from the mapping into <page>.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page to read into.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  void readPageInto(const PageId page_number, Page& page) const override;
+
+  /**
+   * Copies the run of consecutive pages starting at <first_page_number> from
+   * the mapping, one into each buffer of <pages>.
+   *
+   * @param first_page_number   Number of first page to read.
+   * @param pages               Buffers to read the pages into, in order.
+   * @throws  InvalidPageException  If any of the pages doesn't exist in the
+   *                                file or is not currently used.
+   */
+  void readPagesInto(const PageId first_page_number,
+                     const std::vector<Page*>& pages) const override;
+
+  /**
+   * Throws ReadOnlyFileException; mapped files are read-only.
+   */
+  void writePage(const PageId page_number, const Page& new_page) override;
+
+  /**
+   * Throws ReadOnlyFileException; mapped files are read-only.
+   */
+  void deletePage(const PageId page_number) override;
+
+  /**
+   * Copies the given page from the mapping into <page> straight away; there
+   * is no device I/O to batch.
+   */
+  void readPageAsync(IoEngine& engine, const PageId page_number,
+                     Page* page) const override;
+
+  /**
+   * Throws ReadOnlyFileException; mapped files are read-only.
+   */
+  void writePageAsync(IoEngine& engine, const PageId page_number,
+                      Page* page) override;
+
+  bool isMapped() const override { return true; }
+
+  const Page* mappedPage(const PageId page_number) const override {
+    return pageAt(page_number);
+  }
+
+ private:
+  /**
+   * Maps the pages currently in the file and applies the access pattern hint.
+   *
+   * @throws  FileIOException   If the file can't be mapped.
+   */
+  void map();
+
+  /**
+   * Removes the mapping, if any.
+   */
+  void unmap();
+
+  /**
+   * Expected access pattern of the mapping.
+   */
+  AccessPattern pattern_;
+
+  /**
+   * Start of the mapping, or NULL if nothing is mapped.
+   */
+  const char* mapping_;
+
+  /**
+   * Length of the mapping in bytes.
+   */
+  std::size_t mapping_size_;
+};
+
 class BlobFile : public File {
  public:
 
@@ -389,21 +1533,27 @@ class BlobFile : public File {
    * Creates a new BlobFile.
    *
    * @param filename  Name of the file.
+   * @param direct_io Whether to bypass the OS page cache; the file is created
+   *                  with the aligned layout if set.
+   * @param compress  Whether to store pages compressed.
    * @throws  FileExistsException     If the requested file already exists.
    */
-  static BlobFile create(const std::string& filename);
+  static BlobFile create(const std::string& filename, const bool direct_io = false,
+                       const bool compress = false);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
-	 * It first checks if the file is already open. If so, then the new File object created uses the same input-output stream to read to or write fom
+	 * It first checks if the file is already open. If so, then the new File object created uses the same file descriptor to read to or write fom
 	 * that already open file. Reference count (open_counts_ static variable inside the File object) is incremented whenever an already open file is
-	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the stream associated with this File object are inserted into the
-	 * open_streams_ map.
+	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the descriptor associated with this File object are inserted into the
+	 * open_fds_ map.
    *
    * @param filename  Name of the file.
+   * @param direct_io Whether to bypass the OS page cache, if the file's layout
+   *                  allows it.
    * @throws  FileNotFoundException   If the requested file doesn't exist.
    */
-  static BlobFile open(const std::string& filename);
+  static BlobFile open(const std::string& filename, const bool direct_io = false);
 
   /**
    * Constructs a file object representing a file on the filesystem.
@@ -412,12 +1562,15 @@ class BlobFile : public File {
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param direct_io   Whether to bypass the OS page cache.
+   * @param compress    Whether a new file stores its pages compressed.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  BlobFile(const std::string& name, const bool create_new);
+  BlobFile(const std::string& name, const bool create_new,
+           const bool direct_io = false, const bool compress = false);
 
   /**
    * Copy constructor.
@@ -458,6 +1611,16 @@ class BlobFile : public File {
    */
   Page readPage(const PageId page_number) const override;
 
+  /**
+   * Reads an existing page from the file straight into <page>.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page to read into.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  void readPageInto(const PageId page_number, Page& page) const override;
+
   /**
    * Writes a page into the file at the given page number.
    * No bounds checking is performed.
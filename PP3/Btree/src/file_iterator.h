@@ -19,6 +19,14 @@ namespace badgerdb {
  *
  * This class provides a forward-only iterator for iterating over all of the
  * pages in a file.
+ *
+ * The used pages of a PageFile are linked in page number order, so the
+ * iterator finds the next used page in the page directory instead of reading
+ * the header of every page it passes.  It looks the directory up in the copy
+ * the file keeps in memory, so moving the iterator does no I/O, and pages can
+ * be iterated over by number (getCurrentPageNo()) and fetched through the
+ * buffer pool.  Since that copy is kept up to date, pages allocated after the
+ * current one while iterating are returned, and pages deleted are not.
  */
 class FileIterator {
  public:
@@ -39,8 +47,7 @@ class FileIterator {
   FileIterator(PageFile* file)
       : file_(file) {
     assert(file_ != NULL);
-    const FileHeader& header = file_->readHeader();
-    current_page_number_ = header.first_used_page;
+    current_page_number_ = file_->readHeader().first_used_page;
   }
 
   /**
@@ -59,9 +66,7 @@ class FileIterator {
    * Advances the iterator to the next page in the file.
    */
 	inline FileIterator& operator++() {
-    assert(file_ != NULL);
-    const PageHeader& header = file_->readPageHeader(current_page_number_);
-    current_page_number_ = header.next_page_number;
+    advance();
 
 		return *this;
 	}
@@ -71,27 +76,44 @@ class FileIterator {
 	{
 		FileIterator tmp = *this;   // copy ourselves
 
-    assert(file_ != NULL);
-    const PageHeader& header = file_->readPageHeader(current_page_number_);
-    current_page_number_ = header.next_page_number;
+    advance();
 
 		return tmp;
 	}
 
   /**
-   * Returns true if this iterator is equal to the given iterator.
+   * Returns true if this iterator is equal to the given iterator.  Iterators
+   * over File objects for the same underlying file, which share a
+   * descriptor, are at the same position if they are at the same page.
    *
    * @param rhs   Iterator to compare against.
    * @return    True if other iterator is equal to this one.
    */
 	inline bool operator==(const FileIterator& rhs) const {
-    return file_->filename() == rhs.file_->filename() &&
-        current_page_number_ == rhs.current_page_number_;
+    return current_page_number_ == rhs.current_page_number_ &&
+        fileId() == rhs.fileId();
   }
 
 	inline bool operator!=(const FileIterator& rhs) const {
-    return (file_->filename() != rhs.file_->filename()) ||
-        (current_page_number_ != rhs.current_page_number_);
+    return !(*this == rhs);
+  }
+
+  /**
+   * Returns the number of the page the iterator is at, without reading it.
+   *
+   * @return  Page number, or Page::INVALID_NUMBER at the end of the file.
+   */
+  PageId getCurrentPageNo() const { return current_page_number_; }
+
+  /**
+   * Returns the page directory entry of the current page, which tells its
+   * zone map among other things.
+   *
+   * @return  Directory entry of the current page.
+   */
+  PageDirectoryEntry getDirectoryEntry() const {
+    assert(current_page_number_ != Page::INVALID_NUMBER);
+    return file_->readDirectoryEntry(current_page_number_);
   }
 
   /**
@@ -104,6 +126,30 @@ class FileIterator {
   { return file_->readPage(current_page_number_); }
 
  private:
+  /**
+   * Identifies the underlying file: the descriptor shared by all File objects
+   * for it, or -1 for an empty iterator.
+   */
+  int fileId() const { return file_ != NULL ? file_->fd_ : -1; }
+
+  /**
+   * Moves to the next used page after the current one, as recorded in the
+   * page directory, or to Page::INVALID_NUMBER if there is none.
+   */
+  void advance() {
+    assert(file_ != NULL);
+    const PageId num_pages = file_->readHeader().num_pages;
+    for (PageId page_number = current_page_number_ + 1;
+         page_number < num_pages; ++page_number) {
+      if (!PageFile::isDirectoryPage(page_number) &&
+          file_->readDirectoryEntry(page_number).used) {
+        current_page_number_ = page_number;
+        return;
+      }
+    }
+    current_page_number_ = Page::INVALID_NUMBER;
+  }
+
   /**
    * File we're iterating over.
    */
@@ -6,17 +6,70 @@
  */
 
 #include "filescan.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "exceptions/bad_scan_param_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/read_only_file_exception.h"
 
 namespace badgerdb { 
 
+const std::size_t SharedScanManager::DEFAULT_RETAINED_PAGES;
+
 FileScan::FileScan(const std::string &name, BufMgr *bufferMgr)
 {
   file = new PageFile(name, false);	//dont create new file
+  ownsFile = true;
+  mode = WRITE_BACK;
 	bufMgr = bufferMgr;
 	curDirtyFlag = false;
   curPage = NULL;
 	filePageIter = file->begin();
+  zoneAttribute = -1;
+  zoneLow = zoneHigh = 0;
+  overflowFile = NULL;
+  sharedManager = NULL;
+  startPage = Page::INVALID_NUMBER;
+  wrapped = false;
+}
+
+FileScan::FileScan(PageFile *scanFile, BufMgr *bufferMgr, ScanMode scanMode)
+{
+  file = scanFile;
+  ownsFile = false;
+  mode = scanMode;
+	bufMgr = bufferMgr;
+	curDirtyFlag = false;
+  curPage = NULL;
+	filePageIter = file->begin();
+  zoneAttribute = -1;
+  zoneLow = zoneHigh = 0;
+  overflowFile = NULL;
+  sharedManager = NULL;
+  startPage = Page::INVALID_NUMBER;
+  wrapped = false;
+}
+
+FileScan::FileScan(const std::string &name, SharedScanManager *manager)
+{
+  file = manager->getFile(name);
+  ownsFile = false;
+  mode = READ_ONLY;
+	bufMgr = manager->bufMgr;
+	curDirtyFlag = false;
+  curPage = NULL;
+	filePageIter = file->begin();
+  zoneAttribute = -1;
+  zoneLow = zoneHigh = 0;
+  overflowFile = NULL;
+  sharedManager = manager;
+  relationName = name;
+  startPage = Page::INVALID_NUMBER;
+  wrapped = false;
+  manager->relations[name].scans.push_back(this);
 }
 
 FileScan::~FileScan()
@@ -24,19 +77,98 @@ FileScan::~FileScan()
   // generally must unpin last page of the scan
   if (curPage != NULL)
   {
-    bufMgr->unPinPage(file, (*filePageIter).page_number(), curDirtyFlag);
+    bufMgr->unPinPage(file, filePageIter.getCurrentPageNo(), curDirtyFlag);
     curPage = NULL;
 		curDirtyFlag = false;
     filePageIter = file->begin();
   }
-  bufMgr->flushFile(file);
-  delete file;
+  if (ownsFile)
+  {
+    // pages in the buffer pool are keyed by the File object, which is going
+    bufMgr->flushFile(file);
+    delete file;
+  }
+  else if (mode == WRITE_BACK)
+  {
+    bufMgr->writeFile(file);
+  }
+  if (sharedManager != NULL)
+  {
+    releaseSharedPages();
+    std::vector<FileScan*>& scans = sharedManager->relations[relationName].scans;
+    scans.erase(std::find(scans.begin(), scans.end(), this));
+  }
 }
 
 void FileScan::scanNext(RecordId& outRid)
 {
-  std::string rec;
+  nextRecord(outRid);
+  if (predicate.empty())
+  {
+    return;
+  }
+  // test records in place, so that only matching ones are ever copied
+  while (!predicate.matches(*pageRecordIter))
+  {
+    nextRecord(outRid);
+  }
+}
+
+void FileScan::scanNextBatch(RecordBatch& batch, std::size_t maxRows)
+{
+  if (maxRows == 0)
+  {
+    throw BadScanParamException();
+  }
+  batch.reset(maxRows);
+
+  // the first row may be on a later page; scanNext finds it
+  RecordId rid;
+  scanNext(rid);
+
+  if (curPage->isPax())
+  {
+    // a PAX page assembles each record in the iterator, so keep copies
+    batch.append(rid, *pageRecordIter, true);
+    while (batch.size() < maxRows)
+    {
+      ++pageRecordIter;
+      if (pageRecordIter.getCurrentRecord().slot_number == Page::INVALID_SLOT)
+      {
+        // at the end of the page; scanNext will move on from here
+        break;
+      }
+      const RecordView record = *pageRecordIter;
+      if (predicate.empty() || predicate.matches(record))
+      {
+        batch.append(
+            curPage->getHomeRecordId(pageRecordIter.getCurrentRecord()),
+            record, true);
+      }
+    }
+    batch.finish();
+    return;
+  }
+
+  // the rest come from the same page, so earlier views stay valid, and are
+  // taken from it directly rather than a record at a time
+  batch.append(rid, *pageRecordIter, false);
+  const SlotId lastSlot = batch.appendFromPage(
+      *curPage, pageRecordIter.getCurrentRecord().slot_number, maxRows,
+      predicate);
+  // at the end of the page, scanNext will move on from here
+  const RecordId position = {curPage->page_number(), lastSlot, 0};
+  pageRecordIter = PageIterator(curPage, position);
+  batch.finish();
+}
 
+void FileScan::setPredicate(const ScanPredicate& scanPredicate)
+{
+  predicate = scanPredicate;
+}
+
+void FileScan::nextRecord(RecordId& outRid)
+{
   if (filePageIter == file->end())
 	{
 		throw EndOfFileException();
@@ -46,25 +178,24 @@ void FileScan::scanNext(RecordId& outRid)
   if (curPage == NULL)
   {
     // need to get the first page of the file
-		filePageIter = file->begin();
+		filePageIter = firstPage();
+    settlePage();
     if(filePageIter == file->end())
 		{
 			throw EndOfFileException();
 		}
 	 
 		// read the first page of the file
-    bufMgr->readPage(file, (*filePageIter).page_number(), curPage); 
+    bufMgr->readPage(file, filePageIter.getCurrentPageNo(), curPage); 
 		curDirtyFlag = false;
+    sharePage();
 
 		// get the first record off the page
     pageRecordIter = curPage->begin(); 
 
 		if(pageRecordIter != curPage->end()) 
 		{
-		  // get pointer to record
-		  rec = *pageRecordIter;
-
-			outRid = pageRecordIter.getCurrentRecord();
+			outRid = curPage->getHomeRecordId(pageRecordIter.getCurrentRecord());
 			return;
 		}
   }
@@ -76,11 +207,12 @@ void FileScan::scanNext(RecordId& outRid)
   while (pageRecordIter == curPage->end())
   {
     // unpin the current page
-    bufMgr->unPinPage(file, (*filePageIter).page_number(), curDirtyFlag);
+    bufMgr->unPinPage(file, filePageIter.getCurrentPageNo(), curDirtyFlag);
     curPage = NULL;
     curDirtyFlag = false;
 
     filePageIter++;
+    settlePage();
     if (filePageIter == file->end())
     {
       curPage = NULL;
@@ -88,32 +220,320 @@ void FileScan::scanNext(RecordId& outRid)
     }
 
     // read the next page of the file
-    bufMgr->readPage(file, (*filePageIter).page_number(), curPage);
+    bufMgr->readPage(file, filePageIter.getCurrentPageNo(), curPage);
+    sharePage();
 
     // get the first record off the page
     pageRecordIter = curPage->begin(); 
   }
 
   // curRec points at a valid record
-  // see if the record satisfies the scan's predicate 
-  // get a pointer to the record
-  rec = *pageRecordIter;
-
-	// return rid of the record
-	outRid = pageRecordIter.getCurrentRecord();
+	// return rid of the record, which for a record moved here from another
+	// page is the id it keeps there
+	outRid = curPage->getHomeRecordId(pageRecordIter.getCurrentRecord());
 	return;
 }
 
-// returns pointer to the current record.  page is left pinned
-// and the scan logic is required to unpin the page 
+const Page* FileScan::scanNextPage()
+{
+  if (filePageIter == file->end())
+  {
+    throw EndOfFileException();
+  }
+
+  if (curPage == NULL)
+  {
+    filePageIter = firstPage();
+  }
+  else
+  {
+    // unpin the current page
+    bufMgr->unPinPage(file, filePageIter.getCurrentPageNo(), curDirtyFlag);
+    curPage = NULL;
+    curDirtyFlag = false;
+    filePageIter++;
+  }
+  settlePage();
+  if (filePageIter == file->end())
+  {
+    throw EndOfFileException();
+  }
+
+  bufMgr->readPage(file, filePageIter.getCurrentPageNo(), curPage);
+  sharePage();
+
+  // leave the record iterator at the end of the page, so that scanNext moves
+  // on to the next one
+  pageRecordIter = curPage->end();
+  return curPage;
+}
+
+// returns a copy of the current record
 std::string FileScan::getRecord()
+{
+  return getRecordView().toString();
+}
+
+// returns a view of the current record, without copying it.  page is left
+// pinned and the scan logic is required to unpin the page 
+RecordView FileScan::getRecordView()
 {
   return *pageRecordIter;
 }
 
+void FileScan::setZoneRange(std::size_t attribute, double low, double high)
+{
+  if (attribute >= file->zoneAttributes().size())
+  {
+    throw BadScanParamException();
+  }
+  zoneAttribute = attribute;
+  zoneLow = low;
+  zoneHigh = high;
+}
+
+void FileScan::readAttribute(std::size_t offset, std::size_t width, void *out)
+{
+  const RecordView record = getRecordView();
+  if (offset > record.size() || width > record.size() - offset)
+  {
+    throw BadScanParamException();
+  }
+  std::memcpy(out, record.data() + offset, width);
+}
+
+void FileScan::setOverflowFile(OverflowFile *overflow)
+{
+  overflowFile = overflow;
+}
+
+// decodes an attribute of the current record.  an attribute stored out of
+// line costs a read of its overflow chain, so scans which don't ask for it
+// never read it
+std::string FileScan::getAttribute(std::size_t offset)
+{
+  const RecordView record = getRecordView();
+  if (offset >= record.size())
+  {
+    throw BadScanParamException();
+  }
+  const char* attribute = record.data() + offset;
+  const std::size_t header = OverflowFile::isOutOfLine(attribute)
+      ? 1 + sizeof(OverflowPointer) : 1 + sizeof(std::uint32_t);
+  if (header > record.size() - offset ||
+      OverflowFile::encodedSize(attribute) > record.size() - offset)
+  {
+    throw BadScanParamException();
+  }
+  if (!OverflowFile::isOutOfLine(attribute))
+  {
+    return std::string(attribute + header,
+                       OverflowFile::encodedSize(attribute) - header);
+  }
+  if (overflowFile == NULL)
+  {
+    throw BadScanParamException();
+  }
+  return overflowFile->decodeAttribute(attribute);
+}
+
+FileIterator FileScan::firstPage()
+{
+  if (sharedManager != NULL)
+  {
+    // join a scan which is on a page, which is then in the buffer pool
+    const std::vector<FileScan*>& scans =
+        sharedManager->relations[relationName].scans;
+    for (std::size_t i = 0; i < scans.size(); i++)
+    {
+      if (scans[i] != this && scans[i]->curPage != NULL)
+      {
+        startPage = scans[i]->filePageIter.getCurrentPageNo();
+        return FileIterator(file, startPage);
+      }
+    }
+  }
+  return file->begin();
+}
+
+void FileScan::settlePage()
+{
+  skipExcludedPages();
+  if (startPage == Page::INVALID_NUMBER)
+  {
+    return;
+  }
+  // a scan which joined others goes on to the pages before its first
+  if (filePageIter == file->end() && !wrapped)
+  {
+    wrapped = true;
+    filePageIter = file->begin();
+    skipExcludedPages();
+  }
+  if (wrapped && filePageIter != file->end() &&
+      filePageIter.getCurrentPageNo() >= startPage)
+  {
+    filePageIter = file->end();
+  }
+}
+
+void FileScan::sharePage()
+{
+  if (sharedManager == NULL)
+  {
+    return;
+  }
+  SharedScanManager::Relation& relation =
+      sharedManager->relations[relationName];
+  const PageId pageNo = filePageIter.getCurrentPageNo();
+  std::map<PageId, std::vector<FileScan*> >::iterator kept =
+      relation.retained.find(pageNo);
+  if (kept != relation.retained.end())
+  {
+    // kept for the scans behind; this may be one of them
+    std::vector<FileScan*>& waiting = kept->second;
+    std::vector<FileScan*>::iterator self =
+        std::find(waiting.begin(), waiting.end(), this);
+    if (self != waiting.end())
+    {
+      waiting.erase(self);
+      if (waiting.empty())
+      {
+        bufMgr->unPinPage(file, pageNo, false);
+        relation.retained.erase(kept);
+      }
+    }
+    return;
+  }
+  if (relation.retained.size() >= sharedManager->maxRetained)
+  {
+    return;
+  }
+
+  std::vector<FileScan*> waiting;
+  for (std::size_t i = 0; i < relation.scans.size(); i++)
+  {
+    if (relation.scans[i] != this && relation.scans[i]->willScan(pageNo))
+    {
+      waiting.push_back(relation.scans[i]);
+    }
+  }
+  if (!waiting.empty())
+  {
+    // an extra pin keeps the page in the buffer pool until they get to it
+    Page* page;
+    bufMgr->readPage(file, pageNo, page);
+    relation.retained[pageNo] = waiting;
+  }
+}
+
+bool FileScan::willScan(const PageId pageNo)
+{
+  // a scan not on a page has yet to start, or has finished
+  if (curPage == NULL)
+  {
+    return false;
+  }
+  // pages after the current one, and for a scan which joined others and
+  // hasn't wrapped around yet, the pages before the one it started at
+  const PageId current = filePageIter.getCurrentPageNo();
+  bool ahead = pageNo > current;
+  if (startPage != Page::INVALID_NUMBER)
+  {
+    ahead = wrapped ? ahead && pageNo < startPage
+                    : ahead || pageNo < startPage;
+  }
+  if (!ahead || zoneAttribute < 0)
+  {
+    return ahead;
+  }
+  return FileIterator(file, pageNo).getDirectoryEntry().zones[zoneAttribute]
+      .overlaps(zoneLow, zoneHigh);
+}
+
+void FileScan::releaseSharedPages()
+{
+  std::map<PageId, std::vector<FileScan*> >& retained =
+      sharedManager->relations[relationName].retained;
+  std::map<PageId, std::vector<FileScan*> >::iterator kept = retained.begin();
+  while (kept != retained.end())
+  {
+    std::vector<FileScan*>& waiting = kept->second;
+    waiting.erase(std::remove(waiting.begin(), waiting.end(), this),
+                  waiting.end());
+    if (waiting.empty())
+    {
+      bufMgr->unPinPage(file, kept->first, false);
+      retained.erase(kept++);
+    }
+    else
+    {
+      ++kept;
+    }
+  }
+}
+
+SharedScanManager::SharedScanManager(BufMgr *bufferMgr,
+                                     std::size_t retainedPages)
+{
+  bufMgr = bufferMgr;
+  maxRetained = retainedPages;
+}
+
+SharedScanManager::~SharedScanManager()
+{
+  for (std::map<std::string, Relation>::iterator it = relations.begin();
+       it != relations.end(); ++it)
+  {
+    // a scan left behind would still have its page pinned
+    assert(it->second.scans.empty());
+    try
+    {
+      bufMgr->flushFile(it->second.file);
+    }
+    catch (...)
+    {
+      // pages of the file are still in the buffer pool, keyed by the File
+      // object, so it can't be deleted
+      continue;
+    }
+    delete it->second.file;
+  }
+}
+
+PageFile* SharedScanManager::getFile(const std::string &name)
+{
+  std::map<std::string, Relation>::iterator it = relations.find(name);
+  if (it == relations.end())
+  {
+    PageFile* file = new PageFile(name, false);	//dont create new file
+    it = relations.insert(std::make_pair(name, Relation())).first;
+    it->second.file = file;
+  }
+  return it->second.file;
+}
+
+void FileScan::skipExcludedPages()
+{
+  if (zoneAttribute < 0)
+  {
+    return;
+  }
+  while (filePageIter != file->end() &&
+         !filePageIter.getDirectoryEntry().zones[zoneAttribute].overlaps(
+             zoneLow, zoneHigh))
+  {
+    filePageIter++;
+  }
+}
+
 // mark current page of scan dirty
 void FileScan::markDirty()
 {
+  if (mode == READ_ONLY)
+  {
+    throw ReadOnlyFileException(file->filename());
+  }
   curDirtyFlag = true;
 }
 
@@ -8,41 +8,235 @@
 
 #pragma once
 
+#include <map>
 #include <string>
+#include <vector>
 #include "types.h"
 #include "page.h"
 #include "buffer.h"
 #include "file_iterator.h"
 #include "page_iterator.h"
+#include "record_batch.h"
+#include "overflow_file.h"
+#include "scan_predicate.h"
 
 namespace badgerdb {
 
+class FileScan;
+
+/**
+ * @brief Lets scans of the same relation share their reads.
+ *
+ * Scans opened through a manager share one PageFile per relation, so they
+ * find each other's pages in the buffer pool.  A scan starting while others
+ * of the relation are under way starts at the page one of them is on,
+ * reads to the end of the relation alongside it, then wraps around to the
+ * pages it missed.
+ *
+ * Scans needn't move in step for the reads to be shared.  When a scan reads
+ * a page which other scans of the relation have still to reach, the manager
+ * keeps the page pinned for them, and unpins it once the last of them has
+ * read it or been destroyed.  A scan running ahead thus reads each page for
+ * the scans behind it, up to a bound on the pages kept pinned per relation;
+ * past the bound, the scans behind read the pages again themselves.
+ *
+ * The manager must outlive its scans.  Shared scans are READ_ONLY.
+ */
+class SharedScanManager
+{
+ public:
+  /**
+   * Number of pages kept pinned per relation for scans behind by default.
+   */
+  static const std::size_t DEFAULT_RETAINED_PAGES = 16;
+
+  /**
+   * Constructs a manager whose scans read through the given buffer manager.
+   *
+   * @param bufMgr          Buffer manager.
+   * @param retainedPages   Most pages of each relation kept pinned for
+   *                        scans which have still to read them.
+   */
+  SharedScanManager(BufMgr *bufMgr,
+                    std::size_t retainedPages = DEFAULT_RETAINED_PAGES);
+
+  /**
+   * Flushes the relations from the buffer pool and closes them.  Every scan
+   * of the manager must have been destroyed first.  Does not throw: a
+   * relation which can't be flushed is left open.
+   */
+  ~SharedScanManager();
+
+  /**
+   * Returns the shared PageFile of the named relation, opening it if needed.
+   *
+   * @param name  Name of relation.
+   * @return  The relation's file.
+   */
+  PageFile* getFile(const std::string &name);
+
+ private:
+  /**
+   * A relation with open shared scans, or which had some.
+   */
+  struct Relation
+  {
+    Relation() : file(NULL) {}
+
+    /**
+     * File shared by the relation's scans.
+     */
+    PageFile                *file;
+
+    /**
+     * Scans of the relation still open.
+     */
+    std::vector<FileScan*>  scans;
+
+    /**
+     * Pages kept pinned by the manager, each with the scans which have still
+     * to read it.
+     */
+    std::map<PageId, std::vector<FileScan*> > retained;
+  };
+
+  /**
+   * Buffer manager the scans read through.
+   */
+	BufMgr				*bufMgr;
+
+  /**
+   * Most pages of each relation kept pinned for scans behind.
+   */
+  std::size_t   maxRetained;
+
+  /**
+   * Relations by name.
+   */
+  std::map<std::string, Relation> relations;
+
+  friend class FileScan;
+};
+
 /**
  * @brief This class is used to sequentially scan records in a relation.
+ *
+ * A scan opened by name has a File object of its own, so it flushes the
+ * relation from the buffer pool when it ends.  A scan of a PageFile the
+ * caller keeps open leaves its pages cached for later scans of the same
+ * PageFile.
  */
 class FileScan
 {
  public:
+  /**
+   * What a scan of a caller's PageFile does with the relation's pages when
+   * it ends.
+   */
+  enum ScanMode
+  {
+    READ_ONLY,  /* only unpin; markDirty is not allowed */
+    WRITE_BACK  /* write dirty pages back, keeping them cached */
+  };
 
   FileScan(const std::string &name, BufMgr *bufMgr);
 
+  //scans <file>, which must stay open until the scan is destroyed
+  FileScan(PageFile *file, BufMgr *bufMgr, ScanMode mode = READ_ONLY);
+
+  //scans the named relation as a shared scan of <manager>.  the scan
+  //returns every record once, but starting wherever other scans of the
+  //relation are and wrapping around, and reads pages kept for it by scans
+  //ahead of it
+  FileScan(const std::string &name, SharedScanManager *manager);
+
   ~FileScan();
 
   //return RecordId of next record that satisfies the scan 
   void scanNext(RecordId& outRid);
 
-  //read current record, returning pointer and length
+  //fills <batch> with up to <maxRows> of the next records that satisfy the
+  //scan, all from one page, which stays pinned; their views are valid until
+  //the scan moves on.  throws EndOfFileException when there are none left
+  void scanNextBatch(RecordBatch& batch, std::size_t maxRows);
+
+  //restricts the scan to records satisfying <predicate>, which is tested
+  //against the records in the buffer pool, so records failing it are never
+  //copied.  call before the scan starts
+  void setPredicate(const ScanPredicate& predicate);
+
+  //read current record, returning a copy of it
   std::string getRecord();
 
-  //marks current page of scan dirty
+  //view current record in place; valid until the scan moves to another page
+  //(on a PAX page, until the next scanNext)
+  RecordView getRecordView();
+
+  //moves the scan to the next whole page and returns it, still pinned and
+  //read-only, for callers which process a page at a time (e.g. columns of a
+  //PAX page); a following scanNext continues with the page after it
+  const Page* scanNextPage();
+
+  //marks current page of scan dirty.  throws ReadOnlyFileException in a
+  //READ_ONLY scan
   void markDirty();
 
+  //skips pages whose zone map says they hold no value of zone attribute
+  //<attribute> of the file in [low, high]; records of the pages scanned are
+  //all returned.  call before the scan starts
+  void setZoneRange(std::size_t attribute, double low, double high);
+
+  //copies the <width> bytes at <offset> of the current record into <out>,
+  //straight from the page, without copying the rest of the record.  throws
+  //BadScanParamException if the record is too short
+  void readAttribute(std::size_t offset, std::size_t width, void *out);
+
+  //returns the attribute of type T at <offset> of the current record, as
+  //readAttribute
+  template <typename T>
+  T getAttributeAs(std::size_t offset)
+  {
+    T value;
+    readAttribute(offset, sizeof(T), &value);
+    return value;
+  }
+
+  //sets the companion file holding the relation's out-of-line attributes
+  //(see OverflowFile); not owned by the scan
+  void setOverflowFile(OverflowFile *overflow);
+
+  //decodes the attribute encoded by OverflowFile::encodeAttribute at byte
+  //<offset> of the current record, reading it from the overflow file only
+  //if it is stored out of line
+  std::string getAttribute(std::size_t offset);
+
  private:
   /**
    * File which is being scanned.
    */
   PageFile      *file;
 
+  /**
+   * True if the scan opened file itself, and so must flush and close it.
+   */
+  bool          ownsFile;
+
+  ScanMode      mode;
+
+  /**
+   * Manager of a shared scan, else NULL.
+   */
+  SharedScanManager *sharedManager;
+  std::string   relationName;
+
+  /**
+   * Page a shared scan started at, if it joined other scans, else
+   * Page::INVALID_NUMBER; and whether it has wrapped around to the first
+   * page of the file since.
+   */
+  PageId        startPage;
+  bool          wrapped;
+
   /**
    * Buffer Manager instance used to read/write pages into/from buffer pool.
    */
@@ -51,11 +245,74 @@ class FileScan
   /**
    * Current page being scanned.
    */
-  Page*         curPage;
+  const Page*   curPage;
 
   FileIterator  filePageIter;
   PageIterator  pageRecordIter;
 
+  /**
+   * Zone attribute pages are skipped by, or -1 to scan every page.
+   */
+  int           zoneAttribute;
+
+  /**
+   * Range of values of the zone attribute the scan is after.
+   */
+  double        zoneLow;
+  double        zoneHigh;
+
+  /**
+   * File holding out-of-line attributes, or NULL if none was set.
+   */
+  OverflowFile  *overflowFile;
+
+  /**
+   * Predicate records returned must satisfy.
+   */
+  ScanPredicate predicate;
+
+  /**
+   * Moves to the next record of the file, whether it satisfies the predicate
+   * or not.
+   */
+  void nextRecord(RecordId& outRid);
+
+  /**
+   * Advances filePageIter past pages excluded by the zone range.
+   */
+  void skipExcludedPages();
+
+  /**
+   * Returns an iterator at the first page to scan: the first of the file,
+   * or for a shared scan the page of a scan of the relation under way.
+   */
+  FileIterator firstPage();
+
+  /**
+   * Moves filePageIter on from where it was just put to the next page to
+   * scan, or to the end once there are none left.
+   */
+  void settlePage();
+
+  /**
+   * For a shared scan which has just read the page at filePageIter: releases
+   * the page if the manager kept it for this scan, or else has the manager
+   * keep it for the other scans of the relation which have still to read it.
+   */
+  void sharePage();
+
+  /**
+   * Returns true if this scan is under way and has still to read the given
+   * page.
+   */
+  bool willScan(const PageId pageNo);
+
+  /**
+   * Stops the manager keeping pages for this scan, unpinning those no other
+   * scan is waiting for.
+   */
+  void releaseSharedPages();
+
   /**
    * True if page has been updated
    */
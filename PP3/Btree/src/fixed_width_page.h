@@ -0,0 +1,189 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include "page.h"
+#include "types.h"
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/invalid_record_exception.h"
+#include "exceptions/record_width_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Access to a page holding records which are all RECORD_SIZE bytes.
+ *
+ * A fixed-width page keeps a bitmap of occupied slots at the start of its data
+ * area, followed by the records in slot order, so a record's offset is
+ * computed from its slot number and there is no slot array entry per record.
+ * Pages stay ordinary Page objects: they are read and written through
+ * PageFile and BufMgr, record IDs are page and slot numbers as usual, and
+ * Page's record operations, PageIterator and FileScan work on them unchanged.
+ * This class is a cheaper way in for code that knows the record width at
+ * compile time.
+ *
+ * A FixedWidthPage does not own its page; it is only valid while the page is
+ * (e.g. while the page is pinned in the buffer pool).
+ *
+ * @warning This class is not threadsafe.
+ */
+template <std::size_t RECORD_SIZE>
+class FixedWidthPage {
+ public:
+  static_assert(RECORD_SIZE > 0 && RECORD_SIZE <= Page::DATA_SIZE / 2,
+                "Fixed-width pages must hold at least two records.");
+
+  /**
+   * Number of records a page holds.
+   */
+  static const std::size_t CAPACITY = Page::fixedCapacity(RECORD_SIZE);
+
+  /**
+   * Wraps the given page.  A page holding no records (e.g. one just returned
+   * by PageFile::allocatePage) is formatted for RECORD_SIZE records.
+   *
+   * @param page  Page to access.  Must not be null.
+   * @throws  RecordWidthException  If the page holds records of a different
+   *                                width, variable-length records, or is a
+   *                                PAX page.
+   */
+  explicit FixedWidthPage(Page* page)
+      : page_(page) {
+    assert(page_ != NULL);
+    if (page_->header_.record_width == RECORD_SIZE && !page_->isPax()) {
+      return;
+    }
+    if (page_->isFixedWidth() || page_->header_.num_slots != 0) {
+      throw RecordWidthException(page_->page_number(),
+                                 page_->header_.record_width, RECORD_SIZE);
+    }
+    page_->formatFixedWidth(RECORD_SIZE, CAPACITY);
+  }
+
+  /**
+   * Returns the page being accessed.
+   */
+  Page* page() const { return page_; }
+
+  /**
+   * Returns the number of records on the page.
+   */
+  std::size_t numRecords() const {
+    return CAPACITY - page_->header_.num_free_slots;
+  }
+
+  /**
+   * Returns true if the page has no free slot left.
+   */
+  bool isFull() const { return page_->header_.num_free_slots == 0; }
+
+  /**
+   * Copies a record into the lowest free slot.
+   *
+   * @param record_data   First of the RECORD_SIZE bytes of the record.
+   * @return  ID of the new record.
+   * @throws  InsufficientSpaceException  If the page is full.
+   */
+  RecordId insertRecord(const void* record_data) {
+    if (isFull()) {
+      throw InsufficientSpaceException(page_->page_number(), RECORD_SIZE, 0);
+    }
+    const SlotId slot_number = page_->fixedInsert(
+        static_cast<const char*>(record_data), RECORD_SIZE, CAPACITY);
+    const RecordId record_id = {page_->page_number(), slot_number, 0};
+    return record_id;
+  }
+
+  /**
+   * Returns a pointer to the record with the given ID, in the page.
+   *
+   * @param record_id   ID of record.
+   * @return  First of the RECORD_SIZE bytes of the record.
+   * @throws  InvalidRecordException  If the ID has a bad page or slot number.
+   */
+  const char* getRecord(const RecordId& record_id) const {
+    validateRecordId(record_id);
+    return recordAt(record_id.slot_number);
+  }
+
+  /**
+   * Overwrites the record with the given ID in place.
+   *
+   * @param record_id     ID of record.
+   * @param record_data   First of the RECORD_SIZE bytes of the new data.
+   * @throws  InvalidRecordException  If the ID has a bad page or slot number.
+   */
+  void updateRecord(const RecordId& record_id, const void* record_data) {
+    validateRecordId(record_id);
+    std::memcpy(const_cast<char*>(recordAt(record_id.slot_number)),
+                record_data, RECORD_SIZE);
+  }
+
+  /**
+   * Deletes the record with the given ID, freeing its slot.
+   *
+   * @param record_id   ID of record.
+   * @throws  InvalidRecordException  If the ID has a bad page or slot number.
+   */
+  void deleteRecord(const RecordId& record_id) {
+    validateRecordId(record_id);
+    page_->fixedDelete(record_id.slot_number, RECORD_SIZE, CAPACITY);
+  }
+
+  /**
+   * Returns the next used slot after the given slot, or Page::INVALID_SLOT if
+   * there is none.  Start at Page::INVALID_SLOT for the first used slot.
+   *
+   * @param start   Slot to start search at.
+   * @return  Next used slot after given slot or Page::INVALID_SLOT.
+   */
+  SlotId nextUsedSlot(const SlotId start) const {
+    return page_->fixedNextUsedSlot(start, CAPACITY);
+  }
+
+  /**
+   * Returns a pointer to the record in the given slot, without checking that
+   * the slot is used.
+   *
+   * @param slot_number   Number of slot.
+   * @return  First of the RECORD_SIZE bytes of the slot's record.
+   */
+  const char* recordAt(const SlotId slot_number) const {
+    return &page_->data_[Page::fixedRecordOffset(slot_number, RECORD_SIZE,
+                                                 CAPACITY)];
+  }
+
+ private:
+  /**
+   * Throws InvalidRecordException if the given ID does not refer to a used
+   * slot of this page.
+   *
+   * @param record_id   Record ID to validate.
+   */
+  void validateRecordId(const RecordId& record_id) const {
+    if (record_id.page_number != page_->page_number() ||
+        record_id.slot_number == Page::INVALID_SLOT ||
+        record_id.slot_number > CAPACITY ||
+        !page_->fixedSlotUsed(record_id.slot_number)) {
+      throw InvalidRecordException(record_id, page_->page_number());
+    }
+  }
+
+  /**
+   * Page being accessed.
+   */
+  Page* page_;
+};
+
+template <std::size_t RECORD_SIZE>
+const std::size_t FixedWidthPage<RECORD_SIZE>::CAPACITY;
+
+}
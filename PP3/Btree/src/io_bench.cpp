@@ -0,0 +1,334 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/**
+ * Page I/O benchmark.  Compares one-page-at-a-time reads and writes through
+ * PageFile with batches kept in flight by IoEngine at several queue depths,
+ * then scans the file through a buffer pool with buffered and with direct
+ * I/O, reporting the process's resident memory and how much of the file the
+ * OS page cache holds afterwards.  Finally compares reading pages through the
+ * buffer pool with using them in place through a MappedFile: time to open the
+ * file and get its first page, a sequential scan and random lookups.  Last,
+ * copies the file into a compressed one and compares the space each takes on
+ * disk and the time to scan each from the device.
+ *
+ * Usage: io_bench [file] [num_pages]
+ *
+ * Point <file> at a path on the device to be measured (e.g. a local NVMe
+ * mount).  The OS page cache is dropped for the file before every read pass,
+ * so reads go to the device.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "file.h"
+#include "io_engine.h"
+#include "page.h"
+#include "page_iterator.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+/**
+ * Writes back and evicts the file's pages from the OS page cache.
+ */
+void dropCache(const std::string& filename) {
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+  }
+}
+
+double seconds(const std::chrono::steady_clock::time_point& start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+void report(const std::string& label, const std::size_t num_pages,
+            const double elapsed) {
+  std::cout << label << ": " << num_pages * Page::SIZE / elapsed / (1 << 20)
+            << " MB/s (" << elapsed << " s)" << std::endl;
+}
+
+/**
+ * Returns the resident set size of this process in MB.
+ */
+double residentMB() {
+  long pages = 0;
+  long resident = 0;
+  std::FILE* statm = std::fopen("/proc/self/statm", "r");
+  if (statm != NULL) {
+    if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2) {
+      resident = 0;
+    }
+    std::fclose(statm);
+  }
+  return static_cast<double>(resident) * sysconf(_SC_PAGESIZE) / (1 << 20);
+}
+
+/**
+ * Returns how much of the file is in the OS page cache, in MB.
+ */
+double pageCacheMB(const std::string& filename) {
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return 0;
+  }
+  struct stat st;
+  double cached = 0;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map != MAP_FAILED) {
+      const long os_page_size = sysconf(_SC_PAGESIZE);
+      std::vector<unsigned char> in_core((st.st_size + os_page_size - 1) /
+                                         os_page_size);
+      if (mincore(map, st.st_size, &in_core[0]) == 0) {
+        for (std::size_t i = 0; i < in_core.size(); ++i) {
+          cached += (in_core[i] & 1) ? os_page_size : 0;
+        }
+      }
+      munmap(map, st.st_size);
+    }
+  }
+  close(fd);
+  return cached / (1 << 20);
+}
+
+/**
+ * Reads every page of the file through a buffer pool of <num_frames> frames,
+ * <run_pages> pages per call (readPage() if 1, readPages() otherwise).
+ */
+void scanThroughBufferPool(const std::string& filename, const bool direct_io,
+                           const std::vector<PageId>& page_numbers,
+                           const std::uint32_t num_frames,
+                           const std::size_t run_pages) {
+  dropCache(filename);
+  PageFile file = PageFile::open(filename, direct_io);
+  BufMgr buffer_manager(num_frames);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<PageId> run;
+  std::vector<Page*> pages;
+  for (std::size_t i = 0; i < page_numbers.size(); i += run_pages) {
+    if (run_pages == 1) {
+      Page* page;
+      buffer_manager.readPage(&file, page_numbers[i], page);
+      buffer_manager.unPinPage(&file, page_numbers[i], false /* dirty */);
+      continue;
+    }
+    run.assign(page_numbers.begin() + i,
+               page_numbers.begin() +
+               std::min(i + run_pages, page_numbers.size()));
+    buffer_manager.readPages(&file, run, pages);
+    for (std::size_t j = 0; j < run.size(); ++j) {
+      buffer_manager.unPinPage(&file, run[j], false /* dirty */);
+    }
+  }
+  report(std::string("buffer pool scan, ") +
+         (file.isDirect() ? "direct" : "buffered") + " I/O, " +
+         std::to_string(run_pages) + " page(s) per call",
+         page_numbers.size(), seconds(start));
+  std::cout << "  resident: " << residentMB() << " MB, page cache holds "
+            << pageCacheMB(filename) << " MB of the file" << std::endl;
+}
+
+/**
+ * Reads the given pages through a buffer pool of <num_frames> frames, from a
+ * PageFile or a MappedFile, and returns the number of records seen.  Reports
+ * the time to open the file and read its first page, then the whole run.
+ */
+std::size_t lookupPages(const std::string& filename, const bool mapped,
+                        const std::string& label,
+                        const std::vector<PageId>& page_numbers,
+                        const std::uint32_t num_frames) {
+  const MappedFile::AccessPattern pattern =
+      label == "scan" ? MappedFile::SEQUENTIAL : MappedFile::RANDOM;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::unique_ptr<File> file(mapped
+                             ? static_cast<File*>(new MappedFile(filename, pattern))
+                             : static_cast<File*>(new PageFile(filename, false)));
+  BufMgr buffer_manager(num_frames);
+  std::size_t num_records = 0;
+  for (std::size_t i = 0; i < page_numbers.size(); ++i) {
+    const Page* page;
+    buffer_manager.readPage(file.get(), page_numbers[i], page);
+    num_records += page->begin() != page->end();
+    buffer_manager.unPinPage(file.get(), page_numbers[i], false /* dirty */);
+    if (i == 0) {
+      std::cout << (mapped ? "mapped" : "buffer pool") << " " << label
+                << ": first page after " << seconds(start) * 1e6 << " us";
+    }
+  }
+  const double elapsed = seconds(start);
+  std::cout << ", " << page_numbers.size() / elapsed << " pages/s ("
+            << elapsed << " s)" << std::endl;
+  return num_records;
+}
+
+/**
+ * Reads every page of the file straight from the device and reports the time
+ * taken along with the space the file takes on disk.
+ */
+void scanFromDevice(const std::string& filename,
+                    const std::vector<PageId>& page_numbers) {
+  dropCache(filename);
+  PageFile file = PageFile::open(filename);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < page_numbers.size(); ++i) {
+    file.readPage(page_numbers[i]);
+  }
+  const double elapsed = seconds(start);
+  struct stat st;
+  const double on_disk_mb =
+      stat(filename.c_str(), &st) == 0 ? st.st_blocks * 512.0 / (1 << 20) : 0;
+  report(std::string(file.isCompressed() ? "compressed" : "plain") +
+         " file scan", page_numbers.size(), elapsed);
+  std::cout << "  " << on_disk_mb << " MB on disk" << std::endl;
+}
+
+}
+
+int main(int argc, char** argv) {
+  const std::string filename = argc > 1 ? argv[1] : "io_bench.db";
+  const std::size_t num_pages = argc > 2 ? std::strtoul(argv[2], NULL, 10)
+                                         : 8192;
+  const unsigned depths[] = {1, 8, 32, 64};
+
+  try {
+    File::remove(filename);
+  } catch (const FileNotFoundException&) {
+  }
+
+  std::vector<PageId> page_numbers;
+  {
+    // Aligned layout, so that the file can be opened for direct I/O later,
+    // but the batching comparison below goes through the page cache.
+    PageFile::create(filename, true /* direct_io */);
+    PageFile file = PageFile::open(filename);
+    const std::string record(Page::DATA_SIZE / 2, 'x');
+    for (std::size_t i = 0; i < num_pages; ++i) {
+      PageId page_number;
+      Page page = file.allocatePage(page_number);
+      page.insertRecord(record);
+      file.writePage(page_number, page);
+      page_numbers.push_back(page_number);
+    }
+    IoEngine engine;
+    std::cout << "io_uring: " << (engine.isAsync() ? "yes" : "no (pread/pwrite)")
+              << ", " << num_pages << " pages" << std::endl;
+
+    dropCache(filename);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < num_pages; ++i) {
+      file.readPage(page_numbers[i]);
+    }
+    report("read, one page per call", num_pages, seconds(start));
+
+    for (std::size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); ++d) {
+      IoEngine batch_engine(depths[d]);
+      std::vector<Page> pages(batch_engine.queueDepth());
+      dropCache(filename);
+      start = std::chrono::steady_clock::now();
+      for (std::size_t i = 0; i < num_pages; i += pages.size()) {
+        for (std::size_t j = 0; j < pages.size() && i + j < num_pages; ++j) {
+          file.readPageAsync(batch_engine, page_numbers[i + j], &pages[j]);
+        }
+        batch_engine.drain();
+      }
+      report("read, queue depth " + std::to_string(depths[d]), num_pages,
+             seconds(start));
+    }
+
+    std::vector<Page> pages;
+    for (std::size_t i = 0; i < num_pages; ++i) {
+      pages.push_back(file.readPage(page_numbers[i]));
+    }
+    start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < num_pages; ++i) {
+      file.writePage(page_numbers[i], pages[i]);
+    }
+    dropCache(filename);
+    report("write, one page per call", num_pages, seconds(start));
+
+    for (std::size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); ++d) {
+      IoEngine batch_engine(depths[d]);
+      start = std::chrono::steady_clock::now();
+      for (std::size_t i = 0; i < num_pages; ++i) {
+        file.writePageAsync(batch_engine, page_numbers[i], &pages[i]);
+      }
+      batch_engine.drain();
+      dropCache(filename);
+      report("write, queue depth " + std::to_string(depths[d]), num_pages,
+             seconds(start));
+    }
+  }
+
+  // A pool a quarter the size of the file, so that pages are evicted.
+  const std::uint32_t num_frames = num_pages / 4 > 0 ? num_pages / 4 : 1;
+  const std::size_t run_pages[] = {1, 64};
+  for (std::size_t r = 0; r < 2; ++r) {
+    scanThroughBufferPool(filename, false /* direct_io */, page_numbers,
+                          num_frames, run_pages[r]);
+    scanThroughBufferPool(filename, true /* direct_io */, page_numbers,
+                          num_frames, run_pages[r]);
+  }
+
+  // Warm the page cache first, so that only the copy into frames differs.
+  {
+    PageFile file = PageFile::open(filename);
+    for (std::size_t i = 0; i < page_numbers.size(); ++i) {
+      file.readPage(page_numbers[i]);
+    }
+  }
+  std::vector<PageId> shuffled(page_numbers);
+  std::srand(564);
+  std::random_shuffle(shuffled.begin(), shuffled.end());
+  const bool mapped[] = {false, true};
+  for (std::size_t m = 0; m < 2; ++m) {
+    lookupPages(filename, mapped[m], "scan", page_numbers, num_frames);
+    lookupPages(filename, mapped[m], "lookups", shuffled, num_frames);
+  }
+
+  const std::string compressed_filename = filename + ".lz";
+  try {
+    File::remove(compressed_filename);
+  } catch (const FileNotFoundException&) {
+  }
+  {
+    PageFile file = PageFile::open(filename);
+    PageFile compressed = PageFile::create(compressed_filename,
+                                           false /* direct_io */,
+                                           true /* compress */);
+    std::vector<PageId> copied;
+    compressed.allocateExtent(page_numbers.size(), copied);
+    for (std::size_t i = 0; i < page_numbers.size(); ++i) {
+      Page page = file.readPage(page_numbers[i]);
+      compressed.writePage(copied[i], page);
+    }
+    scanFromDevice(filename, page_numbers);
+    scanFromDevice(compressed_filename, copied);
+  }
+
+  File::remove(compressed_filename);
+  File::remove(filename);
+  return 0;
+}
@@ -0,0 +1,388 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "io_engine.h"
+
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#include "exceptions/file_io_exception.h"
+
+#if defined(__linux__) && !defined(BADGERDB_NO_IO_URING) && \
+    defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define BADGERDB_HAVE_IO_URING
+#endif
+#endif
+
+#ifdef BADGERDB_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace badgerdb {
+
+#ifdef BADGERDB_HAVE_IO_URING
+
+/**
+ * Shared submission and completion rings, mapped from the kernel.  glibc has
+ * no wrappers for the io_uring system calls, so they are made directly.
+ */
+struct IoEngine::Ring {
+  int fd;
+  unsigned entries;
+
+  void* sq_ptr;
+  std::size_t sq_size;
+  void* cq_ptr;
+  std::size_t cq_size;
+  io_uring_sqe* sqes;
+  std::size_t sqes_size;
+
+  unsigned* sq_head;
+  unsigned* sq_tail;
+  unsigned* sq_mask;
+  unsigned* sq_array;
+
+  unsigned* cq_head;
+  unsigned* cq_tail;
+  unsigned* cq_mask;
+  io_uring_cqe* cqes;
+};
+
+namespace {
+
+int ioUringSetup(const unsigned entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(const int fd, const unsigned to_submit,
+                 const unsigned min_complete, const unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                  min_complete, flags, NULL, 0));
+}
+
+}
+
+IoEngine::Ring* IoEngine::createRing(const unsigned queue_depth) {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  const int fd = ioUringSetup(queue_depth, &params);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  Ring* ring = new Ring;
+  ring->fd = fd;
+  ring->entries = params.sq_entries;
+  ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  ring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+  const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap && ring->cq_size > ring->sq_size) {
+    ring->sq_size = ring->cq_size;
+  }
+
+  ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  ring->cq_ptr = single_mmap ? ring->sq_ptr
+      : mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+  ring->sqes = static_cast<io_uring_sqe*>(
+      mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+  if (ring->sq_ptr == MAP_FAILED || ring->cq_ptr == MAP_FAILED ||
+      ring->sqes == MAP_FAILED) {
+    destroyRing(ring);
+    return NULL;
+  }
+
+  char* sq = static_cast<char*>(ring->sq_ptr);
+  ring->sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  ring->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  ring->sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  ring->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+  char* cq = static_cast<char*>(ring->cq_ptr);
+  ring->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  ring->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  ring->cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+  return ring;
+}
+
+void IoEngine::destroyRing(Ring* ring) {
+  if (ring->sqes != MAP_FAILED) {
+    munmap(ring->sqes, ring->sqes_size);
+  }
+  if (ring->cq_ptr != MAP_FAILED && ring->cq_ptr != ring->sq_ptr) {
+    munmap(ring->cq_ptr, ring->cq_size);
+  }
+  if (ring->sq_ptr != MAP_FAILED) {
+    munmap(ring->sq_ptr, ring->sq_size);
+  }
+  close(ring->fd);
+  delete ring;
+}
+
+#else
+
+struct IoEngine::Ring {
+  unsigned entries;
+};
+
+IoEngine::Ring* IoEngine::createRing(const unsigned queue_depth) {
+  return NULL;
+}
+
+void IoEngine::destroyRing(Ring* ring) {
+  delete ring;
+}
+
+#endif
+
+IoEngine::IoEngine(const unsigned queue_depth)
+    : queue_depth_(queue_depth > 0 ? queue_depth : 1),
+      ring_(createRing(queue_depth_)),
+      in_flight_(0),
+      error_code_(0) {
+  if (ring_ != NULL && ring_->entries < queue_depth_) {
+    queue_depth_ = ring_->entries;
+  }
+  requests_.resize(queue_depth_);
+  free_slots_.reserve(queue_depth_);
+  for (unsigned i = queue_depth_; i > 0; --i) {
+    free_slots_.push_back(i - 1);
+  }
+  queued_.reserve(queue_depth_);
+}
+
+IoEngine::~IoEngine() {
+  try {
+    drain();
+  } catch (...) {
+    // Nothing sensible to do with errors for requests nobody waited on.
+  }
+  if (ring_ != NULL) {
+    destroyRing(ring_);
+  }
+}
+
+void IoEngine::prepareRead(const int fd, const off_t offset, void* buffer,
+                           const std::size_t length,
+                           const std::string& filename) {
+  const Request request = {fd, false /* write */, offset,
+                           static_cast<char*>(buffer), length, filename};
+  prepare(request);
+}
+
+void IoEngine::prepareWrite(const int fd, const off_t offset,
+                            const void* buffer, const std::size_t length,
+                            const std::string& filename) {
+  const Request request = {fd, true /* write */, offset,
+                           const_cast<char*>(static_cast<const char*>(buffer)),
+                           length, filename};
+  prepare(request);
+}
+
+void IoEngine::prepare(const Request& request) {
+  while (queued_.size() + in_flight_ >= queue_depth_) {
+    if (!queued_.empty()) {
+      submit();
+    }
+    complete(1);
+  }
+  const unsigned slot = free_slots_.back();
+  free_slots_.pop_back();
+  requests_[slot] = request;
+  queued_.push_back(slot);
+}
+
+unsigned IoEngine::submit() {
+  const unsigned num_submitted = queued_.size();
+  if (num_submitted == 0) {
+    return 0;
+  }
+
+#ifdef BADGERDB_HAVE_IO_URING
+  if (ring_ != NULL) {
+    unsigned tail = *ring_->sq_tail;
+    for (std::size_t i = 0; i < queued_.size(); ++i) {
+      const Request& request = requests_[queued_[i]];
+      const unsigned index = tail & *ring_->sq_mask;
+      io_uring_sqe* sqe = &ring_->sqes[index];
+      std::memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = request.write ? IORING_OP_WRITE : IORING_OP_READ;
+      sqe->fd = request.fd;
+      sqe->off = request.offset;
+      sqe->addr = reinterpret_cast<unsigned long>(request.buffer);
+      sqe->len = request.length;
+      sqe->user_data = queued_[i];
+      ring_->sq_array[index] = index;
+      ++tail;
+    }
+    __atomic_store_n(ring_->sq_tail, tail, __ATOMIC_RELEASE);
+
+    // Requests count as in flight only once the kernel has taken them.
+    unsigned to_submit = num_submitted;
+    while (to_submit > 0) {
+      const int result = ioUringEnter(ring_->fd, to_submit, 0, 0);
+      if (result >= 0) {
+        in_flight_ += result;
+        to_submit -= result;
+        continue;
+      }
+      const int error_code = errno;
+      if (error_code == EINTR) {
+        continue;
+      }
+      const bool short_of_resources = error_code == EAGAIN ||
+                                      error_code == EBUSY;
+      if (short_of_resources && in_flight_ > 0 && reap(1) > 0) {
+        // Made room by reaping requests in flight; try again.
+        continue;
+      }
+
+      // The kernel can't take the rest.  Take them back off the ring, and
+      // carry them out synchronously if it only lacked resources, or fail
+      // them so that complete() reports the error.
+      __atomic_store_n(ring_->sq_tail, tail - to_submit, __ATOMIC_RELEASE);
+      for (std::size_t i = num_submitted - to_submit; i < num_submitted;
+           ++i) {
+        const Request& request = requests_[queued_[i]];
+        if (short_of_resources) {
+          perform(request, 0 /* done */);
+        } else {
+          recordError(request, error_code);
+        }
+        free_slots_.push_back(queued_[i]);
+      }
+      break;
+    }
+    queued_.clear();
+    return num_submitted;
+  }
+#endif
+
+  for (std::size_t i = 0; i < queued_.size(); ++i) {
+    perform(requests_[queued_[i]], 0 /* done */);
+    free_slots_.push_back(queued_[i]);
+  }
+  queued_.clear();
+  in_flight_ += num_submitted;
+  return num_submitted;
+}
+
+unsigned IoEngine::complete(const unsigned min_complete) {
+  unsigned num_reaped = 0;
+  if (ring_ != NULL) {
+    num_reaped = reap(min_complete);
+  } else {
+    // Requests were carried out when they were submitted.
+    num_reaped = in_flight_;
+    in_flight_ = 0;
+  }
+
+  if (error_code_ != 0) {
+    const int error_code = error_code_;
+    error_code_ = 0;
+    throw FileIOException(error_filename_, error_code);
+  }
+  return num_reaped;
+}
+
+unsigned IoEngine::reap(const unsigned min_complete) {
+  unsigned num_reaped = 0;
+#ifdef BADGERDB_HAVE_IO_URING
+  const unsigned wanted = min_complete < in_flight_ ? min_complete
+                                                    : in_flight_;
+  while (true) {
+    unsigned head = *ring_->cq_head;
+    const unsigned tail = __atomic_load_n(ring_->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+      const io_uring_cqe& cqe = ring_->cqes[head & *ring_->cq_mask];
+      const unsigned slot = static_cast<unsigned>(cqe.user_data);
+      const Request& request = requests_[slot];
+      if (cqe.res < 0) {
+        if (cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP ||
+            cqe.res == -EAGAIN || cqe.res == -EINTR) {
+          // Opcode not supported by this kernel, or a transient failure;
+          // carry the request out synchronously instead.
+          perform(request, 0 /* done */);
+        } else {
+          recordError(request, -cqe.res);
+        }
+      } else if (static_cast<std::size_t>(cqe.res) < request.length) {
+        perform(request, cqe.res);
+      }
+      free_slots_.push_back(slot);
+      --in_flight_;
+      ++num_reaped;
+      ++head;
+    }
+    __atomic_store_n(ring_->cq_head, head, __ATOMIC_RELEASE);
+
+    if (num_reaped >= wanted) {
+      break;
+    }
+    if (ioUringEnter(ring_->fd, 0, wanted - num_reaped,
+                     IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+      if (error_code_ == 0) {
+        error_code_ = errno;
+      }
+      break;
+    }
+  }
+#else
+  (void) min_complete;
+#endif
+  return num_reaped;
+}
+
+void IoEngine::drain() {
+  submit();
+  complete(in_flight_);
+}
+
+void IoEngine::perform(const Request& request, std::size_t done) {
+  while (done < request.length) {
+    const ssize_t result = request.write
+        ? pwrite(request.fd, request.buffer + done, request.length - done,
+                 request.offset + done)
+        : pread(request.fd, request.buffer + done, request.length - done,
+                request.offset + done);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      recordError(request, errno);
+      return;
+    }
+    if (result == 0) {
+      if (request.write) {
+        // A write which makes no progress would be retried forever.
+        recordError(request, EIO);
+      } else {
+        // Past the end of the file.
+        std::memset(request.buffer + done, 0, request.length - done);
+      }
+      return;
+    }
+    done += result;
+  }
+}
+
+void IoEngine::recordError(const Request& request, const int error_code) {
+  if (error_code_ == 0) {
+    error_code_ = error_code;
+    error_filename_ = request.filename;
+  }
+}
+
+}
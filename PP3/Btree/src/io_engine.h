@@ -0,0 +1,259 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace badgerdb {
+
+/**
+ * @brief Engine which carries out batches of file reads and writes.
+ *
+ * Requests are queued with prepareRead() and prepareWrite(), handed to the
+ * kernel together by submit(), and reaped with complete().  On Linux the
+ * engine keeps up to queueDepth() requests in flight through io_uring.  If
+ * io_uring is unavailable (old kernel, blocked by a sandbox, or the build
+ * defines BADGERDB_NO_IO_URING), submit() carries out each request with
+ * pread/pwrite instead, so callers see the same behaviour either way.
+ *
+ * Buffers handed to the engine must stay valid until the request completes.
+ * Errors are reported by complete(), after the whole batch has been reaped.
+ *
+ * @warning This class is not threadsafe.
+ */
+class IoEngine {
+ public:
+  /**
+   * Default number of requests kept in flight.
+   */
+  static const unsigned DEFAULT_QUEUE_DEPTH = 64;
+
+  /**
+   * Constructs an engine, setting up an io_uring instance if possible.
+   *
+   * @param queue_depth   Maximum number of requests in flight at once.
+   */
+  explicit IoEngine(const unsigned queue_depth = DEFAULT_QUEUE_DEPTH);
+
+  /**
+   * Waits for any requests in flight and releases the io_uring instance.
+   */
+  ~IoEngine();
+
+  /**
+   * Returns true if requests go to the kernel through io_uring; false if the
+   * engine falls back to synchronous pread/pwrite.
+   */
+  bool isAsync() const { return ring_ != NULL; }
+
+  /**
+   * Returns the maximum number of requests in flight at once.
+   */
+  unsigned queueDepth() const { return queue_depth_; }
+
+  /**
+   * Returns the number of requests prepared but not yet submitted.
+   */
+  unsigned numQueued() const { return queued_.size(); }
+
+  /**
+   * Returns the number of requests submitted but not yet reaped.
+   */
+  unsigned numInFlight() const { return in_flight_; }
+
+  /**
+   * Queues a read of <length> bytes at <offset> of <fd> into <buffer>.  Bytes
+   * past the end of the file read as zero.  If the queue is full, the queued
+   * requests are submitted and this call waits until there is room.
+   *
+   * @param fd        Descriptor of file to read.
+   * @param offset    Offset in the file to read from.
+   * @param buffer    Buffer to read into.
+   * @param length    Number of bytes to read.
+   * @param filename  Name of the file, used when reporting errors.
+   */
+  void prepareRead(const int fd, const off_t offset, void* buffer,
+                   const std::size_t length, const std::string& filename);
+
+  /**
+   * Queues a write of <length> bytes from <buffer> at <offset> of <fd>.  If
+   * the queue is full, the queued requests are submitted and this call waits
+   * until there is room.
+   *
+   * @param fd        Descriptor of file to write.
+   * @param offset    Offset in the file to write at.
+   * @param buffer    Buffer to write from.
+   * @param length    Number of bytes to write.
+   * @param filename  Name of the file, used when reporting errors.
+   */
+  void prepareWrite(const int fd, const off_t offset, const void* buffer,
+                    const std::size_t length, const std::string& filename);
+
+  /**
+   * Hands all queued requests to the kernel in a single submission.
+   *
+   * @return  Number of requests submitted.
+   */
+  unsigned submit();
+
+  /**
+   * Reaps completed requests, waiting until at least <min_complete> of them
+   * have finished.
+   *
+   * @param min_complete  Number of completions to wait for.
+   * @return  Number of requests reaped.
+   * @throws  FileIOException   If any reaped request failed.
+   */
+  unsigned complete(const unsigned min_complete);
+
+  /**
+   * Submits all queued requests and waits for every request in flight.
+   *
+   * @throws  FileIOException   If any request failed.
+   */
+  void drain();
+
+ private:
+  /**
+   * @brief A single read or write request.
+   */
+  struct Request {
+    /**
+     * Descriptor of file the request is for.
+     */
+    int fd;
+
+    /**
+     * True for a write; false for a read.
+     */
+    bool write;
+
+    /**
+     * Offset in the file.
+     */
+    off_t offset;
+
+    /**
+     * Buffer to transfer to or from.
+     */
+    char* buffer;
+
+    /**
+     * Number of bytes to transfer.
+     */
+    std::size_t length;
+
+    /**
+     * Name of the file, used when reporting errors.
+     */
+    std::string filename;
+  };
+
+  /**
+   * @brief State of the io_uring instance; defined in io_engine.cpp.
+   */
+  struct Ring;
+
+  /**
+   * Sets up an io_uring instance.
+   *
+   * @param queue_depth   Number of submission queue entries wanted.
+   * @return  The instance, or NULL if io_uring is unavailable.
+   */
+  static Ring* createRing(const unsigned queue_depth);
+
+  /**
+   * Tears down an io_uring instance set up by createRing().
+   *
+   * @param ring  Instance to tear down.
+   */
+  static void destroyRing(Ring* ring);
+
+  /**
+   * Queues the given request, making room first if the queue is full.
+   *
+   * @param request   Request to queue.
+   */
+  void prepare(const Request& request);
+
+  /**
+   * Reaps completed requests from the io_uring instance, waiting until at
+   * least <min_complete> of them have finished.  Failures are recorded for
+   * complete() to report rather than thrown.
+   *
+   * @param min_complete  Number of completions to wait for.
+   * @return  Number of requests reaped; fewer than wanted if waiting failed.
+   */
+  unsigned reap(const unsigned min_complete);
+
+  /**
+   * Carries out (the rest of) a request with pread/pwrite, starting <done>
+   * bytes into it, and records any error.
+   *
+   * @param request   Request to carry out.
+   * @param done      Number of bytes already transferred.
+   */
+  void perform(const Request& request, std::size_t done);
+
+  /**
+   * Records a failed request so that complete() can report it.
+   *
+   * @param request     Request which failed.
+   * @param error_code  errno value it failed with.
+   */
+  void recordError(const Request& request, const int error_code);
+
+  IoEngine(const IoEngine&);
+  IoEngine& operator=(const IoEngine&);
+
+  /**
+   * Maximum number of requests in flight at once.
+   */
+  unsigned queue_depth_;
+
+  /**
+   * io_uring instance, or NULL if requests are carried out synchronously.
+   */
+  Ring* ring_;
+
+  /**
+   * Request slots, indexed by the user data passed to the kernel.
+   */
+  std::vector<Request> requests_;
+
+  /**
+   * Numbers of request slots not currently in use.
+   */
+  std::vector<unsigned> free_slots_;
+
+  /**
+   * Numbers of request slots prepared but not yet submitted.
+   */
+  std::vector<unsigned> queued_;
+
+  /**
+   * Number of requests submitted but not yet reaped.
+   */
+  unsigned in_flight_;
+
+  /**
+   * errno value of the first request which failed since the last report, or
+   * 0 if none has.
+   */
+  int error_code_;
+
+  /**
+   * Name of the file the first failed request was for.
+   */
+  std::string error_filename_;
+};
+
+}
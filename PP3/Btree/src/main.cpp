@@ -5,12 +5,24 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <limits>
+#include <stdexcept>
 #include <vector>
 #include "btree.h"
+#include "io_engine.h"
 #include "page.h"
 #include "filescan.h"
 #include "page_iterator.h"
 #include "file_iterator.h"
+#include "fixed_width_page.h"
+#include "pax_page.h"
+#include "overflow_file.h"
+#include "parallel_scan.h"
+#include "sample_scan.h"
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/index_scan_completed_exception.h"
 #include "exceptions/file_not_found_exception.h"
@@ -19,6 +31,17 @@
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/file_io_exception.h"
+#include "exceptions/file_format_exception.h"
+#include "exceptions/read_only_file_exception.h"
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/page_not_pinned_exception.h"
+#include "exceptions/page_pinned_exception.h"
+#include "exceptions/hash_not_found_exception.h"
+#include "exceptions/record_width_exception.h"
+#include "exceptions/page_layout_exception.h"
+#include "exceptions/bad_scan_param_exception.h"
+#include "exceptions/bad_index_info_exception.h"
 
 #define checkPassFail(a, b) 																				\
 {																																		\
@@ -73,6 +96,36 @@ void test1();
 void test2();
 void test3();
 void errorTests();
+void bulkLoadTests();
+void forwardingTests();
+void ioEngineTests();
+void writeBackTests();
+void extentTests();
+void fileIteratorTests();
+void freeSpaceTests();
+void compressionTests();
+void zoneMapTests();
+void freeSlotTests();
+void mmapTests();
+void batchTests();
+void sharedScanTests();
+void directIoTests();
+void readPagesTests();
+void recordViewTests();
+void lazyDeleteTests();
+void appendRecordsTests();
+void fixedWidthTests();
+void paxTests();
+void overflowTests();
+void predicateTests();
+void parallelScanTests();
+void readOnlyScanTests();
+void projectionTests();
+void sampleScanTests();
+void createRelation(const std::vector<int> &keys);
+int countRecords(PageFile *file);
+PageZone pageZone(PageFile *file, const PageId pageNo);
+unsigned long long bytesRead();
 void deleteRelation();
 
 int main(int argc, char **argv)
@@ -119,8 +172,7 @@ int main(int argc, char **argv)
 			{
 				fscan.scanNext(scanRid);
 				//Assuming RECORD.i is our key, lets extract the key, which we know is INTEGER and whose byte offset is also know inside the record. 
-				std::string recordStr = fscan.getRecord();
-				const char *record = recordStr.c_str();
+				const char *record = fscan.getRecordView().data();
 				int key = *((int *)(record + offsetof (RECORD, i)));
 				std::cout << "Extracted : " << key << std::endl;
 			}
@@ -138,6 +190,32 @@ int main(int argc, char **argv)
 	test2();
 	test3();
 	errorTests();
+	bulkLoadTests();
+	forwardingTests();
+	ioEngineTests();
+	writeBackTests();
+	extentTests();
+	fileIteratorTests();
+	freeSpaceTests();
+	compressionTests();
+	zoneMapTests();
+	freeSlotTests();
+	mmapTests();
+	batchTests();
+	sharedScanTests();
+	directIoTests();
+	readPagesTests();
+	recordViewTests();
+	lazyDeleteTests();
+	appendRecordsTests();
+	fixedWidthTests();
+	paxTests();
+	overflowTests();
+	predicateTests();
+	parallelScanTests();
+	readOnlyScanTests();
+	projectionTests();
+	sampleScanTests();
 
 	delete bufMgr;
 
@@ -197,8 +275,8 @@ void createRelationForward()
 
   // initialize all of record1.s to keep purify happy
   memset(record1.s, ' ', sizeof(record1.s));
-	PageId new_page_number;
-  Page new_page = file1->allocatePage(new_page_number);
+	std::vector<std::string> records;
+	records.reserve(relationSize);
 
   // Insert a bunch of tuples into the relation.
   for(int i = 0; i < relationSize; i++ )
@@ -206,24 +284,10 @@ void createRelationForward()
     sprintf(record1.s, "%05d string record", i);
     record1.i = i;
     record1.d = (double)i;
-    std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
-
-		while(1)
-		{
-			try
-			{
-    		new_page.insertRecord(new_data);
-				break;
-			}
-			catch(const InsufficientSpaceException &e)
-			{
-				file1->writePage(new_page_number, new_page);
-  			new_page = file1->allocatePage(new_page_number);
-			}
-		}
+    records.push_back(std::string(reinterpret_cast<char*>(&record1), sizeof(record1)));
   }
 
-	file1->writePage(new_page_number, new_page);
+	file1->appendRecords(records, ridVec);
 }
 
 // -----------------------------------------------------------------------------
@@ -244,8 +308,8 @@ void createRelationBackward()
 
   // initialize all of record1.s to keep purify happy
   memset(record1.s, ' ', sizeof(record1.s));
-	PageId new_page_number;
-  Page new_page = file1->allocatePage(new_page_number);
+	std::vector<std::string> records;
+	records.reserve(relationSize);
 
   // Insert a bunch of tuples into the relation.
   for(int i = relationSize - 1; i >= 0; i-- )
@@ -254,24 +318,11 @@ void createRelationBackward()
     record1.i = i;
     record1.d = i;
 
-    std::string new_data(reinterpret_cast<char*>(&record1), sizeof(RECORD));
-
-		while(1)
-		{
-			try
-			{
-    		new_page.insertRecord(new_data);
-				break;
-			}
-			catch(const InsufficientSpaceException &e)
-			{
-				file1->writePage(new_page_number, new_page);
-  			new_page = file1->allocatePage(new_page_number);
-			}
-		}
+    records.push_back(std::string(reinterpret_cast<char*>(&record1), sizeof(RECORD)));
   }
 
-	file1->writePage(new_page_number, new_page);
+	std::vector<RecordId> ridVec;
+	file1->appendRecords(records, ridVec);
 }
 
 // -----------------------------------------------------------------------------
@@ -292,10 +343,8 @@ void createRelationRandom()
 
   // initialize all of record1.s to keep purify happy
   memset(record1.s, ' ', sizeof(record1.s));
-	PageId new_page_number;
-  Page new_page = file1->allocatePage(new_page_number);
 
-  // insert records in random order
+  // insert records in random order, into pages with room for them
 
   std::vector<int> intvec(relationSize);
   for( int i = 0; i < relationSize; i++ )
@@ -314,29 +363,16 @@ void createRelationRandom()
     record1.i = val;
     record1.d = val;
 
-    std::string new_data(reinterpret_cast<char*>(&record1), sizeof(RECORD));
-
-		while(1)
-		{
-			try
-			{
-    		new_page.insertRecord(new_data);
-				break;
-			}
-			catch(const InsufficientSpaceException &e)
-			{
-      	file1->writePage(new_page_number, new_page);
-  			new_page = file1->allocatePage(new_page_number);
-			}
-		}
+    bufMgr->insertRecord(file1, std::string(reinterpret_cast<char*>(&record1), sizeof(RECORD)));
 
 		int temp = intvec[relationSize-1-i];
 		intvec[relationSize-1-i] = intvec[pos];
 		intvec[pos] = temp;
 		i++;
   }
-  
-	file1->writePage(new_page_number, new_page);
+
+  // the index reads the relation from the file
+  bufMgr->flushFile(file1);
 }
 
 // -----------------------------------------------------------------------------
@@ -403,9 +439,16 @@ int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operato
 		{
 			index->scanNext(scanRid);
 			bufMgr->readPage(file1, scanRid.page_number, curPage);
-			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecordView(scanRid).data()));
 			bufMgr->unPinPage(file1, scanRid.page_number, false);
 
+			if( (lowOp == GT && myRec.i <= lowVal) || (lowOp == GTE && myRec.i < lowVal)
+				|| (highOp == LT && myRec.i >= highVal) || (highOp == LTE && myRec.i > highVal) )
+			{
+				std::cout << "Test FAILS: record out of range:" << myRec.i << std::endl;
+				exit(1);
+			}
+
 			if( numResults < 5 )
 			{
 				std::cout << "at:" << scanRid.page_number << "," << scanRid.slot_number;
@@ -560,6 +603,2137 @@ void errorTests()
   }
 }
 
+// -----------------------------------------------------------------------------
+// bulkLoadTests
+// -----------------------------------------------------------------------------
+
+void bulkLoadTests()
+{
+	std::cout << "Bulk load tests" << std::endl;
+	std::cout << "---------------" << std::endl;
+
+	// runs of 50 equal keys, in shuffled order, so duplicates cross leaf boundaries
+	std::vector<int> keys;
+	for(int i = 0; i < 20000; i++)
+	{
+		keys.push_back(i / 50);
+	}
+	for(int i = keys.size() - 1; i > 0; i--)
+	{
+		std::swap(keys[i], keys[random() % (i + 1)]);
+	}
+	createRelation(keys);
+
+	{
+		// sorted in 7 runs, half-full nodes
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, 0.5, 3000);
+		checkPassFail(File::exists(intIndexName + ".run0"), false)
+		checkPassFail(intScan(&index,100,GTE,100,LTE), 50)
+		checkPassFail(intScan(&index,99,GT,200,LT), 5000)
+		checkPassFail(intScan(&index,-5,GTE,399,LTE), 20000)
+		checkPassFail(intScan(&index,400,GTE,500,LTE), 0)
+	}
+	File::remove(intIndexName);
+
+	{
+		// nodes of a handful of entries, so the tree is several levels deep
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, 0.01);
+		checkPassFail(intScan(&index,13,GTE,13,LTE), 50)
+		checkPassFail(intScan(&index,0,GTE,399,LT), 19950)
+	}
+	{
+		// reopened from the file, the tree is navigated the same
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(intScan(&index,250,GT,260,LTE), 500)
+	}
+	{
+		// an index file built for another attribute type is refused, and closed again
+		bool thrown = false;
+		try
+		{
+			BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), DOUBLE);
+		}
+		catch(const BadIndexInfoException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(intScan(&index,13,GTE,13,LTE), 50)
+	}
+	File::remove(intIndexName);
+	deleteRelation();
+
+	createRelation(std::vector<int>());
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(intScan(&index,0,GTE,100,LTE), 0)
+	}
+	File::remove(intIndexName);
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// forwardingTests
+// -----------------------------------------------------------------------------
+
+void forwardingTests()
+{
+	std::cout << "Forwarding tests" << std::endl;
+	std::cout << "----------------" << std::endl;
+
+	std::vector<int> keys;
+	for(int i = 0; i < 200; i++)
+	{
+		keys.push_back(i);
+	}
+	createRelation(keys);
+	std::vector<RecordId> rids;
+	{
+		FileScan scan(file1, bufMgr);
+		try
+		{
+			RecordId scanRid;
+			while(1)
+			{
+				scan.scanNext(scanRid);
+				rids.push_back(scanRid);
+			}
+		}
+		catch(const EndOfFileException &e)
+		{
+		}
+	}
+	checkPassFail(rids.size(), 200)
+
+	// grown past the room left on its full page, the record moves and keeps its ID
+	const RecordId moved = rids[0];
+	const std::string grown(4000, 'g');
+	bufMgr->updateRecord(file1, moved, grown);
+	checkPassFail((bufMgr->readRecord(file1, moved) == grown), true)
+
+	// grown again past the room on the page it moved to, it moves on and is taken off that page
+	const std::string regrown(6000, 'r');
+	bufMgr->updateRecord(file1, moved, regrown);
+	checkPassFail((bufMgr->readRecord(file1, moved) == regrown), true)
+	checkPassFail(countRecords(file1), 200)
+
+	// shrunk, it is updated where it is
+	const std::string shrunk(10, 's');
+	bufMgr->updateRecord(file1, moved, shrunk);
+	checkPassFail((bufMgr->readRecord(file1, moved) == shrunk), true)
+	checkPassFail(bufMgr->readRecord(file1, rids[1]).size(), sizeof(RECORD))
+
+	// deleting the record takes its stub and its moved copy
+	bufMgr->deleteRecord(file1, moved);
+	checkPassFail(countRecords(file1), 199)
+
+	// a record too big for any page stays where it was
+	bool thrown = false;
+	try
+	{
+		bufMgr->updateRecord(file1, rids[2], std::string(Page::SIZE, 'x'));
+	}
+	catch(const InsufficientSpaceException &e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+	checkPassFail(bufMgr->readRecord(file1, rids[2]).size(), sizeof(RECORD))
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// ioEngineTests
+// -----------------------------------------------------------------------------
+
+void ioEngineTests()
+{
+	std::cout << "I/O engine tests" << std::endl;
+	std::cout << "----------------" << std::endl;
+
+	const std::string name = "ioEngineTest";
+	const std::size_t blockSize = 512;
+	// a queue shallower than the batch, so preparing a request waits for room
+	IoEngine engine(4);
+
+	std::vector<std::string> blocks;
+	int fd = open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	for(int i = 0; i < 20; i++)
+	{
+		blocks.push_back(std::string(blockSize, 'a' + i));
+		engine.prepareWrite(fd, i * blockSize, blocks[i].data(), blockSize, name);
+	}
+	engine.drain();
+	checkPassFail(engine.numInFlight(), 0)
+
+	// the block past the end of the file reads as zeros
+	std::vector<char> buffer(21 * blockSize, 'x');
+	for(int i = 0; i < 21; i++)
+	{
+		engine.prepareRead(fd, i * blockSize, &buffer[i * blockSize], blockSize, name);
+	}
+	engine.drain();
+	int matching = 0;
+	for(int i = 0; i < 20; i++)
+	{
+		if(std::string(&buffer[i * blockSize], blockSize) == blocks[i])
+			matching++;
+	}
+	checkPassFail(matching, 20)
+	checkPassFail((std::string(&buffer[20 * blockSize], blockSize) == std::string(blockSize, '\0')), true)
+	close(fd);
+
+	// a failed write is reported when the batch is drained, and leaves nothing in flight
+	fd = open(name.c_str(), O_RDONLY);
+	engine.prepareWrite(fd, 0, blocks[0].data(), blockSize, name);
+	bool thrown = false;
+	try
+	{
+		engine.drain();
+	}
+	catch(const FileIOException &e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+	checkPassFail(engine.numInFlight(), 0)
+	checkPassFail(engine.numQueued(), 0)
+	close(fd);
+	File::remove(name);
+}
+
+// -----------------------------------------------------------------------------
+// writeBackTests
+// -----------------------------------------------------------------------------
+
+void writeBackTests()
+{
+	std::cout << "Write back tests" << std::endl;
+	std::cout << "----------------" << std::endl;
+
+	const std::string name = "writeBackTest";
+	std::vector<ZoneAttribute> attributes(1);
+	attributes[0].type = ZoneAttribute::INTEGER;
+	attributes[0].offset = offsetof(RECORD, i);
+	RECORD record;
+	memset(&record, 0, sizeof(RECORD));
+	PageId pageNo;
+	PageId otherPageNo;
+	{
+		PageFile file = PageFile::create(name);
+		file.setZoneAttributes(attributes);
+		BufMgr mgr(10);
+		Page *page;
+		mgr.allocPage(&file, pageNo, page);
+		mgr.unPinPage(&file, pageNo, true);
+
+		// a page added behind the buffer pool's back, so that the frame's next page pointer is out of date
+		file.allocatePage(otherPageNo);
+
+		mgr.readPage(&file, pageNo, page);
+		record.i = 42;
+		page->insertRecord(std::string(reinterpret_cast<char*>(&record), sizeof(RECORD)));
+		mgr.unPinPage(&file, pageNo, true);
+		checkPassFail(mgr.writeFile(&file), 1)
+	}
+	{
+		// the directory entries the queued writes changed reached disk with the pages
+		PageFile file(name, false);
+		checkPassFail(pageZone(&file, pageNo).min, 42)
+		checkPassFail(pageZone(&file, pageNo).max, 42)
+		int pages = 0;
+		for(FileIterator iter = file.begin(); iter != file.end(); iter++)
+		{
+			pages++;
+		}
+		checkPassFail(pages, 2)
+	}
+	{
+		PageFile file(name, false);
+		BufMgr mgr(10);
+		Page *page;
+		mgr.readPage(&file, pageNo, page);
+		record.i = 43;
+		page->insertRecord(std::string(reinterpret_cast<char*>(&record), sizeof(RECORD)));
+		mgr.unPinPage(&file, pageNo, true);
+		mgr.readPage(&file, otherPageNo, page);
+		mgr.unPinPage(&file, otherPageNo, true);
+		file.deletePage(otherPageNo);
+
+		// a page that can't be queued fails the call, but the writes queued before it are carried out
+		// rather than left behind on the I/O engine
+		bool thrown = false;
+		try
+		{
+			mgr.writeFile(&file);
+		}
+		catch(const InvalidPageException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+		const Page written = file.readPage(pageNo);
+		int records = 0;
+		for(PageIterator iter = written.begin(); iter != written.end(); ++iter)
+		{
+			records++;
+		}
+		checkPassFail(records, 2)
+
+		// drop the deleted page's frame, so that it isn't written back on the way out
+		try
+		{
+			mgr.disposePage(&file, otherPageNo);
+		}
+		catch(const InvalidPageException &e)
+		{
+		}
+	}
+	File::remove(name);
+}
+
+// -----------------------------------------------------------------------------
+// extentTests
+// -----------------------------------------------------------------------------
+
+void extentTests()
+{
+	std::cout << "Extent tests" << std::endl;
+	std::cout << "------------" << std::endl;
+
+	const std::string name = "extentTest";
+	for(int compress = 0; compress < 2; compress++)
+	{
+		const off_t slotSize = compress ? Page::SIZE + File::DIRECT_IO_ALIGNMENT : Page::SIZE;
+		const off_t firstPage = compress ? Page::SIZE : sizeof(FileHeader);
+		{
+			PageFile file = PageFile::create(name, false, compress);
+			file.setExtentSize(16);
+			checkPassFail(file.extentSize(), 16)
+
+			// directory page 1 and pages 2 to 18; the file grows by whole extents of 16 pages, so it ends on
+			// a page boundary, past page 18 but no further than one extent past the end of page 17
+			PageId pageNo;
+			for(int i = 0; i < 17; i++)
+			{
+				file.allocatePage(pageNo);
+			}
+			checkPassFail(pageNo, 18)
+			struct stat st;
+			stat(name.c_str(), &st);
+			checkPassFail((st.st_size - firstPage) % slotSize, 0)
+			checkPassFail((st.st_size >= firstPage + 18 * slotSize), true)
+			checkPassFail((st.st_size <= firstPage + 33 * slotSize), true)
+
+			// the next page is in space already reserved
+			const off_t reserved = st.st_size;
+			file.allocatePage(pageNo);
+			stat(name.c_str(), &st);
+			checkPassFail(st.st_size, reserved)
+
+			// an extent is a run of adjacent pages
+			std::vector<PageId> pageNos;
+			file.allocateExtent(5, pageNos);
+			checkPassFail(pageNos.size(), 5)
+			checkPassFail(pageNos[4] - pageNos[0], 4)
+		}
+		{
+			// the extent size lasts for the life of the file
+			PageFile file(name, false);
+			checkPassFail(file.extentSize(), 16)
+		}
+		File::remove(name);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// fileIteratorTests
+// -----------------------------------------------------------------------------
+
+void fileIteratorTests()
+{
+	std::cout << "File iterator tests" << std::endl;
+	std::cout << "-------------------" << std::endl;
+
+	const std::string name = "iteratorTest";
+	{
+		PageFile file = PageFile::create(name);
+		PageId pageNo;
+		for(int i = 0; i < 3; i++)
+		{
+			file.allocatePage(pageNo);
+		}
+		FileIterator iter = file.begin();
+		checkPassFail(iter.getCurrentPageNo(), 2)
+
+		// pages allocated while iterating, here through another File object, are returned, past the end of
+		// the directory page the iterator started in too
+		{
+			PageFile other(name, false);
+			for(std::size_t i = 0; i < PageFile::DIRECTORY_ENTRIES; i++)
+			{
+				other.allocatePage(pageNo);
+			}
+		}
+		int pages = 0;
+		for(; iter != file.end(); iter++)
+		{
+			pages++;
+		}
+		checkPassFail(pages, PageFile::DIRECTORY_ENTRIES + 3)
+
+		// deleted pages are not
+		iter = file.begin();
+		file.deletePage(3);
+		file.deletePage(pageNo);
+		pages = 0;
+		bool deletedFound = false;
+		for(; iter != file.end(); iter++)
+		{
+			pages++;
+			deletedFound = deletedFound || iter.getCurrentPageNo() == 3 || iter.getCurrentPageNo() == pageNo;
+		}
+		checkPassFail(pages, PageFile::DIRECTORY_ENTRIES + 1)
+		checkPassFail(deletedFound, false)
+	}
+	{
+		// the directory read back from disk agrees
+		PageFile file(name, false);
+		int pages = 0;
+		for(FileIterator iter = file.begin(); iter != file.end(); iter++)
+		{
+			pages++;
+		}
+		checkPassFail(pages, PageFile::DIRECTORY_ENTRIES + 1)
+	}
+	File::remove(name);
+}
+
+// -----------------------------------------------------------------------------
+// freeSpaceTests
+// -----------------------------------------------------------------------------
+
+void freeSpaceTests()
+{
+	std::cout << "Free space tests" << std::endl;
+	std::cout << "----------------" << std::endl;
+
+	std::vector<int> keys;
+	for(int i = 0; i < 200; i++)
+	{
+		keys.push_back(i);
+	}
+	createRelation(keys);
+	std::vector<RecordId> rids;
+	{
+		FileScan scan(file1, bufMgr);
+		try
+		{
+			RecordId scanRid;
+			while(1)
+			{
+				scan.scanNext(scanRid);
+				rids.push_back(scanRid);
+			}
+		}
+		catch(const EndOfFileException &e)
+		{
+		}
+	}
+	checkPassFail(rids.size(), 200)
+	const PageId lastPage = rids.back().page_number;
+
+	// a record goes on the page with room for it
+	const RecordId filled = bufMgr->insertRecord(file1, std::string(6000, 'f'));
+	checkPassFail(filled.page_number, lastPage)
+
+	// a record too big for the room left on any page goes on a new page, and the next one joins it
+	const std::string big(3000, 'b');
+	const RecordId first = bufMgr->insertRecord(file1, big);
+	checkPassFail((first.page_number > lastPage), true)
+	const RecordId second = bufMgr->insertRecord(file1, big);
+	checkPassFail(second.page_number, first.page_number)
+
+	// space left by deleting records is reused before the page is written back
+	for(int i = 0; i < 40; i++)
+	{
+		bufMgr->deleteRecord(file1, rids[i]);
+	}
+	const RecordId reused = bufMgr->insertRecord(file1, big);
+	checkPassFail(reused.page_number, rids[0].page_number)
+	checkPassFail(countRecords(file1), 164)
+
+	// the file header (page 0) and directory pages (the first is page 1) can't be deleted
+	const PageId notUsed[] = {0, 1};
+	for(int i = 0; i < 2; i++)
+	{
+		bool thrown = false;
+		try
+		{
+			file1->deletePage(notUsed[i]);
+		}
+		catch(const InvalidPageException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+	}
+	deleteRelation();
+
+	// a file in another format is refused, and left closed so that it can be removed
+	const std::string name = "freeSpaceTest";
+	{
+		PageFile file = PageFile::create(name);
+	}
+	{
+		const std::uint32_t version = 0;
+		const int fd = open(name.c_str(), O_WRONLY);
+		checkPassFail((pwrite(fd, &version, sizeof(version), 0) == sizeof(version)), true)
+		close(fd);
+	}
+	bool thrown = false;
+	try
+	{
+		PageFile file = PageFile::open(name);
+	}
+	catch(const FileFormatException &e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+	File::remove(name);
+	checkPassFail(File::exists(name), false)
+}
+
+// -----------------------------------------------------------------------------
+// compressionTests
+// -----------------------------------------------------------------------------
+
+void compressionTests()
+{
+	std::cout << "Compression tests" << std::endl;
+	std::cout << "-----------------" << std::endl;
+
+	const std::string name = "compressionTest";
+	const off_t slotSize = Page::SIZE + File::DIRECT_IO_ALIGNMENT;
+	const std::string record(100, 'c');
+	{
+		PageFile file = PageFile::create(name, false, true);
+		checkPassFail(file.isCompressed(), true)
+
+		// directory page 1 and pages 2 to 6, each with 50 records
+		for(int i = 0; i < 5; i++)
+		{
+			PageId pageNo;
+			Page page = file.allocatePage(pageNo);
+			for(int j = 0; j < 50; j++)
+			{
+				page.insertRecord(record);
+			}
+			file.writePage(pageNo, page);
+		}
+
+		// deleting a page relinks the pages around it
+		file.deletePage(4);
+	}
+	{
+		// page data is stored compressed, and the page directory raw
+		PageSlotHeader slotHeader;
+		const int fd = open(name.c_str(), O_RDONLY);
+		checkPassFail((pread(fd, &slotHeader, sizeof(slotHeader), Page::SIZE) == sizeof(slotHeader)), true)
+		checkPassFail(slotHeader.encoding, PageSlotHeader::RAW)
+		checkPassFail((pread(fd, &slotHeader, sizeof(slotHeader), Page::SIZE + slotSize) == sizeof(slotHeader)), true)
+		checkPassFail(slotHeader.encoding, PageSlotHeader::COMPRESSED)
+		checkPassFail((slotHeader.length < Page::SIZE / 4), true)
+		close(fd);
+	}
+	{
+		PageFile file(name, false);
+
+		// reading a compressed page reads only the blocks it takes up, not the whole slot
+		unsigned long long before = bytesRead();
+		unsigned long long overhead = bytesRead() - before;
+		before = bytesRead();
+		file.readPage(6);
+		const unsigned long long pageBytes = bytesRead() - before - overhead;
+		checkPassFail((pageBytes < 2 * File::DIRECT_IO_ALIGNMENT), true)
+		Page pages[2];
+		std::vector<Page*> pagePointers;
+		pagePointers.push_back(&pages[0]);
+		pagePointers.push_back(&pages[1]);
+		before = bytesRead();
+		file.readPagesInto(5, pagePointers);
+		const unsigned long long batchBytes = bytesRead() - before - overhead;
+		checkPassFail((batchBytes < 4 * File::DIRECT_IO_ALIGNMENT), true)
+		checkPassFail((pages[1].getRecord(RecordId{6, 50, 0}) == record), true)
+
+		std::vector<PageId> pageNos;
+		for(FileIterator iter = file.begin(); iter != file.end(); ++iter)
+		{
+			pageNos.push_back((*iter).page_number());
+		}
+		checkPassFail(pageNos.size(), 4)
+		checkPassFail(pageNos[1], 3)
+		checkPassFail(pageNos[2], 5)
+		checkPassFail(countRecords(&file), 200)
+		bufMgr->flushFile(&file);
+		checkPassFail((file.readPage(6).getRecord(RecordId{6, 50, 0}) == record), true)
+	}
+	File::remove(name);
+}
+
+// -----------------------------------------------------------------------------
+// zoneMapTests
+// -----------------------------------------------------------------------------
+
+void zoneMapTests()
+{
+	std::cout << "Zone map tests" << std::endl;
+	std::cout << "--------------" << std::endl;
+
+	std::vector<int> keys;
+	for(int i = 0; i < 200; i++)
+	{
+		keys.push_back(i);
+	}
+	createRelation(keys);
+	std::vector<ZoneAttribute> attributes(1);
+	attributes[0].type = ZoneAttribute::INTEGER;
+	attributes[0].offset = offsetof(RECORD, i);
+	file1->setZoneAttributes(attributes);
+	std::vector<RecordId> rids;
+	{
+		FileScan scan(file1, bufMgr);
+		try
+		{
+			RecordId scanRid;
+			while(1)
+			{
+				scan.scanNext(scanRid);
+				rids.push_back(scanRid);
+			}
+		}
+		catch(const EndOfFileException &e)
+		{
+		}
+	}
+	checkPassFail(rids.size(), 200)
+	const PageId firstPage = rids.front().page_number;
+	const PageId lastPage = rids.back().page_number;
+	int lastPageRecords = 0;
+	int firstPageMax = 0;
+	for(int i = 0; i < 200; i++)
+	{
+		if(rids[i].page_number == lastPage)
+			lastPageRecords++;
+		if(rids[i].page_number == firstPage)
+			firstPageMax = i;
+	}
+	checkPassFail(pageZone(file1, firstPage).min, 0)
+	checkPassFail(pageZone(file1, firstPage).max, firstPageMax)
+
+	// counts the records a scan skipping pages by zone returns
+	auto zoneScanCount = [](double low, double high)
+	{
+		FileScan scan(file1, bufMgr);
+		scan.setZoneRange(0, low, high);
+		int count = 0;
+		try
+		{
+			RecordId scanRid;
+			while(1)
+			{
+				scan.scanNext(scanRid);
+				count++;
+			}
+		}
+		catch(const EndOfFileException &e)
+		{
+		}
+		return count;
+	};
+
+	// a record put on a page widens its zone map at once, before the page is written back
+	memset(record1.s, ' ', sizeof(record1.s));
+	record1.i = 5000;
+	record1.d = 5000;
+	const RecordId added = bufMgr->insertRecord(file1, std::string(reinterpret_cast<char*>(&record1), sizeof(RECORD)));
+	checkPassFail(added.page_number, lastPage)
+	checkPassFail(pageZone(file1, lastPage).max, 5000)
+	checkPassFail(zoneScanCount(4000, 6000), lastPageRecords + 1)
+
+	// so does a record updated in place
+	record1.i = -7;
+	bufMgr->updateRecord(file1, rids[50], std::string(reinterpret_cast<char*>(&record1), sizeof(RECORD)));
+	checkPassFail(pageZone(file1, firstPage).min, -7)
+
+	// taking off the record with a bound leaves the bound for the records left to set
+	bufMgr->deleteRecord(file1, rids[firstPageMax]);
+	bufMgr->flushFile(file1);
+	checkPassFail(pageZone(file1, firstPage).max, firstPageMax - 1)
+	checkPassFail(pageZone(file1, firstPage).min, -7)
+	checkPassFail(pageZone(file1, lastPage).max, 5000)
+
+	// a change made to a pinned page directly shows once the page is unpinned
+	Page* page;
+	bufMgr->readPage(file1, firstPage, page);
+	record1.i = 7000;
+	const RecordId direct = page->insertRecord(std::string(reinterpret_cast<char*>(&record1), sizeof(RECORD)));
+	bufMgr->unPinPage(file1, firstPage, true);
+	checkPassFail(pageZone(file1, firstPage).max, 7000)
+	checkPassFail(zoneScanCount(6500, 7500), firstPageMax + 1)
+
+	// a zone left too wide by taking off its bound still takes in records added after
+	bufMgr->deleteRecord(file1, direct);
+	record1.i = 8000;
+	const RecordId afterDelete = bufMgr->insertRecord(file1, std::string(reinterpret_cast<char*>(&record1), sizeof(RECORD)));
+	checkPassFail(afterDelete.page_number, firstPage)
+	checkPassFail(pageZone(file1, firstPage).max, 8000)
+	checkPassFail(zoneScanCount(7500, 8500), firstPageMax + 1)
+	bufMgr->flushFile(file1);
+	checkPassFail(pageZone(file1, firstPage).max, 8000)
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// freeSlotTests
+// -----------------------------------------------------------------------------
+
+void freeSlotTests()
+{
+	std::cout << "Free slot tests" << std::endl;
+	std::cout << "---------------" << std::endl;
+
+	Page page;
+	for(int i = 0; i < 5; i++)
+	{
+		checkPassFail(page.insertRecord("free slot record").slot_number, i + 1)
+	}
+
+	// deleted slots are reused last freed first, before any new slot is allocated
+	page.deleteRecord(RecordId{Page::INVALID_NUMBER, 2, 0});
+	page.deleteRecord(RecordId{Page::INVALID_NUMBER, 4, 0});
+	checkPassFail(page.insertRecord("reused").slot_number, 4)
+	checkPassFail(page.insertRecord("reused").slot_number, 2)
+	checkPassFail(page.insertRecord("new").slot_number, 6)
+	checkPassFail((page.getRecord(RecordId{Page::INVALID_NUMBER, 2, 0}) == "reused"), true)
+
+	// so is a slot freed at the end of the slot array
+	page.deleteRecord(RecordId{Page::INVALID_NUMBER, 6, 0});
+	checkPassFail(page.insertRecord("new").slot_number, 6)
+
+	// page headers differing in any field differ
+	PageHeader header;
+	memset(&header, 0, sizeof(header));
+	PageHeader other = header;
+	checkPassFail((other == header), true)
+	other.first_free_slot = 1;
+	checkPassFail((other == header), false)
+	other = header;
+	other.fragmented_bytes = 1;
+	checkPassFail((other == header), false)
+	other = header;
+	other.record_width = 1;
+	checkPassFail((other == header), false)
+}
+
+// -----------------------------------------------------------------------------
+// mmapTests
+// -----------------------------------------------------------------------------
+
+void mmapTests()
+{
+	std::cout << "Memory-mapped file tests" << std::endl;
+	std::cout << "------------------------" << std::endl;
+
+	std::vector<int> keys;
+	for(int i = 0; i < 200; i++)
+	{
+		keys.push_back(i);
+	}
+	createRelation(keys);
+	{
+		MappedFile mapped = MappedFile::open(relationName, MappedFile::SEQUENTIAL);
+
+		// pages are read in place, through const pointers
+		const Page* page;
+		bufMgr->readPage(&mapped, 2, page);
+		checkPassFail(page->page_number(), 2)
+		checkPassFail((page->begin() != page->end()), true)
+		bufMgr->unPinPage(&mapped, 2, false);
+		std::vector<PageId> pageNos(1, 2);
+		std::vector<const Page*> pages;
+		bufMgr->readPages(&mapped, pageNos, pages);
+		checkPassFail(pages[0], page)
+		bufMgr->unPinPage(&mapped, 2, false);
+		checkPassFail(countRecords(&mapped), 200)
+		const RecordId first = {2, 1, 0};
+		checkPassFail(bufMgr->readRecord(&mapped, first).size(), sizeof(RECORD))
+
+		// asking for a page to change, or changing a record, is refused rather than faulting
+		bool thrown = false;
+		try
+		{
+			Page* writable;
+			bufMgr->readPage(&mapped, 2, writable);
+		}
+		catch(const ReadOnlyFileException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+		thrown = false;
+		try
+		{
+			bufMgr->updateRecord(&mapped, first, "changed");
+		}
+		catch(const ReadOnlyFileException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+		checkPassFail(bufMgr->readRecord(&mapped, first).size(), sizeof(RECORD))
+	}
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// batchTests
+// -----------------------------------------------------------------------------
+
+void batchTests()
+{
+	std::cout << "Batch tests" << std::endl;
+	std::cout << "-----------" << std::endl;
+
+	std::vector<int> keys;
+	for(int i = 0; i < 200; i++)
+	{
+		keys.push_back(i);
+	}
+	createRelation(keys);
+	for(int filtered = 0; filtered < 2; filtered++)
+	{
+		FileScan scan(file1, bufMgr);
+		if(filtered)
+		{
+			ScanPredicate predicate;
+			predicate.add([](const RecordView &record)
+			{
+				int key;
+				memcpy(&key, record.data() + offsetof(RECORD, i), sizeof(int));
+				return key % 2 == 0;
+			});
+			scan.setPredicate(predicate);
+		}
+		RecordBatch batch;
+		const std::size_t keyColumn = batch.addColumn(offsetof(RECORD, i), sizeof(int));
+
+		// batches never span pages or exceed the row limit, and the column matches the records
+		std::size_t rows = 0;
+		std::size_t biggest = 0;
+		int sum = 0;
+		bool consistent = true;
+		try
+		{
+			while(1)
+			{
+				scan.scanNextBatch(batch, 64);
+				biggest = std::max(biggest, batch.size());
+				const int* values = batch.columnAs<int>(keyColumn);
+				for(std::size_t i = 0; i < batch.size(); i++)
+				{
+					int key;
+					memcpy(&key, batch.records()[i].data() + offsetof(RECORD, i), sizeof(int));
+					consistent = consistent && key == values[i] &&
+						batch.recordIds()[i].page_number == batch.recordIds()[0].page_number;
+					sum += values[i];
+				}
+				rows += batch.size();
+			}
+		}
+		catch(const EndOfFileException &e)
+		{
+		}
+		const std::size_t expectedRows = filtered ? 100 : 200;
+		const int expectedSum = filtered ? 9900 : 19900;
+		checkPassFail(rows, expectedRows)
+		checkPassFail(sum, expectedSum)
+		checkPassFail((biggest > 32 && biggest <= 64), true)
+		checkPassFail(consistent, true)
+	}
+
+	// a record too short for a column has zeros for it, not the part of it there is
+	bufMgr->insertRecord(file1, std::string(2, '\xff'));
+	{
+		FileScan scan(file1, bufMgr);
+		ScanPredicate predicate;
+		predicate.add([](const RecordView &record)
+		{
+			return record.size() < sizeof(int);
+		});
+		scan.setPredicate(predicate);
+		RecordBatch batch;
+		const std::size_t keyColumn = batch.addColumn(offsetof(RECORD, i), sizeof(int));
+		scan.scanNextBatch(batch, 64);
+		checkPassFail(batch.size(), 1)
+		checkPassFail(batch.columnAs<int>(keyColumn)[0], 0)
+	}
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// sharedScanTests
+// -----------------------------------------------------------------------------
+
+void sharedScanTests()
+{
+	std::cout << "Shared scan tests" << std::endl;
+	std::cout << "-----------------" << std::endl;
+
+	std::vector<int> keys;
+	for(int i = 0; i < 500; i++)
+	{
+		keys.push_back(i);
+	}
+	createRelation(keys);
+	{
+		SharedScanManager manager(bufMgr);
+		checkPassFail(manager.getFile(relationName), manager.getFile(relationName))
+		{
+			// a scan joining one under way starts where it is and wraps around, and each sees every record once
+			FileScan first(relationName, &manager);
+			RecordId rid;
+			std::vector<bool> seenFirst(500, false);
+			std::vector<bool> seenSecond(500, false);
+			int key;
+			for(int i = 0; i < 250; i++)
+			{
+				first.scanNext(rid);
+				first.readAttribute(offsetof(RECORD, i), sizeof(int), &key);
+				seenFirst[key] = true;
+			}
+			FileScan second(relationName, &manager);
+			second.scanNext(rid);
+			second.readAttribute(offsetof(RECORD, i), sizeof(int), &key);
+			seenSecond[key] = true;
+			checkPassFail((key > 0), true)
+			int countFirst = 250;
+			int countSecond = 1;
+			try
+			{
+				while(1)
+				{
+					second.scanNext(rid);
+					second.readAttribute(offsetof(RECORD, i), sizeof(int), &key);
+					seenSecond[key] = true;
+					countSecond++;
+				}
+			}
+			catch(const EndOfFileException &e)
+			{
+			}
+			try
+			{
+				while(1)
+				{
+					first.scanNext(rid);
+					first.readAttribute(offsetof(RECORD, i), sizeof(int), &key);
+					seenFirst[key] = true;
+					countFirst++;
+				}
+			}
+			catch(const EndOfFileException &e)
+			{
+			}
+			checkPassFail(countFirst, 500)
+			checkPassFail(countSecond, 500)
+			checkPassFail((std::find(seenFirst.begin(), seenFirst.end(), false) == seenFirst.end()), true)
+			checkPassFail((std::find(seenSecond.begin(), seenSecond.end(), false) == seenSecond.end()), true)
+		}
+		// the scans are gone, so the manager can flush and close the relation
+	}
+	checkPassFail(countRecords(file1), 500)
+	deleteRelation();
+
+	// a scan ahead of another reads the pages for it, even when they don't move in step
+	keys.clear();
+	for(int i = 0; i < 4000; i++)
+	{
+		keys.push_back(i);
+	}
+	createRelation(keys);
+	{
+		BufMgr pool(10);
+		SharedScanManager manager(&pool, 4);
+		{
+			FileScan first(relationName, &manager);
+			const PageId firstPage = first.scanNextPage()->page_number();
+			FileScan second(relationName, &manager);
+			checkPassFail(second.scanNextPage()->page_number(), firstPage)
+
+			// the next pages are kept for the second scan; the ones after them go through the pool on their own
+			std::vector<PageId> kept;
+			for(int i = 0; i < 4; i++)
+			{
+				kept.push_back(first.scanNextPage()->page_number());
+			}
+			for(int i = 0; i < 20; i++)
+			{
+				first.scanNextPage();
+			}
+			pool.clearBufStats();
+			for(int i = 0; i < 4; i++)
+			{
+				checkPassFail(second.scanNextPage()->page_number(), kept[i])
+			}
+			checkPassFail(pool.getBufStats().diskreads, 0)
+
+			// a scan destroyed before reaching the pages kept for it releases them
+			first.scanNextPage();
+			second.scanNextPage();
+			for(int i = 0; i < 3; i++)
+			{
+				second.scanNextPage();
+			}
+		}
+		// every page is unpinned again
+		bool thrown = false;
+		try
+		{
+			pool.flushFile(manager.getFile(relationName));
+		}
+		catch(const PagePinnedException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, false)
+	}
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// directIoTests
+// -----------------------------------------------------------------------------
+
+void directIoTests()
+{
+	std::cout << "Direct I/O tests" << std::endl;
+	std::cout << "----------------" << std::endl;
+
+	// frames can be read into and written from in place
+	checkPassFail((reinterpret_cast<uintptr_t>(bufMgr->bufPool) % File::DIRECT_IO_ALIGNMENT), 0)
+	checkPassFail((reinterpret_cast<uintptr_t>(&bufMgr->bufPool[1]) % File::DIRECT_IO_ALIGNMENT), 0)
+
+	const std::string name = "directTest";
+	const std::string record(100, 'd');
+	{
+		// pages written through the buffer pool and from anywhere in memory, which needs a bounce buffer
+		PageFile file = PageFile::create(name, true);
+		for(int i = 0; i < 3; i++)
+		{
+			PageId pageNo;
+			Page* page;
+			bufMgr->allocPage(&file, pageNo, page);
+			page->insertRecord(record);
+			bufMgr->unPinPage(&file, pageNo, true);
+		}
+		bufMgr->flushFile(&file);
+		PageId pageNo;
+		Page page = file.allocatePage(pageNo);
+		page.insertRecord(record);
+		file.writePage(pageNo, page);
+		checkPassFail(countRecords(&file), 4)
+		bufMgr->flushFile(&file);
+	}
+	{
+		// and read back the same with or without direct I/O
+		PageFile direct = PageFile::open(name, true);
+		checkPassFail(countRecords(&direct), 4)
+		bufMgr->flushFile(&direct);
+		checkPassFail((direct.readPage(5).getRecord(RecordId{5, 1, 0}) == record), true)
+	}
+	{
+		PageFile buffered = PageFile::open(name);
+		checkPassFail(buffered.isDirect(), false)
+		checkPassFail(countRecords(&buffered), 4)
+		bufMgr->flushFile(&buffered);
+	}
+	File::remove(name);
+}
+
+// -----------------------------------------------------------------------------
+// readPagesTests
+// -----------------------------------------------------------------------------
+
+void readPagesTests()
+{
+	std::cout << "Read pages tests" << std::endl;
+	std::cout << "----------------" << std::endl;
+
+	std::vector<int> keys;
+	for(int i = 0; i < 500; i++)
+	{
+		keys.push_back(i);
+	}
+	createRelation(keys);
+
+	// a run of pages, one already in the buffer pool, and a page asked for twice
+	Page* cached;
+	bufMgr->readPage(file1, 3, cached);
+	std::vector<PageId> pageNos;
+	pageNos.push_back(2);
+	pageNos.push_back(3);
+	pageNos.push_back(4);
+	pageNos.push_back(6);
+	pageNos.push_back(2);
+	std::vector<Page*> pages;
+	bufMgr->readPages(file1, pageNos, pages);
+	checkPassFail(pages.size(), 5)
+	bool numbered = true;
+	for(std::size_t i = 0; i < pages.size(); i++)
+	{
+		numbered = numbered && pages[i]->page_number() == pageNos[i];
+	}
+	checkPassFail(numbered, true)
+	checkPassFail(pages[1], cached)
+	checkPassFail(pages[4], pages[0])
+
+	// each appearance is a pin of its own
+	bufMgr->unPinPage(file1, 3, false);
+	for(std::size_t i = 0; i < pageNos.size(); i++)
+	{
+		bufMgr->unPinPage(file1, pageNos[i], false);
+	}
+	bool thrown = false;
+	try
+	{
+		bufMgr->unPinPage(file1, 2, false);
+	}
+	catch(const PageNotPinnedException &e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+
+	// a page which doesn't exist leaves none of the others pinned
+	std::vector<PageId> badPageNos;
+	badPageNos.push_back(5);
+	badPageNos.push_back(1000);
+	thrown = false;
+	try
+	{
+		bufMgr->readPages(file1, badPageNos, pages);
+	}
+	catch(const InvalidPageException &e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+	thrown = false;
+	try
+	{
+		bufMgr->unPinPage(file1, 5, false);
+	}
+	catch(const PageNotPinnedException &e)
+	{
+		thrown = true;
+	}
+	catch(const HashNotFoundException &e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+
+	// the consecutive form reads the run too
+	bufMgr->readPages(file1, 2, 3, pages);
+	checkPassFail(pages[2]->page_number(), 4)
+	for(PageId pageNo = 2; pageNo < 5; pageNo++)
+	{
+		bufMgr->unPinPage(file1, pageNo, false);
+	}
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// recordViewTests
+// -----------------------------------------------------------------------------
+
+void recordViewTests()
+{
+	std::cout << "Record view tests" << std::endl;
+	std::cout << "-----------------" << std::endl;
+
+	Page page;
+	std::vector<RecordId> rids;
+	rids.push_back(page.insertRecord("first view record"));
+	rids.push_back(page.insertRecord("second"));
+	rids.push_back(page.insertRecord("third view record"));
+
+	// views point into the page rather than at a copy
+	const char* pageStart = reinterpret_cast<const char*>(&page);
+	const char* pageEnd = pageStart + sizeof(Page);
+	RecordView view = page.getRecordView(rids[1]);
+	checkPassFail((view == RecordView("second")), true)
+	checkPassFail((view.data() >= pageStart && view.data() + view.size() <= pageEnd), true)
+	checkPassFail((view.toString() == page.getRecord(rids[1])), true)
+
+	// all at once, and starting after a slot
+	RecordId viewRids[8];
+	RecordView views[8];
+	SlotId lastSlot;
+	checkPassFail(page.getRecordViews(Page::INVALID_SLOT, 8, viewRids, views, lastSlot), 3)
+	checkPassFail(lastSlot, Page::INVALID_SLOT)
+	checkPassFail((views[2] == RecordView("third view record")), true)
+	checkPassFail(page.getRecordViews(rids[0].slot_number, 1, viewRids, views, lastSlot), 1)
+	checkPassFail(viewRids[0].slot_number, rids[1].slot_number)
+	checkPassFail(lastSlot, rids[1].slot_number)
+	checkPassFail((views[0] == view), true)
+
+	// the iterator hands out the same views
+	int matched = 0;
+	for(PageIterator iter = page.begin(); iter != page.end(); ++iter)
+	{
+		if(*iter == page.getRecordView(rids[matched]))
+		{
+			matched++;
+		}
+	}
+	checkPassFail(matched, 3)
+
+	// and so does a file scan
+	std::vector<int> keys;
+	for(int i = 0; i < 50; i++)
+	{
+		keys.push_back(i);
+	}
+	createRelation(keys);
+	{
+		FileScan fscan(relationName, bufMgr);
+		RecordId scanRid;
+		fscan.scanNext(scanRid);
+		RecordView scanned = fscan.getRecordView();
+		checkPassFail(scanned.size(), sizeof(RECORD))
+		checkPassFail((scanned.toString() == fscan.getRecord()), true)
+		checkPassFail(*reinterpret_cast<const int*>(scanned.data() + offsetof(RECORD, i)), 0)
+	}
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// lazyDeleteTests
+// -----------------------------------------------------------------------------
+
+void lazyDeleteTests()
+{
+	std::cout << "Lazy delete tests" << std::endl;
+	std::cout << "-----------------" << std::endl;
+
+	Page page;
+	const RecordId first = page.insertRecord(std::string(1000, 'a'));
+	const RecordId middle = page.insertRecord(std::string(1000, 'b'));
+	const RecordId last = page.insertRecord(std::string(1000, 'c'));
+	const char* lastData = page.getRecordView(last).data();
+	const std::uint16_t freeSpace = page.getFreeSpace();
+
+	// deleting leaves the other records where they are, but counts the hole as free
+	page.deleteRecord(middle);
+	checkPassFail((page.getRecordView(last).data() == lastData), true)
+	checkPassFail(page.getFreeSpace(), freeSpace + 1000)
+
+	// a record which only fits in the hole as well compacts the page first
+	const std::string big(page.getFreeSpace() - sizeof(PageSlot), 'd');
+	checkPassFail(page.hasSpaceForRecord(big), true)
+	const RecordId bigId = page.insertRecord(big);
+	checkPassFail((page.getRecordView(last).data() != lastData), true)
+	checkPassFail((page.getRecord(first) == std::string(1000, 'a')), true)
+	checkPassFail((page.getRecord(last) == std::string(1000, 'c')), true)
+	checkPassFail((page.getRecord(bigId) == big), true)
+	checkPassFail((page.getFreeSpace() <= sizeof(PageSlot)), true)
+
+	// the record at the free space boundary goes straight back, without compacting
+	const char* bigData = page.getRecordView(bigId).data();
+	lastData = page.getRecordView(last).data();
+	page.deleteRecord(bigId);
+	const std::string again(big.size(), 'e');
+	const RecordId againId = page.insertRecord(again);
+	checkPassFail((page.getRecordView(againId).data() == bigData), true)
+	checkPassFail((page.getRecordView(last).data() == lastData), true)
+	checkPassFail((page.getRecord(againId) == again), true)
+	checkPassFail((page.getRecord(last) == std::string(1000, 'c')), true)
+}
+
+// -----------------------------------------------------------------------------
+// appendRecordsTests
+// -----------------------------------------------------------------------------
+
+void appendRecordsTests()
+{
+	std::cout << "Append records tests" << std::endl;
+	std::cout << "--------------------" << std::endl;
+
+	// a page takes records until the next one doesn't fit, in slot order
+	std::vector<std::string> records;
+	for(int i = 0; i < 1200; i++)
+	{
+		char text[16];
+		sprintf(text, "%05d", i);
+		records.push_back(std::string(text) + std::string(995, 'r'));
+	}
+	Page page;
+	const std::size_t perPage = page.insertRecords(records, 10);
+	checkPassFail((perPage > 1 && perPage < records.size() - 10), true)
+	checkPassFail((page.getRecord(RecordId{Page::INVALID_NUMBER, 1, 0}) == records[10]), true)
+	checkPassFail(page.insertRecords(records, 10), 0)
+
+	const std::string name = "appendTest";
+	for(int compress = 0; compress < 2; compress++)
+	{
+		{
+			// enough records for more than one run of pages
+			PageFile file = PageFile::create(name, false, compress);
+			std::vector<RecordId> rids;
+			file.appendRecords(records, rids);
+			checkPassFail(rids.size(), records.size())
+			checkPassFail(rids[perPage].slot_number, 1)
+			checkPassFail((rids.back().page_number - rids.front().page_number >= PageFile::APPEND_RUN_PAGES), true)
+			bool stored = true;
+			for(std::size_t i = 0; i < rids.size(); i += 97)
+			{
+				stored = stored && file.readPage(rids[i].page_number).getRecord(rids[i]) == records[i];
+			}
+			checkPassFail(stored, true)
+			checkPassFail((file.readPage(rids.back().page_number).getRecord(rids.back()) == records.back()), true)
+
+			// the records before one which fits on no page are still appended
+			std::vector<std::string> tooBig;
+			tooBig.push_back("before");
+			tooBig.push_back(std::string(Page::SIZE, 'x'));
+			bool thrown = false;
+			try
+			{
+				file.appendRecords(tooBig, rids);
+			}
+			catch(const InsufficientSpaceException &e)
+			{
+				thrown = true;
+			}
+			checkPassFail(thrown, true)
+			checkPassFail(countRecords(&file), static_cast<int>(records.size()) + 1)
+			bufMgr->flushFile(&file);
+		}
+		File::remove(name);
+	}
+}
+
+// -----------------------------------------------------------------------------
+// fixedWidthTests
+// -----------------------------------------------------------------------------
+
+void fixedWidthTests()
+{
+	std::cout << "Fixed-width page tests" << std::endl;
+	std::cout << "----------------------" << std::endl;
+
+	const std::string name = "fixedWidthTest";
+	{
+		PageFile file = PageFile::create(name);
+		PageId pageNo;
+		Page page = file.allocatePage(pageNo);
+		FixedWidthPage<sizeof(RECORD)> fixed(&page);
+
+		// no slot array, so more records fit than on a slotted page
+		int inserted = 0;
+		while(!fixed.isFull())
+		{
+			record1.i = inserted++;
+			fixed.insertRecord(&record1);
+		}
+		checkPassFail(fixed.numRecords(), FixedWidthPage<sizeof(RECORD)>::CAPACITY)
+		checkPassFail((inserted * sizeof(RECORD) > Page::DATA_SIZE - inserted * sizeof(PageSlot)), true)
+		bool thrown = false;
+		try
+		{
+			fixed.insertRecord(&record1);
+		}
+		catch(const InsufficientSpaceException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+
+		// the lowest free slot is reused
+		const RecordId third = RecordId{pageNo, 3, 0};
+		fixed.deleteRecord(RecordId{pageNo, 7, 0});
+		fixed.deleteRecord(third);
+		record1.i = -1;
+		checkPassFail(fixed.insertRecord(&record1).slot_number, 3)
+		checkPassFail(*reinterpret_cast<const int*>(fixed.getRecord(third) + offsetof(RECORD, i)), -1)
+
+		// records of another width are turned away
+		thrown = false;
+		try
+		{
+			page.insertRecord("wrong width");
+		}
+		catch(const RecordWidthException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+		thrown = false;
+		try
+		{
+			FixedWidthPage<40> narrow(&page);
+		}
+		catch(const RecordWidthException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+		file.writePage(pageNo, page);
+	}
+	{
+		// the format is kept on disk, and the generic page interface reads it
+		PageFile file(name, false);
+		Page page = file.readPage(2);
+		checkPassFail(page.isFixedWidth(), true)
+		FixedWidthPage<sizeof(RECORD)> fixed(&page);
+		checkPassFail(fixed.numRecords(), FixedWidthPage<sizeof(RECORD)>::CAPACITY - 1)
+		checkPassFail(page.getRecord(RecordId{2, 3, 0}).size(), sizeof(RECORD))
+		checkPassFail(countRecords(&file), static_cast<int>(fixed.numRecords()))
+		bufMgr->flushFile(&file);
+	}
+	File::remove(name);
+}
+
+// -----------------------------------------------------------------------------
+// paxTests
+// -----------------------------------------------------------------------------
+
+void paxTests()
+{
+	std::cout << "PAX page tests" << std::endl;
+	std::cout << "--------------" << std::endl;
+
+	// records of {int, double, char[64]} with no padding between attributes
+	std::vector<std::uint16_t> widths;
+	widths.push_back(sizeof(int));
+	widths.push_back(sizeof(double));
+	widths.push_back(64);
+	const std::size_t width = sizeof(int) + sizeof(double) + 64;
+
+	const std::string name = "paxTest";
+	std::vector<RecordId> rids;
+	{
+		PageFile file = PageFile::create(name);
+		PageId pageNo;
+		Page page = file.allocatePage(pageNo);
+		PaxPage pax(&page, widths);
+		checkPassFail(pax.recordWidth(), width)
+		checkPassFail(pax.attributeWidth(1), sizeof(double))
+		for(int i = 0; i < 50; i++)
+		{
+			char record[width];
+			memset(record, ' ', width);
+			memcpy(record, &i, sizeof(int));
+			const double d = i * 0.5;
+			memcpy(record + sizeof(int), &d, sizeof(double));
+			sprintf(record + sizeof(int) + sizeof(double), "%05d pax record", i);
+			rids.push_back(pax.insertRecord(record));
+		}
+		checkPassFail(pax.numRecords(), 50)
+
+		// each attribute is a dense array of its own
+		const int* ints = pax.columnAs<int>(0);
+		const double* doubles = pax.columnAs<double>(1);
+		checkPassFail(ints[49], 49)
+		checkPassFail(doubles[49], 24.5)
+		checkPassFail((reinterpret_cast<std::uintptr_t>(doubles) % 8), 0)
+
+		// records are assembled from their attributes
+		char record[width];
+		pax.readRecord(rids[7], record);
+		checkPassFail(*reinterpret_cast<const int*>(record), 7)
+		const std::string generic = page.getRecord(rids[7]);
+		checkPassFail(generic.size(), width)
+		checkPassFail((memcmp(generic.data(), record, width) == 0), true)
+
+		// the page's own record operations scatter them back
+		std::string updated = generic;
+		const int newKey = 1007;
+		memcpy(&updated[0], &newKey, sizeof(int));
+		page.updateRecord(rids[7], updated);
+		checkPassFail(ints[rids[7].slot_number - 1], 1007)
+		page.deleteRecord(rids[8]);
+		checkPassFail(pax.isUsed(rids[8].slot_number), false)
+		checkPassFail(ints[rids[8].slot_number - 1], 0)
+
+		// but can't view a record in place
+		bool thrown = false;
+		try
+		{
+			page.getRecordView(rids[0]);
+		}
+		catch(const PageLayoutException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+		file.writePage(pageNo, page);
+	}
+	{
+		// iterators and scans work a row at a time
+		PageFile file(name, false);
+		Page page = file.readPage(2);
+		int rows = 0;
+		for(PageIterator iter = page.begin(); iter != page.end(); ++iter)
+		{
+			rows++;
+		}
+		checkPassFail(rows, 49)
+		checkPassFail(countRecords(&file), 49)
+
+		{
+			FileScan fscan(&file, bufMgr);
+			RecordId scanRid;
+			fscan.scanNext(scanRid);
+			checkPassFail(scanRid.slot_number, 1)
+			checkPassFail(fscan.getRecord().size(), width)
+			checkPassFail(*reinterpret_cast<const int*>(fscan.getRecord().data()), 0)
+		}
+		{
+			// or hand out whole pages for reading by column
+			FileScan fscan(&file, bufMgr);
+			const Page* scanned = fscan.scanNextPage();
+			checkPassFail(scanned->isPax(), true)
+			checkPassFail(scanned->page_number(), 2)
+		}
+		bufMgr->flushFile(&file);
+	}
+	File::remove(name);
+}
+
+// -----------------------------------------------------------------------------
+// overflowTests
+// -----------------------------------------------------------------------------
+
+void overflowTests()
+{
+	std::cout << "Overflow tests" << std::endl;
+	std::cout << "--------------" << std::endl;
+
+	const std::string overflowName = OverflowFile::companionName(relationName);
+	const std::string shortValue = "short attribute";
+	const std::string longValue(3 * Page::SIZE, 'L');
+	std::string encodedLong;
+	{
+		OverflowFile overflow = OverflowFile::create(overflowName);
+
+		// short values stay in the record, long ones leave a pointer behind
+		const std::string encodedShort = overflow.encodeAttribute(shortValue);
+		checkPassFail(OverflowFile::isOutOfLine(encodedShort.data()), false)
+		checkPassFail(OverflowFile::encodedSize(encodedShort.data()), encodedShort.size())
+		encodedLong = overflow.encodeAttribute(longValue);
+		checkPassFail(OverflowFile::isOutOfLine(encodedLong.data()), true)
+		checkPassFail(OverflowFile::encodedSize(encodedLong.data()), encodedLong.size())
+		checkPassFail((encodedLong.size() < shortValue.size() + 16), true)
+		checkPassFail((overflow.decodeAttribute(encodedShort.data()) == shortValue), true)
+		checkPassFail((overflow.decodeAttribute(encodedLong.data()) == longValue), true)
+
+		// a scan fetches the value of the attribute it asks for
+		file1 = new PageFile(relationName, true);
+		std::vector<std::string> records;
+		for(int i = 0; i < 20; i++)
+		{
+			const std::string& encoded = i % 2 ? encodedShort : encodedLong;
+			records.push_back(std::string(reinterpret_cast<const char*>(&i), sizeof(int)) + encoded);
+		}
+		std::vector<RecordId> rids;
+		file1->appendRecords(records, rids);
+		{
+			FileScan fscan(file1, bufMgr);
+			fscan.setOverflowFile(&overflow);
+			bool decoded = true;
+			RecordId scanRid;
+			try
+			{
+				while(1)
+				{
+					fscan.scanNext(scanRid);
+					const int key = fscan.getAttributeAs<int>(0);
+					const std::string& expected = key % 2 ? shortValue : longValue;
+					decoded = decoded && fscan.getAttribute(sizeof(int)) == expected;
+				}
+			}
+			catch(const EndOfFileException &e)
+			{
+			}
+			checkPassFail(decoded, true)
+		}
+		deleteRelation();
+
+		// freed pages are reused rather than appended
+		const std::string spare = overflow.encodeAttribute(longValue);
+		struct stat st;
+		stat(overflowName.c_str(), &st);
+		const off_t size = st.st_size;
+		overflow.freeAttribute(spare.data());
+		const OverflowPointer again = overflow.writeValue(longValue);
+		stat(overflowName.c_str(), &st);
+		checkPassFail(st.st_size, size)
+		checkPassFail((overflow.readValue(again) == longValue), true)
+
+		// a relation given the overflow file moves long values there as records are stored
+		file1 = new PageFile(relationName, true);
+		file1->setOverflowAttributes(&overflow, sizeof(int), 1);
+		const int key = 1;
+		const std::string keyBytes(reinterpret_cast<const char*>(&key), sizeof(int));
+		const std::string record = keyBytes + overflow.encodeAttribute(longValue, longValue.size());
+		const RecordId rid = bufMgr->insertRecord(file1, record);
+		const std::string stored = bufMgr->readRecord(file1, rid);
+		checkPassFail(OverflowFile::isOutOfLine(stored.data() + sizeof(int)), true)
+		checkPassFail((overflow.decodeAttribute(stored.data() + sizeof(int)) == longValue), true)
+		stat(overflowName.c_str(), &st);
+		const off_t storedSize = st.st_size;
+
+		// and frees them as records are deleted, or updated to no longer hold them
+		bufMgr->deleteRecord(file1, rid);
+		const RecordId second = bufMgr->insertRecord(file1, record);
+		bufMgr->updateRecord(file1, second, keyBytes + encodedShort);
+		checkPassFail((bufMgr->readRecord(file1, second) == keyBytes + encodedShort), true)
+		const RecordId third = bufMgr->insertRecord(file1, record);
+		stat(overflowName.c_str(), &st);
+		checkPassFail(st.st_size, storedSize)
+
+		// a value the new version still points to stays
+		const std::string thirdStored = bufMgr->readRecord(file1, third);
+		bufMgr->updateRecord(file1, third, thirdStored + "tail");
+		checkPassFail((overflow.decodeAttribute(bufMgr->readRecord(file1, third).data() + sizeof(int)) == longValue), true)
+		deleteRelation();
+	}
+	{
+		// values outlive the file object
+		OverflowFile overflow = OverflowFile::open(overflowName);
+		checkPassFail((overflow.decodeAttribute(encodedLong.data()) == longValue), true)
+	}
+	File::remove(overflowName);
+}
+
+// -----------------------------------------------------------------------------
+// predicateTests
+// -----------------------------------------------------------------------------
+
+void predicateTests()
+{
+	std::cout << "Predicate tests" << std::endl;
+	std::cout << "---------------" << std::endl;
+
+	// conditions compare an attribute at an offset against a constant
+	RECORD record;
+	memset(&record, 0, sizeof(record));
+	record.i = 5;
+	record.d = 2.5;
+	sprintf(record.s, "%05d string record", 5);
+	const RecordView view(reinterpret_cast<const char*>(&record), sizeof(record));
+	checkPassFail(ScanCondition::ofInteger(offsetof(RECORD, i), ScanCondition::LTE, 5).matches(view), true)
+	checkPassFail(ScanCondition::ofInteger(offsetof(RECORD, i), ScanCondition::GT, 5).matches(view), false)
+	checkPassFail(ScanCondition::ofDouble(offsetof(RECORD, d), ScanCondition::LT, 3.0).matches(view), true)
+	checkPassFail(ScanCondition::ofString(offsetof(RECORD, s), ScanCondition::EQ, "00005").matches(view), true)
+	checkPassFail(ScanCondition::ofString(offsetof(RECORD, s), ScanCondition::GTE, "00006").matches(view), false)
+
+	// NaN is unordered, so only differs
+	record.d = std::numeric_limits<double>::quiet_NaN();
+	checkPassFail(ScanCondition::ofDouble(offsetof(RECORD, d), ScanCondition::GTE, 0.0).matches(view), false)
+	checkPassFail(ScanCondition::ofDouble(offsetof(RECORD, d), ScanCondition::NE, 0.0).matches(view), true)
+
+	// an attribute past the end of the record doesn't match
+	const RecordView shortView(reinterpret_cast<const char*>(&record), sizeof(int));
+	checkPassFail(ScanCondition::ofDouble(offsetof(RECORD, d), ScanCondition::NE, 0.0).matches(shortView), false)
+
+	std::vector<int> keys;
+	for(int i = 0; i < 500; i++)
+	{
+		keys.push_back(i);
+	}
+	createRelation(keys);
+	{
+		// a scan returns only the records matching every condition and filter
+		FileScan scan(file1, bufMgr);
+		ScanPredicate predicate;
+		predicate.add(ScanCondition::ofInteger(offsetof(RECORD, i), ScanCondition::GTE, 100))
+			.add(ScanCondition::ofDouble(offsetof(RECORD, d), ScanCondition::LT, 200.0))
+			.add([](const RecordView &r)
+			{
+				int key;
+				memcpy(&key, r.data() + offsetof(RECORD, i), sizeof(int));
+				return key != 150;
+			});
+		scan.setPredicate(predicate);
+		int count = 0;
+		bool matched = true;
+		RecordId scanRid;
+		try
+		{
+			while(1)
+			{
+				scan.scanNext(scanRid);
+				const int key = scan.getAttributeAs<int>(offsetof(RECORD, i));
+				matched = matched && key >= 100 && key < 200 && key != 150;
+				count++;
+			}
+		}
+		catch(const EndOfFileException &e)
+		{
+		}
+		checkPassFail(count, 99)
+		checkPassFail(matched, true)
+	}
+	{
+		FileScan scan(file1, bufMgr);
+		ScanPredicate predicate;
+		predicate.add(ScanCondition::ofString(offsetof(RECORD, s), ScanCondition::EQ, "00042 string"));
+		scan.setPredicate(predicate);
+		RecordId scanRid;
+		scan.scanNext(scanRid);
+		checkPassFail(scan.getAttributeAs<int>(offsetof(RECORD, i)), 42)
+		bool ended = false;
+		try
+		{
+			scan.scanNext(scanRid);
+		}
+		catch(const EndOfFileException &e)
+		{
+			ended = true;
+		}
+		checkPassFail(ended, true)
+	}
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// parallelScanTests
+// -----------------------------------------------------------------------------
+
+void parallelScanTests()
+{
+	std::cout << "Parallel scan tests" << std::endl;
+	std::cout << "-------------------" << std::endl;
+
+	std::vector<int> keys;
+	for(int i = 0; i < 2000; i++)
+	{
+		keys.push_back(i);
+	}
+	createRelation(keys);
+	{
+		// every record reaches the sink exactly once, whichever worker scans it
+		ParallelScan scan(file1, bufMgr, 4, 2);
+		checkPassFail(scan.numWorkers(), 4)
+		std::vector<std::vector<int> > seen(scan.numWorkers());
+		scan.run([&seen](unsigned worker, const RecordId &rid, const RecordView &record)
+		{
+			int key;
+			memcpy(&key, record.data() + offsetof(RECORD, i), sizeof(int));
+			seen[worker].push_back(key);
+		});
+		std::vector<int> all;
+		for(std::size_t i = 0; i < seen.size(); i++)
+		{
+			all.insert(all.end(), seen[i].begin(), seen[i].end());
+		}
+		std::sort(all.begin(), all.end());
+		checkPassFail((all == keys), true)
+	}
+	{
+		// the predicate is applied by the workers
+		ParallelScan scan(file1, bufMgr, 3);
+		ScanPredicate predicate;
+		predicate.add(ScanCondition::ofInteger(offsetof(RECORD, i), ScanCondition::LT, 100));
+		scan.setPredicate(predicate);
+		std::atomic<int> count(0);
+		scan.run([&count](unsigned worker, const RecordId &rid, const RecordView &record)
+		{
+			count++;
+		});
+		checkPassFail(count.load(), 100)
+	}
+	{
+		// a sink's exception stops the scan and comes out of run
+		ParallelScan scan(file1, bufMgr, 2, 1);
+		bool thrown = false;
+		try
+		{
+			scan.run([](unsigned worker, const RecordId &rid, const RecordView &record)
+			{
+				throw std::runtime_error("sink failed");
+			});
+		}
+		catch(const std::runtime_error &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+	}
+	bool thrown = false;
+	try
+	{
+		ParallelScan scan(file1, bufMgr, 2, 0);
+	}
+	catch(const BadScanParamException &e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+
+	// records held dirty in the buffer pool are seen, once they can be written out
+	RECORD record;
+	memset(&record, 0, sizeof(RECORD));
+	record.i = 5000;
+	const RecordId rid = bufMgr->insertRecord(file1, std::string(reinterpret_cast<char*>(&record), sizeof(RECORD)));
+	Page *page;
+	bufMgr->readPage(file1, rid.page_number, page);
+	std::atomic<int> count(0);
+	std::atomic<int> found(0);
+	auto countKeys = [&count, &found](unsigned worker, const RecordId &rid, const RecordView &record)
+	{
+		int key;
+		memcpy(&key, record.data() + offsetof(RECORD, i), sizeof(int));
+		count++;
+		if(key == 5000)
+			found++;
+	};
+	thrown = false;
+	try
+	{
+		ParallelScan scan(file1, bufMgr, 2);
+		scan.run(countKeys);
+	}
+	catch(const PagePinnedException &e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+	checkPassFail(count.load(), 0)
+	bufMgr->unPinPage(file1, rid.page_number, false);
+	{
+		ParallelScan scan(file1, bufMgr, 2);
+		scan.run(countKeys);
+	}
+	checkPassFail(count.load(), 2001)
+	checkPassFail(found.load(), 1)
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// readOnlyScanTests
+// -----------------------------------------------------------------------------
+
+void readOnlyScanTests()
+{
+	std::cout << "Read-only scan tests" << std::endl;
+	std::cout << "--------------------" << std::endl;
+
+	std::vector<int> keys;
+	for(int i = 0; i < 200; i++)
+	{
+		keys.push_back(i);
+	}
+	createRelation(keys);
+
+	// scans of the caller's file leave its pages cached for the next one
+	bufMgr->clearBufStats();
+	checkPassFail(countRecords(file1), 200)
+	checkPassFail((bufMgr->getBufStats().diskreads > 0), true)
+	bufMgr->clearBufStats();
+	checkPassFail(countRecords(file1), 200)
+	checkPassFail(bufMgr->getBufStats().diskreads, 0)
+
+	// which they can't change
+	bool thrown = false;
+	{
+		FileScan scan(file1, bufMgr);
+		RecordId scanRid;
+		scan.scanNext(scanRid);
+		try
+		{
+			scan.markDirty();
+		}
+		catch(const ReadOnlyFileException &e)
+		{
+			thrown = true;
+		}
+	}
+	checkPassFail(thrown, true)
+
+	// a write-back scan writes the pages it changed, and keeps them too
+	bufMgr->clearBufStats();
+	{
+		FileScan scan(file1, bufMgr, FileScan::WRITE_BACK);
+		RecordId scanRid;
+		scan.scanNext(scanRid);
+		scan.markDirty();
+	}
+	checkPassFail(bufMgr->getBufStats().diskwrites, 1)
+	bufMgr->clearBufStats();
+	checkPassFail(countRecords(file1), 200)
+	checkPassFail(bufMgr->getBufStats().diskreads, 0)
+
+	// a scan by name has a file object of its own, so it reads from disk
+	bufMgr->clearBufStats();
+	{
+		FileScan scan(relationName, bufMgr);
+		RecordId scanRid;
+		scan.scanNext(scanRid);
+	}
+	checkPassFail((bufMgr->getBufStats().diskreads > 0), true)
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// projectionTests
+// -----------------------------------------------------------------------------
+
+void projectionTests()
+{
+	std::cout << "Projection tests" << std::endl;
+	std::cout << "----------------" << std::endl;
+
+	// a copy of each key at the start of the string attribute, so an index can be built on a key
+	// which isn't at the start of the record
+	try
+	{
+		File::remove(relationName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	file1 = new PageFile(relationName, true);
+	std::vector<std::string> records;
+	for(int i = 0; i < 300; i++)
+	{
+		memset(&record1, 0, sizeof(record1));
+		record1.i = i;
+		record1.d = i * 1.5;
+		memcpy(record1.s, &i, sizeof(int));
+		records.push_back(std::string(reinterpret_cast<char*>(&record1), sizeof(RECORD)));
+	}
+	std::vector<RecordId> rids;
+	file1->appendRecords(records, rids);
+
+	{
+		// single attributes come straight off the page
+		FileScan scan(file1, bufMgr);
+		RecordId scanRid;
+		scan.scanNext(scanRid);
+		scan.scanNext(scanRid);
+		int key;
+		scan.readAttribute(offsetof(RECORD, s), sizeof(int), &key);
+		checkPassFail(key, 1)
+		checkPassFail(scan.getAttributeAs<double>(offsetof(RECORD, d)), 1.5)
+		bool thrown = false;
+		try
+		{
+			scan.readAttribute(sizeof(RECORD) - sizeof(int), sizeof(double), &key);
+		}
+		catch(const BadScanParamException &e)
+		{
+			thrown = true;
+		}
+		checkPassFail(thrown, true)
+	}
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(RECORD, s), INTEGER);
+		checkPassFail(intScan(&index, 10, GTE, 20, LT), 10)
+		checkPassFail(intScan(&index, 290, GT, 400, LT), 9)
+	}
+	deleteRelation();
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+}
+
+// -----------------------------------------------------------------------------
+// sampleScanTests
+// -----------------------------------------------------------------------------
+
+void sampleScanTests()
+{
+	std::cout << "Sample scan tests" << std::endl;
+	std::cout << "-----------------" << std::endl;
+
+	std::vector<int> keys;
+	for(int i = 0; i < 2000; i++)
+	{
+		keys.push_back(i);
+	}
+	createRelation(keys);
+	int numPages = 0;
+	for(FileIterator iter = file1->begin(); iter != file1->end(); ++iter)
+	{
+		numPages++;
+	}
+
+	// a page sample returns every record of the pages it picks, in file order
+	const std::size_t wanted = static_cast<std::size_t>(numPages * 0.25 + 0.5);
+	std::vector<int> pageSample;
+	double weight;
+	{
+		SampleScan scan(file1, bufMgr, SampleScan::PAGES, 0.25, 7);
+		checkPassFail(scan.numSampledPages(), wanted)
+		RecordId scanRid;
+		try
+		{
+			while(1)
+			{
+				scan.scanNext(scanRid);
+				pageSample.push_back(*reinterpret_cast<const int*>(scan.getRecordView().data() + offsetof(RECORD, i)));
+			}
+		}
+		catch(const EndOfFileException &e)
+		{
+		}
+		weight = scan.getWeight();
+	}
+	checkPassFail(weight, static_cast<double>(numPages) / wanted)
+	checkPassFail(std::is_sorted(pageSample.begin(), pageSample.end()), true)
+	checkPassFail((pageSample.size() * weight > 1500 && pageSample.size() * weight < 2500), true)
+
+	// the same seed picks the same sample
+	std::vector<int> again;
+	{
+		SampleScan scan(relationName, bufMgr, SampleScan::PAGES, 0.25, 7);
+		RecordId scanRid;
+		try
+		{
+			while(1)
+			{
+				scan.scanNext(scanRid);
+				again.push_back(*reinterpret_cast<const int*>(scan.getRecord().data() + offsetof(RECORD, i)));
+			}
+		}
+		catch(const EndOfFileException &e)
+		{
+		}
+	}
+	checkPassFail((again == pageSample), true)
+
+	// a record sample keeps each record with the given probability
+	for(int percent = 10; percent <= 100; percent += 90)
+	{
+		SampleScan scan(file1, bufMgr, SampleScan::RECORDS, percent / 100.0, 11);
+		checkPassFail(scan.getWeight(), 100.0 / percent)
+		std::vector<int> sample;
+		RecordId scanRid;
+		try
+		{
+			while(1)
+			{
+				scan.scanNext(scanRid);
+				sample.push_back(*reinterpret_cast<const int*>(scan.getRecordView().data() + offsetof(RECORD, i)));
+			}
+		}
+		catch(const EndOfFileException &e)
+		{
+		}
+		checkPassFail(std::is_sorted(sample.begin(), sample.end()), true)
+		checkPassFail((sample.size() * scan.getWeight() > 1500 && sample.size() * scan.getWeight() < 2500), true)
+		if(percent == 100)
+		{
+			checkPassFail((sample == keys), true)
+		}
+	}
+
+	bool thrown = false;
+	try
+	{
+		SampleScan scan(file1, bufMgr, SampleScan::RECORDS, 0, 11);
+	}
+	catch(const BadScanParamException &e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+	deleteRelation();
+}
+
+// -----------------------------------------------------------------------------
+// createRelation
+// -----------------------------------------------------------------------------
+
+void createRelation(const std::vector<int> &keys)
+{
+	try
+	{
+		File::remove(relationName);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+  file1 = new PageFile(relationName, true);
+
+  memset(record1.s, ' ', sizeof(record1.s));
+	std::vector<std::string> records;
+	for(std::size_t i = 0; i < keys.size(); i++)
+	{
+    sprintf(record1.s, "%05d string record", keys[i]);
+    record1.i = keys[i];
+    record1.d = keys[i];
+    records.push_back(std::string(reinterpret_cast<char*>(&record1), sizeof(RECORD)));
+	}
+
+	std::vector<RecordId> ridVec;
+	file1->appendRecords(records, ridVec);
+}
+
+int countRecords(PageFile *file)
+{
+	int count = 0;
+	FileScan scan(file, bufMgr);
+	try
+	{
+		RecordId scanRid;
+		while(1)
+		{
+			scan.scanNext(scanRid);
+			count++;
+		}
+	}
+	catch(const EndOfFileException &e)
+	{
+	}
+	return count;
+}
+
+PageZone pageZone(PageFile *file, const PageId pageNo)
+{
+	FileIterator iter = file->begin();
+	while(iter != file->end() && (*iter).page_number() != pageNo)
+	{
+		++iter;
+	}
+	return iter.getDirectoryEntry().zones[0];
+}
+
+unsigned long long bytesRead()
+{
+	// bytes this process has read so far, or 0 where the kernel doesn't say
+	unsigned long long bytes = 0;
+	std::FILE* io = std::fopen("/proc/self/io", "r");
+	if(io != NULL)
+	{
+		if(std::fscanf(io, "rchar: %llu", &bytes) != 1)
+			bytes = 0;
+		std::fclose(io);
+	}
+	return bytes;
+}
+
 void deleteRelation()
 {
 	if(file1)
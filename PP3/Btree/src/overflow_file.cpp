@@ -0,0 +1,264 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "overflow_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "exceptions/invalid_page_exception.h"
+
+namespace badgerdb {
+
+const std::size_t OverflowFile::DEFAULT_THRESHOLD;
+const char OverflowFile::INLINE;
+const char OverflowFile::OUT_OF_LINE;
+const std::size_t OverflowFile::CHUNK_SIZE;
+
+OverflowFile OverflowFile::create(const std::string& filename) {
+  return OverflowFile(filename, true /* create_new */);
+}
+
+OverflowFile OverflowFile::open(const std::string& filename) {
+  return OverflowFile(filename, false /* create_new */);
+}
+
+OverflowFile::OverflowFile(const std::string& name, const bool create_new)
+: BlobFile(name, create_new) {
+}
+
+OverflowPointer OverflowFile::writeValue(const std::string& value) {
+  OverflowPointer pointer;
+  pointer.first_page_number = Page::INVALID_NUMBER;
+  pointer.length = static_cast<std::uint32_t>(value.size());
+  if (value.empty()) {
+    return pointer;
+  }
+
+  // Take every page first so that each can be written once, already linked.
+  FileHeader header = readHeader();
+  std::vector<PageId> chain((value.size() + CHUNK_SIZE - 1) / CHUNK_SIZE);
+  for (std::size_t i = 0; i < chain.size(); ++i) {
+    chain[i] = takePage(header);
+  }
+  writeHeader(header);
+
+  Page page;
+  char* bytes = reinterpret_cast<char*>(&page);
+  for (std::size_t i = 0; i < chain.size(); ++i) {
+    ChainHeader chain_header;
+    chain_header.next_page_number =
+        i + 1 < chain.size() ? chain[i + 1] : Page::INVALID_NUMBER;
+    chain_header.length = static_cast<std::uint32_t>(
+        std::min(CHUNK_SIZE, value.size() - i * CHUNK_SIZE));
+    std::memcpy(bytes, &chain_header, sizeof(ChainHeader));
+    std::memcpy(bytes + sizeof(ChainHeader), value.data() + i * CHUNK_SIZE,
+                chain_header.length);
+    writePageSlot(chain[i], page);
+  }
+
+  pointer.first_page_number = chain.front();
+  return pointer;
+}
+
+std::string OverflowFile::readValue(const OverflowPointer& pointer) const {
+  std::string value;
+  value.reserve(pointer.length);
+
+  Page page;
+  const char* bytes = reinterpret_cast<const char*>(&page);
+  PageId page_number = pointer.first_page_number;
+  while (value.size() < pointer.length) {
+    if (page_number == Page::INVALID_NUMBER) {
+      throw InvalidPageException(page_number, filename());
+    }
+    readPageSlot(page_number, page);
+    ChainHeader chain_header;
+    std::memcpy(&chain_header, bytes, sizeof(ChainHeader));
+    if (chain_header.length > CHUNK_SIZE ||
+        chain_header.length > pointer.length - value.size()) {
+      throw InvalidPageException(page_number, filename());
+    }
+    value.append(bytes + sizeof(ChainHeader), chain_header.length);
+    page_number = chain_header.next_page_number;
+  }
+  return value;
+}
+
+void OverflowFile::freeValue(const OverflowPointer& pointer) {
+  FileHeader header = readHeader();
+  Page page;
+  char* bytes = reinterpret_cast<char*>(&page);
+  PageId page_number = pointer.first_page_number;
+  std::size_t remaining = pointer.length;
+  while (remaining > 0 && page_number != Page::INVALID_NUMBER) {
+    readPageSlot(page_number, page);
+    ChainHeader chain_header;
+    std::memcpy(&chain_header, bytes, sizeof(ChainHeader));
+    const PageId next_page_number = chain_header.next_page_number;
+    remaining -= std::min<std::size_t>(remaining, chain_header.length);
+
+    // Push the page onto the free list, linked the same way as chains.
+    chain_header.next_page_number = header.first_free_page;
+    chain_header.length = 0;
+    std::memcpy(bytes, &chain_header, sizeof(ChainHeader));
+    writePageSlot(page_number, page);
+    header.first_free_page = page_number;
+    ++header.num_free_pages;
+
+    page_number = next_page_number;
+  }
+  writeHeader(header);
+}
+
+std::string OverflowFile::encodeAttribute(const std::string& value,
+                                          const std::size_t threshold) {
+  std::string attribute;
+  if (value.size() <= threshold) {
+    const std::uint32_t length = static_cast<std::uint32_t>(value.size());
+    attribute.reserve(1 + sizeof(length) + value.size());
+    attribute.push_back(INLINE);
+    attribute.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    attribute.append(value);
+  } else {
+    const OverflowPointer pointer = writeValue(value);
+    attribute.push_back(OUT_OF_LINE);
+    attribute.append(reinterpret_cast<const char*>(&pointer), sizeof(pointer));
+  }
+  return attribute;
+}
+
+std::string OverflowFile::decodeAttribute(const char* attribute) const {
+  if (isOutOfLine(attribute)) {
+    OverflowPointer pointer;
+    std::memcpy(&pointer, attribute + 1, sizeof(pointer));
+    return readValue(pointer);
+  }
+  std::uint32_t length;
+  std::memcpy(&length, attribute + 1, sizeof(length));
+  return std::string(attribute + 1 + sizeof(length), length);
+}
+
+void OverflowFile::freeAttribute(const char* attribute) {
+  if (isOutOfLine(attribute)) {
+    OverflowPointer pointer;
+    std::memcpy(&pointer, attribute + 1, sizeof(pointer));
+    freeValue(pointer);
+  }
+}
+
+std::size_t OverflowFile::encodedSize(const char* attribute) {
+  if (isOutOfLine(attribute)) {
+    return 1 + sizeof(OverflowPointer);
+  }
+  std::uint32_t length;
+  std::memcpy(&length, attribute + 1, sizeof(length));
+  return 1 + sizeof(length) + length;
+}
+
+std::string OverflowFile::storeAttributes(const std::string& record,
+                                          const std::size_t offset,
+                                          const std::size_t count,
+                                          const std::size_t threshold) {
+  std::vector<std::size_t> positions;
+  findAttributes(record, offset, count, positions);
+  std::string stored(record, 0, offset);
+  std::size_t end = offset;
+  for (std::size_t i = 0; i < positions.size(); ++i) {
+    const char* attribute = record.data() + positions[i];
+    end = positions[i] + encodedSize(attribute);
+    std::uint32_t length;
+    std::memcpy(&length, attribute + 1, sizeof(length));
+    if (isOutOfLine(attribute) || length <= threshold) {
+      stored.append(attribute, end - positions[i]);
+    } else {
+      stored += encodeAttribute(decodeAttribute(attribute), threshold);
+    }
+  }
+  if (end < record.size()) {
+    stored.append(record, end, std::string::npos);
+  }
+  return stored;
+}
+
+void OverflowFile::freeAttributes(const std::string& record,
+                                  const std::size_t offset,
+                                  const std::size_t count,
+                                  const std::string* kept) {
+  std::vector<std::size_t> positions;
+  std::vector<PageId> kept_pages;
+  if (kept != NULL) {
+    findAttributes(*kept, offset, count, positions);
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+      const char* attribute = kept->data() + positions[i];
+      if (isOutOfLine(attribute)) {
+        OverflowPointer pointer;
+        std::memcpy(&pointer, attribute + 1, sizeof(pointer));
+        kept_pages.push_back(pointer.first_page_number);
+      }
+    }
+  }
+  findAttributes(record, offset, count, positions);
+  for (std::size_t i = 0; i < positions.size(); ++i) {
+    const char* attribute = record.data() + positions[i];
+    if (!isOutOfLine(attribute)) {
+      continue;
+    }
+    OverflowPointer pointer;
+    std::memcpy(&pointer, attribute + 1, sizeof(pointer));
+    if (std::find(kept_pages.begin(), kept_pages.end(),
+                  pointer.first_page_number) == kept_pages.end()) {
+      freeValue(pointer);
+    }
+  }
+}
+
+void OverflowFile::findAttributes(const std::string& record,
+                                  const std::size_t offset,
+                                  const std::size_t count,
+                                  std::vector<std::size_t>& positions) {
+  positions.clear();
+  std::size_t position = offset;
+  while (positions.size() < count && position < record.size()) {
+    const char* attribute = record.data() + position;
+    if (*attribute != INLINE && *attribute != OUT_OF_LINE) {
+      break;
+    }
+    const std::size_t header = isOutOfLine(attribute)
+        ? 1 + sizeof(OverflowPointer) : 1 + sizeof(std::uint32_t);
+    if (header > record.size() - position ||
+        encodedSize(attribute) > record.size() - position) {
+      break;
+    }
+    positions.push_back(position);
+    position += encodedSize(attribute);
+  }
+}
+
+PageId OverflowFile::takePage(FileHeader& header) {
+  if (header.num_free_pages > 0) {
+    const PageId page_number = header.first_free_page;
+    Page page;
+    readPageSlot(page_number, page);
+    ChainHeader chain_header;
+    std::memcpy(&chain_header, &page, sizeof(ChainHeader));
+    header.first_free_page = chain_header.next_page_number;
+    --header.num_free_pages;
+    return page_number;
+  }
+
+  const PageId page_number = header.num_pages;
+  if (header.first_used_page == Page::INVALID_NUMBER) {
+    header.first_used_page = page_number;
+  }
+  ++header.num_pages;
+  reserveSpace(header, page_number);
+  return page_number;
+}
+
+}
@@ -0,0 +1,257 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Reference to a value stored in an OverflowFile, which takes the
+ *        value's place in a record.
+ */
+struct OverflowPointer {
+  /**
+   * Number of the first page of the chain holding the value.
+   */
+  PageId first_page_number;
+
+  /**
+   * Length of the value in bytes.
+   */
+  std::uint32_t length;
+};
+
+/**
+ * @brief Companion file of a relation storing large attribute values out of
+ *        line.
+ *
+ * Records keep large attributes short by storing them in an OverflowFile,
+ * each in a chain of pages linked through their next page numbers, and
+ * keeping only an OverflowPointer to the value.  Scans which don't need the
+ * attribute then never read it, and more records fit on each page of the
+ * relation.
+ *
+ * encodeAttribute() and decodeAttribute() convert between values and their
+ * form in a record: a tag byte, then either the value with its length, if it
+ * is short, or a pointer.  FileScan::getAttribute() decodes an attribute of
+ * the current record, fetching it only then.  Given a relation's overflow
+ * file, PageFile::setOverflowAttributes() has BufMgr move long values out of
+ * line as records are stored and free them as records are deleted.
+ *
+ * Pages of freed values go on a free list and are reused.  Values are read
+ * and written directly, bypassing the buffer pool, as each is usually only
+ * read once per scan.
+ *
+ * @warning This class is not threadsafe.
+ */
+class OverflowFile : public BlobFile {
+ public:
+  /**
+   * Values longer than this many bytes are stored out of line by default.
+   */
+  static const std::size_t DEFAULT_THRESHOLD = 256;
+
+  /**
+   * Tag of an attribute stored in the record: followed by a 4-byte length
+   * and the value.
+   */
+  static const char INLINE = 'I';
+
+  /**
+   * Tag of an attribute stored out of line: followed by an OverflowPointer.
+   */
+  static const char OUT_OF_LINE = 'O';
+
+  /**
+   * Creates a new overflow file.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileExistsException     If the requested file already exists.
+   */
+  static OverflowFile create(const std::string& filename);
+
+  /**
+   * Opens an existing overflow file.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileNotFoundException   If the requested file doesn't exist.
+   */
+  static OverflowFile open(const std::string& filename);
+
+  /**
+   * Returns the name of the overflow file accompanying a relation.
+   *
+   * @param relation_name   Name of the relation's file.
+   */
+  static std::string companionName(const std::string& relation_name) {
+    return relation_name + ".overflow";
+  }
+
+  /**
+   * Constructs a file object representing a file on the filesystem.
+   *
+   * @param name        Name of file.
+   * @param create_new  Whether to create a new file.
+   * @throws  FileExistsException     If the underlying file exists and
+   *                                  create_new is true.
+   * @throws  FileNotFoundException   If the underlying file doesn't exist and
+   *                                  create_new is false.
+   */
+  OverflowFile(const std::string& name, const bool create_new);
+
+  /**
+   * Stores a value in a new chain of pages.
+   *
+   * @param value   Value to store.
+   * @return  Pointer to the value.
+   */
+  OverflowPointer writeValue(const std::string& value);
+
+  /**
+   * Reads a value back.
+   *
+   * @param pointer   Pointer returned by writeValue().
+   * @return  The value.
+   */
+  std::string readValue(const OverflowPointer& pointer) const;
+
+  /**
+   * Frees the pages of a value for reuse.  The pointer must not be used
+   * afterwards.
+   *
+   * @param pointer   Pointer returned by writeValue().
+   */
+  void freeValue(const OverflowPointer& pointer);
+
+  /**
+   * Returns the form of a value to put in a record: the value itself if it
+   * is no longer than <threshold> bytes, else a pointer to it, stored in this
+   * file.
+   *
+   * @param value       Attribute value.
+   * @param threshold   Longest value kept in the record.
+   * @return  Encoded attribute.
+   */
+  std::string encodeAttribute(const std::string& value,
+                              const std::size_t threshold = DEFAULT_THRESHOLD);
+
+  /**
+   * Returns the value of an encoded attribute, reading it from this file if
+   * it is stored out of line.
+   *
+   * @param attribute   First byte of the encoded attribute in a record.
+   * @return  Attribute value.
+   */
+  std::string decodeAttribute(const char* attribute) const;
+
+  /**
+   * Frees the pages of an encoded attribute's value if it is stored out of
+   * line, as when the record holding it is deleted.
+   *
+   * @param attribute   First byte of the encoded attribute in a record.
+   */
+  void freeAttribute(const char* attribute);
+
+  /**
+   * Returns true if an encoded attribute is stored out of line.
+   *
+   * @param attribute   First byte of the encoded attribute in a record.
+   */
+  static bool isOutOfLine(const char* attribute) {
+    return *attribute == OUT_OF_LINE;
+  }
+
+  /**
+   * Returns the size in bytes of an encoded attribute, so that records can
+   * hold several in a row.
+   *
+   * @param attribute   First byte of the encoded attribute in a record.
+   */
+  static std::size_t encodedSize(const char* attribute);
+
+  /**
+   * Returns <record> with those of its <count> encoded attributes starting at
+   * byte <offset> that are held inline and are longer than <threshold> bytes
+   * moved out of line, as encodeAttribute() would have stored them.
+   *
+   * @param record      Record holding encoded attributes.
+   * @param offset      Offset of the first encoded attribute.
+   * @param count       Number of encoded attributes, one after another.
+   * @param threshold   Longest value kept in the record.
+   * @return  Record to store.
+   */
+  std::string storeAttributes(const std::string& record,
+                              const std::size_t offset,
+                              const std::size_t count,
+                              const std::size_t threshold = DEFAULT_THRESHOLD);
+
+  /**
+   * Frees the out-of-line values of <record>'s <count> encoded attributes
+   * starting at byte <offset>, except those which <kept> also points to, as
+   * when <record> is deleted or replaced by <kept>.
+   *
+   * @param record  Record holding encoded attributes.
+   * @param offset  Offset of the first encoded attribute.
+   * @param count   Number of encoded attributes, one after another.
+   * @param kept    Record with the same layout whose values stay, or NULL.
+   */
+  void freeAttributes(const std::string& record, const std::size_t offset,
+                      const std::size_t count, const std::string* kept);
+
+ private:
+  /**
+   * @brief Header at the start of every page of a value's chain.
+   */
+  struct ChainHeader {
+    /**
+     * Number of the next page of the chain, or Page::INVALID_NUMBER.
+     */
+    PageId next_page_number;
+
+    /**
+     * Number of bytes of the value on this page.
+     */
+    std::uint32_t length;
+  };
+
+  /**
+   * Number of bytes of a value each page holds.
+   */
+  static const std::size_t CHUNK_SIZE = Page::SIZE - sizeof(ChainHeader);
+
+  /**
+   * Finds the encoded attributes of a record: the offset of each of the
+   * <count> starting at byte <offset>, up to the first which doesn't fit in
+   * the record.
+   *
+   * @param record      Record holding encoded attributes.
+   * @param offset      Offset of the first encoded attribute.
+   * @param count       Number of encoded attributes.
+   * @param positions   Receives the offsets of the attributes.
+   */
+  static void findAttributes(const std::string& record,
+                             const std::size_t offset,
+                             const std::size_t count,
+                             std::vector<std::size_t>& positions);
+
+  /**
+   * Takes a page off the free list, or else appends one to the file.
+   *
+   * @param header  File header, updated in memory only.
+   * @return  Number of the page.
+   */
+  PageId takePage(FileHeader& header);
+};
+
+}
@@ -5,12 +5,20 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <functional>
+#include <utility>
+#include <vector>
 
 #include <iostream>
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_record_exception.h"
 #include "exceptions/invalid_slot_exception.h"
+#include "exceptions/page_layout_exception.h"
+#include "exceptions/record_forwarded_exception.h"
+#include "exceptions/record_width_exception.h"
 #include "exceptions/slot_in_use_exception.h"
 #include "page_iterator.h"
 #include "page.h"
@@ -23,10 +31,16 @@ Page::Page() {
 }
 
 void Page::initialize() {
+  // Clear padding too, so that pages are written out deterministically.
+  std::memset(&header_, 0, sizeof(header_));
   header_.free_space_lower_bound = 0;
   header_.free_space_upper_bound = DATA_SIZE;
   header_.num_slots = 0;
   header_.num_free_slots = 0;
+  header_.first_free_slot = INVALID_SLOT;
+  header_.fragmented_bytes = 0;
+  header_.record_width = 0;
+  header_.num_attributes = 0;
   header_.current_page_number = INVALID_NUMBER;
   header_.next_page_number = INVALID_NUMBER;
   //data_.assign(DATA_SIZE, char());
@@ -34,38 +48,270 @@ void Page::initialize() {
 }
 
 RecordId Page::insertRecord(const std::string& record_data) {
+  if (isFixedWidth()) {
+    if (record_data.length() != header_.record_width) {
+      throw RecordWidthException(page_number(), header_.record_width,
+                                 record_data.length());
+    }
+    if (header_.num_free_slots == 0) {
+      throw InsufficientSpaceException(
+          page_number(), record_data.length(), getFreeSpace());
+    }
+    if (isPax()) {
+      const SlotId slot_number = fixedAllocateSlot();
+      paxScatter(slot_number, record_data.data());
+      return {page_number(), slot_number};
+    }
+    const SlotId slot_number = fixedInsert(
+        record_data.data(), header_.record_width, header_.num_slots);
+    return {page_number(), slot_number};
+  }
   if (!hasSpaceForRecord(record_data)) {
     throw InsufficientSpaceException(
         page_number(), record_data.length(), getFreeSpace());
   }
+  reserveContiguousSpace(header_.num_free_slots == 0
+                         ? record_data.length() + sizeof(PageSlot)
+                         : record_data.length());
   const SlotId slot_number = getAvailableSlot();
   insertRecordInSlot(slot_number, record_data);
   return {page_number(), slot_number};
 }
 
+std::size_t Page::insertRecords(const std::vector<std::string>& records,
+                                const std::size_t first) {
+  std::size_t i = first;
+  while (i < records.size() && hasSpaceForRecord(records[i])) {
+    insertRecord(records[i]);
+    ++i;
+  }
+  return i - first;
+}
+
 std::string Page::getRecord(const RecordId& record_id) const {
+  if (isPax()) {
+    validateRecordId(record_id);
+    std::string record(header_.record_width, '\0');
+    paxGather(record_id.slot_number, &record[0]);
+    return record;
+  }
+  return getRecordView(record_id).toString();
+}
+
+RecordView Page::getRecordView(const RecordId& record_id) const {
   validateRecordId(record_id);
+  if (isPax()) {
+    throw PageLayoutException(page_number(),
+                              "records of PAX pages are not contiguous");
+  }
+  if (isFixedWidth()) {
+    return RecordView(&data_[fixedRecordOffset(record_id.slot_number,
+                                               header_.record_width,
+                                               header_.num_slots)],
+                      header_.record_width);
+  }
   const PageSlot& slot = getSlot(record_id.slot_number);
-	std::string retStr = std::string(data_, DATA_SIZE).substr(slot.item_offset, slot.item_length);
+  if (slot.isForward()) {
+    throw RecordForwardedException(record_id,
+                                   getForwardingAddress(record_id));
+  }
+  if (slot.isMoved()) {
+    return RecordView(&data_[slot.item_offset + sizeof(RecordId)],
+                      slot.length() - sizeof(RecordId));
+  }
+  return RecordView(&data_[slot.item_offset], slot.length());
+}
 
-	return retStr;
+std::size_t Page::getRecordViews(const SlotId start,
+                                 const std::size_t max_records,
+                                 RecordId* record_ids, RecordView* views,
+                                 SlotId& last_slot) const {
+  if (isPax()) {
+    throw PageLayoutException(page_number(),
+                              "records of PAX pages are not contiguous");
+  }
+  const PageId number = page_number();
+  std::size_t count = 0;
+  SlotId slot_number = start;
+  if (isFixedWidth()) {
+    while (count < max_records) {
+      slot_number = fixedNextUsedSlot(slot_number, header_.num_slots);
+      if (slot_number == INVALID_SLOT) {
+        break;
+      }
+      const RecordId record_id = {number, slot_number, 0};
+      record_ids[count] = record_id;
+      views[count] = RecordView(
+          &data_[fixedRecordOffset(slot_number, header_.record_width,
+                                   header_.num_slots)],
+          header_.record_width);
+      ++count;
+    }
+  } else {
+    while (count < max_records) {
+      if (slot_number >= header_.num_slots) {
+        slot_number = INVALID_SLOT;
+        break;
+      }
+      ++slot_number;
+      const PageSlot& slot = getSlot(slot_number);
+      if (!slot.used() || slot.isForward()) {
+        continue;
+      }
+      if (slot.isMoved()) {
+        std::memcpy(&record_ids[count], &data_[slot.item_offset],
+                    sizeof(RecordId));
+        views[count] = RecordView(&data_[slot.item_offset + sizeof(RecordId)],
+                                  slot.length() - sizeof(RecordId));
+      } else {
+        const RecordId record_id = {number, slot_number, 0};
+        record_ids[count] = record_id;
+        views[count] = RecordView(&data_[slot.item_offset], slot.length());
+      }
+      ++count;
+    }
+  }
+  last_slot = count < max_records ? INVALID_SLOT : slot_number;
+  return count;
 }
 
 void Page::updateRecord(const RecordId& record_id,
                         const std::string& record_data) {
   validateRecordId(record_id);
-  const PageSlot* slot = getSlot(record_id.slot_number);
-  const std::size_t free_space_after_delete =
-      getFreeSpace() + slot->item_length;
-  if (record_data.length() > free_space_after_delete) {
+  if (isFixedWidth()) {
+    if (record_data.length() != header_.record_width) {
+      throw RecordWidthException(page_number(), header_.record_width,
+                                 record_data.length());
+    }
+    if (isPax()) {
+      paxScatter(record_id.slot_number, record_data.data());
+      return;
+    }
+    std::memcpy(&data_[fixedRecordOffset(record_id.slot_number,
+                                         header_.record_width,
+                                         header_.num_slots)],
+                record_data.data(), header_.record_width);
+    return;
+  }
+  const PageSlot& slot = *getSlot(record_id.slot_number);
+  if (slot.isForward()) {
+    throw RecordForwardedException(record_id,
+                                   getForwardingAddress(record_id));
+  }
+  if (slot.isMoved()) {
+    // Keep the home record ID in front of the record.
+    std::string item_data(&data_[slot.item_offset], sizeof(RecordId));
+    item_data += record_data;
+    replaceItem(record_id, item_data, PageSlot::MOVED);
+    return;
+  }
+  replaceItem(record_id, record_data, 0 /* flags */);
+}
+
+void Page::replaceItem(const RecordId& record_id, const std::string& item_data,
+                       const std::uint16_t flags) {
+  PageSlot* slot = getSlot(record_id.slot_number);
+  const std::size_t old_length = slot->length();
+  const std::size_t new_length = item_data.length();
+  if (new_length <= old_length) {
+    // Write over the old item, ending where it ended, so that the bytes
+    // freed are in front of it and rejoin the free space if the item is the
+    // first one on the page.
+    const std::size_t freed = old_length - new_length;
+    std::memset(&data_[slot->item_offset], '\0', freed);
+    if (slot->item_offset == header_.free_space_upper_bound) {
+      header_.free_space_upper_bound += freed;
+    } else {
+      header_.fragmented_bytes += freed;
+    }
+    slot->item_offset += freed;
+    slot->item_length = new_length | flags;
+    std::memcpy(&data_[slot->item_offset], item_data.data(), new_length);
+    return;
+  }
+  if (slot->item_offset == header_.free_space_upper_bound &&
+      getContiguousFreeSpace() >= new_length - old_length) {
+    // Grow the item into the free space right in front of it.
+    slot->item_offset -= new_length - old_length;
+    header_.free_space_upper_bound = slot->item_offset;
+    slot->item_length = new_length | flags;
+    std::memcpy(&data_[slot->item_offset], item_data.data(), new_length);
+    return;
+  }
+
+  const std::size_t free_space_after_delete = getFreeSpace() + old_length;
+  if (new_length > free_space_after_delete) {
     throw InsufficientSpaceException(
-        page_number(), record_data.length(), free_space_after_delete);
+        page_number(), new_length, free_space_after_delete);
   }
   // We have to disallow slot compaction here because we're going to place the
   // record data in the same slot, and compaction might delete the slot if we
   // permit it.
   deleteRecord(record_id, false /* allow_slot_compaction */);
-  insertRecordInSlot(record_id.slot_number, record_data);
+  reserveContiguousSpace(new_length);
+  insertRecordInSlot(record_id.slot_number, item_data);
+  getSlot(record_id.slot_number)->item_length |= flags;
+}
+
+bool Page::isForwarded(const RecordId& record_id) const {
+  validateRecordId(record_id);
+  return !isFixedWidth() && getSlot(record_id.slot_number).isForward();
+}
+
+RecordId Page::getForwardingAddress(const RecordId& record_id) const {
+  if (!isForwarded(record_id)) {
+    throw InvalidRecordException(record_id, page_number());
+  }
+  RecordId new_location;
+  std::memcpy(&new_location, &data_[getSlot(record_id.slot_number).item_offset],
+              sizeof(RecordId));
+  return new_location;
+}
+
+RecordId Page::getHomeRecordId(const RecordId& record_id) const {
+  validateRecordId(record_id);
+  if (isFixedWidth() || !getSlot(record_id.slot_number).isMoved()) {
+    return record_id;
+  }
+  RecordId home_record_id;
+  std::memcpy(&home_record_id,
+              &data_[getSlot(record_id.slot_number).item_offset],
+              sizeof(RecordId));
+  return home_record_id;
+}
+
+void Page::forwardRecord(const RecordId& record_id,
+                         const RecordId& new_location) {
+  validateRecordId(record_id);
+  if (isFixedWidth()) {
+    throw PageLayoutException(page_number(),
+                              "fixed-width records can't be forwarded");
+  }
+  RecordId stub = new_location;
+  stub.padding = 0;
+  replaceItem(record_id,
+              std::string(reinterpret_cast<const char*>(&stub), sizeof(stub)),
+              PageSlot::FORWARD);
+}
+
+RecordId Page::insertMovedRecord(const RecordId& home_record_id,
+                                 const std::string& record_data) {
+  if (isFixedWidth()) {
+    throw PageLayoutException(page_number(),
+                              "fixed-width records can't be moved");
+  }
+  RecordId home = home_record_id;
+  home.padding = 0;
+  std::string item_data(reinterpret_cast<const char*>(&home), sizeof(home));
+  item_data += record_data;
+  const RecordId record_id = insertRecord(item_data);
+  getSlot(record_id.slot_number)->item_length |= PageSlot::MOVED;
+  return record_id;
+}
+
+bool Page::hasSpaceForMovedRecord(const std::string& record_data) const {
+  return !isFixedWidth() &&
+      hasSpaceForLength(record_data.length() + sizeof(RecordId));
 }
 
 void Page::deleteRecord(const RecordId& record_id) {
@@ -75,72 +321,153 @@ void Page::deleteRecord(const RecordId& record_id) {
 void Page::deleteRecord(const RecordId& record_id,
                         const bool allow_slot_compaction) {
   validateRecordId(record_id);
+  if (isPax()) {
+    const std::string zeros(header_.record_width, '\0');
+    paxScatter(record_id.slot_number, zeros.data());
+    fixedFreeSlot(record_id.slot_number);
+    return;
+  }
+  if (isFixedWidth()) {
+    fixedDelete(record_id.slot_number, header_.record_width, header_.num_slots);
+    return;
+  }
   PageSlot* slot = getSlot(record_id.slot_number);
 
-	for(int i = 0; i < slot->item_length; i++)
-		data_[i + slot->item_offset] = '\0';
+  std::memset(&data_[slot->item_offset], '\0', slot->length());
 
-  //data_.replace(slot->item_offset, slot->item_length, slot->item_length, '\0');
+  // Leave the hole where it is; compact() reclaims it when the space is
+  // needed.  A record right at the free space boundary can go straight back.
+  if (slot->item_offset == header_.free_space_upper_bound) {
+    header_.free_space_upper_bound += slot->length();
+  } else {
+    header_.fragmented_bytes += slot->length();
+  }
 
-  // Compact the data by removing the hole left by this record (if necessary).
-  std::uint16_t move_offset = slot->item_offset; 
-  std::size_t move_bytes = 0;
-  for (SlotId i = 1; i <= header_.num_slots; ++i) {
-    PageSlot* other_slot = getSlot(i);
-    if (other_slot->used && other_slot->item_offset < slot->item_offset) {
-      if (other_slot->item_offset < move_offset) {
-        move_offset = other_slot->item_offset;
-      }
-      move_bytes += other_slot->item_length;
-      // Update the slot for the other data to reflect the soon-to-be-new
-      // location.
-      other_slot->item_offset += slot->item_length;
+  // Mark slot as unused and put it at the head of the free chain.
+  slot->item_offset = 0;
+  slot->item_length = header_.first_free_slot;
+  header_.first_free_slot = record_id.slot_number;
+  ++header_.num_free_slots;
+
+  if (allow_slot_compaction) {
+    // Free unused slots at the end of the slot list, as long as they are at
+    // the head of the free chain so that they can be unlinked in constant
+    // time.  Any others stay allocated and are reused later.
+    while (header_.first_free_slot == header_.num_slots &&
+           header_.num_slots > 0) {
+      header_.first_free_slot = getSlot(header_.num_slots)->item_length;
+      --header_.num_slots;
+      --header_.num_free_slots;
     }
+    header_.free_space_lower_bound = sizeof(PageSlot) * header_.num_slots;
   }
-  // If we have data to move, shift it to the right.
-  if (move_bytes > 0) {
-    const std::string& data_to_move = std::string(data_, DATA_SIZE).substr(move_offset, move_bytes);
+}
 
-		for(std::uint16_t i = 0; i < move_bytes; i++)
-			data_[i + move_offset + slot->item_length] = data_to_move[i];
+void Page::compact() {
+  // Move records to the end of the page in order of decreasing offset, so
+  // that each one only moves towards the end, over bytes already moved or
+  // freed.
+  std::vector<std::pair<std::uint16_t, SlotId> > slots;
+  slots.reserve(header_.num_slots - header_.num_free_slots);
+  for (SlotId i = 1; i <= header_.num_slots; ++i) {
+    const PageSlot* slot = getSlot(i);
+    if (slot->used()) {
+      slots.push_back(std::make_pair(slot->item_offset, i));
+    }
+  }
+  std::sort(slots.begin(), slots.end(),
+            std::greater<std::pair<std::uint16_t, SlotId> >());
 
-    //data_.replace(move_offset + slot->item_length, move_bytes, data_to_move);
+  std::uint16_t upper_bound = DATA_SIZE;
+  for (std::size_t i = 0; i < slots.size(); ++i) {
+    PageSlot* slot = getSlot(slots[i].second);
+    upper_bound -= slot->length();
+    if (slot->item_offset != upper_bound) {
+      std::memmove(&data_[upper_bound], &data_[slot->item_offset],
+                   slot->length());
+      slot->item_offset = upper_bound;
+    }
   }
-  header_.free_space_upper_bound += slot->item_length;
+  std::memset(&data_[header_.free_space_upper_bound], '\0',
+              upper_bound - header_.free_space_upper_bound);
+  header_.free_space_upper_bound = upper_bound;
+  header_.fragmented_bytes = 0;
+}
 
-  // Mark slot as unused.
-  slot->used = false;
-  slot->item_offset = 0;
-  slot->item_length = 0;
-  ++header_.num_free_slots;
+void Page::formatPax(const std::vector<std::uint16_t>& attribute_widths) {
+  std::size_t width = 0;
+  for (std::size_t i = 0; i < attribute_widths.size(); ++i) {
+    if (attribute_widths[i] == 0) {
+      throw RecordWidthException(page_number(), 0 /* page_width */, 0);
+    }
+    width += attribute_widths[i];
+  }
+  const std::size_t attributes_bytes =
+      (attribute_widths.size() * sizeof(PaxAttribute) + 7) / 8 * 8;
+  if (attribute_widths.empty() ||
+      attributes_bytes + 2 * (width + 8 * attribute_widths.size()) + 8 >
+      DATA_SIZE) {
+    throw RecordWidthException(page_number(), 0 /* page_width */, width);
+  }
 
-  if (allow_slot_compaction && record_id.slot_number == header_.num_slots) {
-    // Last slot in the list, so we need to free any unused slots that are at
-    // the end of the slot list.
-    int num_slots_to_delete = 1;
-    for (SlotId i = 1; i < header_.num_slots; ++i) {
-      // Traverse list backwards, looking for unused slots.
-      const PageSlot* other_slot = getSlot(header_.num_slots - i);
-      if (!other_slot->used) {
-        ++num_slots_to_delete;
-      } else {
-        // Stop at the first used slot we find, since we can't move used slots
-        // without affecting record IDs.
-        break;
-      }
+  // Start from the capacity without any padding and count down.
+  std::size_t capacity = (DATA_SIZE - attributes_bytes) * 8 / (width * 8 + 1);
+  while (true) {
+    std::size_t bytes = fixedBitmapBytes(capacity) + attributes_bytes;
+    for (std::size_t i = 0; i < attribute_widths.size(); ++i) {
+      bytes += (capacity * attribute_widths[i] + 7) / 8 * 8;
     }
-    header_.num_slots -= num_slots_to_delete;
-    header_.num_free_slots -= num_slots_to_delete;
-    header_.free_space_lower_bound -= sizeof(PageSlot) * num_slots_to_delete;
+    if (bytes <= DATA_SIZE) {
+      break;
+    }
+    --capacity;
+  }
+
+  formatFixedWidth(width, capacity);
+  header_.num_attributes = attribute_widths.size();
+  PaxAttribute* attributes = const_cast<PaxAttribute*>(paxAttributes());
+  std::size_t offset = fixedBitmapBytes(capacity) + attributes_bytes;
+  for (std::size_t i = 0; i < attribute_widths.size(); ++i) {
+    attributes[i].width = attribute_widths[i];
+    attributes[i].offset = offset;
+    offset += (capacity * attribute_widths[i] + 7) / 8 * 8;
+  }
+}
+
+void Page::paxScatter(const SlotId slot_number, const char* record_data) {
+  const PaxAttribute* attributes = paxAttributes();
+  for (std::size_t i = 0; i < header_.num_attributes; ++i) {
+    std::memcpy(&data_[attributes[i].offset +
+                       (slot_number - 1) * attributes[i].width],
+                record_data, attributes[i].width);
+    record_data += attributes[i].width;
+  }
+}
+
+void Page::paxGather(const SlotId slot_number, char* record_data) const {
+  const PaxAttribute* attributes = paxAttributes();
+  for (std::size_t i = 0; i < header_.num_attributes; ++i) {
+    std::memcpy(record_data,
+                &data_[attributes[i].offset +
+                       (slot_number - 1) * attributes[i].width],
+                attributes[i].width);
+    record_data += attributes[i].width;
   }
 }
 
 bool Page::hasSpaceForRecord(const std::string& record_data) const {
-  std::size_t record_size = record_data.length();
+  if (isFixedWidth()) {
+    return record_data.length() == header_.record_width &&
+        header_.num_free_slots > 0;
+  }
+  return hasSpaceForLength(record_data.length());
+}
+
+bool Page::hasSpaceForLength(std::size_t length) const {
   if (header_.num_free_slots == 0) {
-    record_size += sizeof(PageSlot);
+    length += sizeof(PageSlot);
   }
-  return record_size <= getFreeSpace();
+  return length <= getFreeSpace();
 }
 
 PageSlot* Page::getSlot(const SlotId slot_number) {
@@ -152,27 +479,21 @@ const PageSlot& Page::getSlot(const SlotId slot_number) const {
 }
 
 SlotId Page::getAvailableSlot() {
-  SlotId slot_number = INVALID_SLOT;
-  if (header_.num_free_slots > 0) {
-    // Have an allocated but unused slot that we can reuse.
-    for (SlotId i = 1; i <= header_.num_slots; ++i) {
-      const PageSlot* slot = getSlot(i);
-      if (!slot->used) {
-        // We don't decrement the number of free slots until someone actually
-        // puts data in the slot.
-        slot_number = i;
-        break;
-      }
-    }
-  } else {
-    // Have to allocate a new slot.
-    slot_number = header_.num_slots + 1;
+  if (header_.first_free_slot == INVALID_SLOT) {
+    // Have to allocate a new slot.  We don't take it off the chain or
+    // decrement the number of free slots until someone actually puts data in
+    // the slot.
+    const SlotId slot_number = header_.num_slots + 1;
     ++header_.num_slots;
     ++header_.num_free_slots;
     header_.free_space_lower_bound = sizeof(PageSlot) * header_.num_slots;
+    PageSlot* slot = getSlot(slot_number);
+    slot->item_offset = 0;
+    slot->item_length = INVALID_SLOT;
+    header_.first_free_slot = slot_number;
   }
-  assert(slot_number != INVALID_SLOT);
-  return slot_number;
+  assert(header_.num_free_slots > 0);
+  return header_.first_free_slot;
 }
 
 void Page::insertRecordInSlot(const SlotId slot_number,
@@ -182,37 +503,50 @@ void Page::insertRecordInSlot(const SlotId slot_number,
     throw InvalidSlotException(page_number(), slot_number);
   }
   PageSlot* slot = getSlot(slot_number);
-  if (slot->used) {
+  if (slot->used()) {
     throw SlotInUseException(page_number(), slot_number);
   }
+
+  // Unlink the slot from the free chain.
+  if (header_.first_free_slot == slot_number) {
+    header_.first_free_slot = slot->item_length;
+  } else {
+    PageSlot* previous = getSlot(header_.first_free_slot);
+    while (previous->item_length != slot_number) {
+      previous = getSlot(previous->item_length);
+    }
+    previous->item_length = slot->item_length;
+  }
+
   const int record_length = record_data.length();
-  slot->used = true;
   slot->item_length = record_length;
   slot->item_offset = header_.free_space_upper_bound - record_length;
   header_.free_space_upper_bound = slot->item_offset;
   --header_.num_free_slots;
 
-	for(int i = 0; i < slot->item_length; i++)
-		data_[i + slot->item_offset] = record_data[i];
-
-  //data_.replace(slot->item_offset, slot->item_length, record_data);
+  std::memcpy(&data_[slot->item_offset], record_data.data(), record_length);
 }
 
 void Page::validateRecordId(const RecordId& record_id) const {
   if (record_id.page_number != page_number()) {
     throw InvalidRecordException(record_id, page_number());
   }
-  const PageSlot& slot = getSlot(record_id.slot_number);
-  if (!slot.used) {
+  if (record_id.slot_number == INVALID_SLOT ||
+      record_id.slot_number > header_.num_slots) {
+    throw InvalidRecordException(record_id, page_number());
+  }
+  const bool used = isFixedWidth() ? fixedSlotUsed(record_id.slot_number)
+                                   : getSlot(record_id.slot_number).used();
+  if (!used) {
     throw InvalidRecordException(record_id, page_number());
   }
 }
 
-PageIterator Page::begin() {
+PageIterator Page::begin() const {
   return PageIterator(this);
 }
 
-PageIterator Page::end() {
+PageIterator Page::end() const {
   const RecordId& end_record_id = {page_number(), Page::INVALID_SLOT, 0};
   return PageIterator(this, end_record_id);
 }
@@ -8,9 +8,11 @@
 #pragma once
 
 #include <cstddef>
+#include <cstring>
 #include <stdint.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 //#include <gtest/gtest.h>
 #include "types.h"
@@ -48,6 +50,35 @@ struct PageHeader {
    */
   SlotId num_free_slots;
 
+  /**
+   * First slot in the chain of free slots, or Page::INVALID_SLOT if there are
+   * none.  Each free slot's item_length holds the number of the next one.
+   */
+  SlotId first_free_slot;
+
+  /**
+   * Number of bytes held by deleted records between the free space upper
+   * bound and the end of the page.  They become usable again when the page is
+   * compacted.
+   */
+  std::uint16_t fragmented_bytes;
+
+  /**
+   * Width of every record on the page if it uses the fixed-width format (see
+   * FixedWidthPage), or 0 for the slotted format.  In the fixed-width format,
+   * <num_slots> is the page's capacity, <num_free_slots> the number of
+   * unoccupied slots and <first_free_slot> a slot below which all slots are
+   * occupied.
+   */
+  std::uint16_t record_width;
+
+  /**
+   * Number of attributes if the page uses the PAX layout (see PaxPage), in
+   * which each attribute of the fixed-width records is stored in a minipage
+   * of its own; 0 otherwise.  <record_width> is then the sum of their widths.
+   */
+  std::uint16_t num_attributes;
+
   /**
    * Number of the page within the file.
    */
@@ -65,8 +96,14 @@ struct PageHeader {
    * @return  True if the other header is equal to this one.
    */
   bool operator==(const PageHeader& rhs) const {
-    return num_slots == rhs.num_slots &&
+    return free_space_lower_bound == rhs.free_space_lower_bound &&
+        free_space_upper_bound == rhs.free_space_upper_bound &&
+        num_slots == rhs.num_slots &&
         num_free_slots == rhs.num_free_slots &&
+        first_free_slot == rhs.first_free_slot &&
+        fragmented_bytes == rhs.fragmented_bytes &&
+        record_width == rhs.record_width &&
+        num_attributes == rhs.num_attributes &&
         current_page_number == rhs.current_page_number &&
         next_page_number == rhs.next_page_number;
   }
@@ -77,23 +114,173 @@ struct PageHeader {
  */
 struct PageSlot {
   /**
-   * Whether the slot currently holds data.  May be false if this slot's
-   * record has been deleted after insertion.
+   * Offset of the data item in the page, or 0 if the slot is free.  No record
+   * can start at offset 0, which is where the slot array is.
    */
-  bool used;
+  std::uint16_t item_offset;
 
   /**
-   * Offset of the data item in the page.
+   * Length of the data item in this slot, combined with the FORWARD and MOVED
+   * flags.  For a free slot, number of the next slot in the page's chain of
+   * free slots, or Page::INVALID_SLOT.
    */
-  std::uint16_t item_offset;
+  std::uint16_t item_length;
 
   /**
-   * Length of the data item in this slot.
+   * Flag marking a forwarding stub: the record has moved to another page,
+   * and the data item is the RecordId of where it is now.
    */
-  std::uint16_t item_length;
+  static const std::uint16_t FORWARD = 0x8000;
+
+  /**
+   * Flag marking a record which has moved here from another page: the data
+   * item is the RecordId the record keeps (its home), then the record.
+   */
+  static const std::uint16_t MOVED = 0x4000;
+
+  /**
+   * Bits of item_length which hold the length of a used slot's data item.
+   */
+  static const std::uint16_t LENGTH_MASK = 0x3fff;
+
+  /**
+   * Returns whether the slot currently holds data.  May be false if this
+   * slot's record has been deleted after insertion.
+   *
+   * @return  True if the slot holds a record.
+   */
+  bool used() const { return item_offset != 0; }
+
+  /**
+   * Returns the length of a used slot's data item.
+   */
+  std::uint16_t length() const { return item_length & LENGTH_MASK; }
+
+  /**
+   * Returns whether a used slot holds a forwarding stub.
+   */
+  bool isForward() const { return (item_length & FORWARD) != 0; }
+
+  /**
+   * Returns whether a used slot holds a record moved here from another page.
+   */
+  bool isMoved() const { return (item_length & MOVED) != 0; }
+};
+
+/**
+ * @brief Where one attribute of the records on a PAX page is stored.
+ */
+struct PaxAttribute {
+  /**
+   * Width of the attribute in bytes.
+   */
+  std::uint16_t width;
+
+  /**
+   * Offset in the page's data area of the attribute's minipage, which holds
+   * the attribute's value for every slot, slot 1 first.
+   */
+  std::uint16_t offset;
+};
+
+/**
+ * @brief Read-only view of a record's bytes where they are stored on a page.
+ *
+ * A view does not own its bytes: it is only valid while the page it came from
+ * stays where it is and the record is not updated or deleted (for a page in
+ * the buffer pool, while the page is pinned).  Converts to std::string, which
+ * copies the record, so code expecting a string keeps working.
+ */
+class RecordView {
+ public:
+  /**
+   * Constructs an empty view.
+   */
+  RecordView()
+      : data_(NULL),
+        size_(0) {
+  }
+
+  /**
+   * Constructs a view of <size> bytes starting at <data>.
+   *
+   * @param data  First byte of the record.
+   * @param size  Length of the record in bytes.
+   */
+  RecordView(const char* data, const std::size_t size)
+      : data_(data),
+        size_(size) {
+  }
+
+  /**
+   * Constructs a view of the bytes of the given string.
+   *
+   * @param str   String to view.
+   */
+  RecordView(const std::string& str)
+      : data_(str.data()),
+        size_(str.size()) {
+  }
+
+  /**
+   * Returns a pointer to the first byte of the record.
+   */
+  const char* data() const { return data_; }
+
+  /**
+   * Returns the length of the record in bytes.
+   */
+  std::size_t size() const { return size_; }
+
+  /**
+   * Returns the length of the record in bytes.
+   */
+  std::size_t length() const { return size_; }
+
+  /**
+   * Returns true if the record has no bytes.
+   */
+  bool empty() const { return size_ == 0; }
+
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + size_; }
+
+  char operator[](const std::size_t pos) const { return data_[pos]; }
+
+  /**
+   * Returns a copy of the record.
+   */
+  std::string toString() const { return std::string(data_, size_); }
+
+  operator std::string() const { return toString(); }
+
+  /**
+   * Returns true if this view's bytes are equal to the other's.
+   *
+   * @param rhs   Other view to compare against.
+   * @return  True if both views hold the same bytes.
+   */
+  bool operator==(const RecordView& rhs) const {
+    return size_ == rhs.size_ &&
+        (size_ == 0 || std::memcmp(data_, rhs.data_, size_) == 0);
+  }
+
+  bool operator!=(const RecordView& rhs) const { return !(*this == rhs); }
+
+ private:
+  /**
+   * First byte of the record.
+   */
+  const char* data_;
+
+  /**
+   * Length of the record in bytes.
+   */
+  std::size_t size_;
 };
 
 class PageIterator;
+template <std::size_t RECORD_SIZE> class FixedWidthPage;
 
 /**
  * @brief Class which represents a fixed-size database page containing records.
@@ -138,9 +325,25 @@ class Page {
    *
    * @param record_data  Bytes that compose the record.
    * @return  ID of the newly inserted record.
+   * @throws  InsufficientSpaceException  If the record doesn't fit.
+   * @throws  RecordWidthException  If this is a fixed-width page and the
+   *                                record has a different width.
    */
   RecordId insertRecord(const std::string& record_data);
 
+  /**
+   * Inserts records <records[first]>, <records[first + 1]>, ... into the page
+   * in order, stopping at the first one which doesn't fit.  Does not throw
+   * when the page fills up.  Records inserted into an empty page get slots 1,
+   * 2, ... in order.
+   *
+   * @param records   Records to insert.
+   * @param first     Index in <records> of first record to insert.
+   * @return  Number of records inserted.
+   */
+  std::size_t insertRecords(const std::vector<std::string>& records,
+                            const std::size_t first);
+
   /**
    * Returns the record with the given ID.  Returned data is a copy of what is
    * stored on the page; use updateRecord to change it.
@@ -151,20 +354,125 @@ class Page {
    */
   std::string getRecord(const RecordId& record_id) const;
 
+  /**
+   * Returns a view of the record with the given ID where it is stored on the
+   * page, without copying it.  The view is invalidated by any change to the
+   * page and by the page leaving memory (e.g. being unpinned).
+   *
+   * @see getRecord
+   * @param record_id  ID of the record to return.
+   * @return  View of the record.
+   * @throws  PageLayoutException  If the page uses the PAX layout.
+   */
+  RecordView getRecordView(const RecordId& record_id) const;
+
+  /**
+   * Returns views of the records in the used slots after the given slot, in
+   * slot order, as many as fit in the given arrays, and the IDs scans report
+   * for them: the home record ID for a record moved here.  Forwarding stubs
+   * are skipped.  Cheaper than getting the records one at a time, as slots
+   * are read once each.
+   *
+   * @param start         Slot to start after, or INVALID_SLOT for the first.
+   * @param max_records   Length of the arrays.
+   * @param record_ids    Receives the IDs of the records.
+   * @param views         Receives views of the records, as getRecordView().
+   * @param last_slot     Receives the slot of the last record returned, or
+   *                      INVALID_SLOT if the page has no more records.
+   * @return  Number of records returned.
+   * @throws  PageLayoutException  If the page uses the PAX layout.
+   */
+  std::size_t getRecordViews(const SlotId start,
+                             const std::size_t max_records,
+                             RecordId* record_ids, RecordView* views,
+                             SlotId& last_slot) const;
+
   /**
    * Updates the record with the given ID, replacing its data with a new
-   * version.  This is equivalent to deleting the old record and inserting a
-   * new one, with the exception that the record ID will not change.
+   * version.  The record ID does not change.  The new version is written over
+   * the old one if it is no longer, or grows into the free space next to it
+   * if there is room; otherwise the record is reinserted, compacting the page
+   * if necessary.
+   *
+   * To keep the ID of a record which outgrows its page, use
+   * BufMgr::updateRecord, which moves it to another page and leaves a
+   * forwarding stub here.
    *
    * @param record_id   ID of record to update.
    * @param record_data Updated bytes that compose the record.
+   * @throws  InsufficientSpaceException  If the page can't hold the new
+   *                                      version.
+   * @throws  RecordForwardedException  If the record has moved to another page.
    */
   void updateRecord(const RecordId& record_id, const std::string& record_data);
 
   /**
-   * Deletes the record with the given ID.  Page is compacted upon delete to
-   * ensure that data of all records is contiguous.  Slot array is compacted if
-   * the slot deleted is at the end of the slot array.
+   * Returns true if the record with the given ID has moved to another page,
+   * leaving a forwarding stub here.  Stubs are skipped by PageIterator; the
+   * record is found at its new location, under its old ID.
+   *
+   * @param record_id   ID of record.
+   * @return  Whether the slot holds a forwarding stub.
+   */
+  bool isForwarded(const RecordId& record_id) const;
+
+  /**
+   * Returns where a forwarded record is stored now.
+   *
+   * @param record_id   ID of record whose slot holds a forwarding stub.
+   * @return  Record's location.
+   * @throws  InvalidRecordException  If the slot does not hold a stub.
+   */
+  RecordId getForwardingAddress(const RecordId& record_id) const;
+
+  /**
+   * Returns the ID a record is known by: the ID of the forwarding stub for a
+   * record which has moved here from another page, and the given ID for any
+   * other record.
+   *
+   * @param record_id   ID of record on this page.
+   * @return  ID the record is known by.
+   */
+  RecordId getHomeRecordId(const RecordId& record_id) const;
+
+  /**
+   * Replaces the record with the given ID, or its forwarding stub, by a stub
+   * pointing at the record's new location.
+   *
+   * @param record_id     ID of record.
+   * @param new_location  ID of the record's copy inserted with
+   *                      insertMovedRecord() on another page.
+   * @throws  InsufficientSpaceException  If the stub is longer than the
+   *                                      record and doesn't fit.
+   */
+  void forwardRecord(const RecordId& record_id, const RecordId& new_location);
+
+  /**
+   * Inserts a record moved here from another page, which keeps its ID there.
+   *
+   * @param home_record_id  ID the record keeps.
+   * @param record_data     Bytes that compose the record.
+   * @return  ID of the record's new location.
+   * @throws  InsufficientSpaceException  If the record doesn't fit.
+   * @throws  PageLayoutException  If this is a fixed-width page.
+   */
+  RecordId insertMovedRecord(const RecordId& home_record_id,
+                             const std::string& record_data);
+
+  /**
+   * Returns true if the page has enough free space to hold the given data as
+   * a record moved from another page.
+   *
+   * @param record_data Bytes that compose the record.
+   * @return  Whether the page can hold the data.
+   */
+  bool hasSpaceForMovedRecord(const std::string& record_data) const;
+
+  /**
+   * Deletes the record with the given ID.  The record's bytes are not
+   * reclaimed until an insert or update needs them and the page is compacted.
+   * Slot array is compacted if the slot deleted is at the end of the slot
+   * array.
    *
    * @param record_id   ID of the record to delete.
    */
@@ -179,12 +487,33 @@ class Page {
   bool hasSpaceForRecord(const std::string& record_data) const;
 
   /**
-   * Returns this page's free space in bytes.
+   * Returns this page's free space in bytes, including space left by deleted
+   * records which has not been reclaimed yet.
    *
    * @return  Free space in bytes.
    */
-  std::uint16_t getFreeSpace() const { return header_.free_space_upper_bound -
-                                              header_.free_space_lower_bound; }
+  std::uint16_t getFreeSpace() const {
+    return isFixedWidth() ? header_.num_free_slots * header_.record_width
+                          : getContiguousFreeSpace() + header_.fragmented_bytes;
+  }
+
+  /**
+   * Returns true if the page holds fixed-width records (see FixedWidthPage).
+   * All the record operations of this class work on such pages too.
+   *
+   * @return  Whether the page uses the fixed-width format.
+   */
+  bool isFixedWidth() const { return header_.record_width != 0; }
+
+  /**
+   * Returns true if the page uses the PAX layout (see PaxPage), a fixed-width
+   * format which stores records by attribute.  Records on such a page are not
+   * contiguous, so getRecordView() is not available; the other record
+   * operations of this class, PageIterator and FileScan work on them.
+   *
+   * @return  Whether the page uses the PAX layout.
+   */
+  bool isPax() const { return header_.num_attributes != 0; }
 
   /**
    * Returns this page's number in its file.
@@ -205,7 +534,7 @@ class Page {
    *
    * @return  Iterator at first record of page.
    */
-  PageIterator begin();
+  PageIterator begin() const;
 
   /**
    * Returns an iterator representing the record after the last record in the
@@ -213,7 +542,7 @@ class Page {
    *
    * @return  Iterator representing record after the last record in the page.
    */
-  PageIterator end();
+  PageIterator end() const;
 
  private:
   /**
@@ -240,10 +569,9 @@ class Page {
   }
 
   /**
-   * Deletes the record with the given ID.  Page is compacted upon delete to
-   * ensure that data of all records is contiguous.  Slot array is compacted if
-   * the slot deleted is at the end of the slot array and
-   * <allow_slot_compaction> is set.
+   * Deletes the record with the given ID.  Its bytes are only counted as
+   * fragmented; see compact().  Slot array is compacted if the slot deleted is
+   * at the end of the slot array and <allow_slot_compaction> is set.
    *
    * @param record_id             ID of the record to delete.
    * @param allow_slot_compaction If true, the slot array will be compacted if
@@ -252,6 +580,56 @@ class Page {
   void deleteRecord(const RecordId& record_id,
                     const bool allow_slot_compaction);
 
+  /**
+   * Replaces the data item of a used slot of a slotted page, in place if
+   * possible.
+   *
+   * @param record_id   ID of record.
+   * @param item_data   New data item.
+   * @param flags       Flags of the slot (PageSlot::FORWARD or MOVED) to set.
+   * @throws  InsufficientSpaceException  If the page can't hold the item.
+   */
+  void replaceItem(const RecordId& record_id, const std::string& item_data,
+                   const std::uint16_t flags);
+
+  /**
+   * Returns true if the page has room for a new record of the given length.
+   *
+   * @param length  Length of record in bytes.
+   * @return  Whether the page can hold the record.
+   */
+  bool hasSpaceForLength(std::size_t length) const;
+
+  /**
+   * Returns the free space between the slot array and the first record, in
+   * bytes.
+   *
+   * @return  Contiguous free space in bytes.
+   */
+  std::uint16_t getContiguousFreeSpace() const {
+    return header_.free_space_upper_bound - header_.free_space_lower_bound;
+  }
+
+  /**
+   * Compacts the page if there are fewer than <length> bytes of contiguous
+   * free space.  Callers are responsible for making sure the page has
+   * <length> bytes of free space in total.
+   *
+   * @param length  Number of contiguous free bytes needed.
+   */
+  void reserveContiguousSpace(const std::size_t length) {
+    if (getContiguousFreeSpace() < length) {
+      compact();
+    }
+  }
+
+  /**
+   * Moves all records to the end of the page, in place, so that the space
+   * left by deleted records joins the contiguous free space.  Slots keep their
+   * numbers, so record IDs do not change.
+   */
+  void compact();
+
   /**
    * Returns the slot with the given number.  This method will return
    * unallocated slots if requested; it is up to the caller to ensure they
@@ -273,24 +651,27 @@ class Page {
   const PageSlot& getSlot(const SlotId slot_number) const;
 
   /**
-   * Returns the slot number of an available slot.  If no slots are available
-   * to be reused, allocates a new slot.  Updates available slot count in the
-   * header metadata, but does not mark returned slot as used.  If a new slot is
-   * allocated, updates the free space lower bound.
+   * Returns the slot number of an available slot: the first slot in the chain
+   * of free slots.  If no slots are available to be reused, allocates a new
+   * slot and puts it on the chain, updating the available slot count and the
+   * free space lower bound.
    *
    * Callers are responsible for making sure there is enough space to allocate a
    * new slot before calling this method.
    *
-   * Since the returned slot is not marked as used, callers must take care to
-   * fill the slot or mark it used before someone else calls this method.
+   * Since the returned slot stays on the chain until it is filled, callers
+   * must take care to fill it before someone else calls this method.
    *
    * @return  Slot number of an unused slot.
    */
   SlotId getAvailableSlot();
 
   /**
-   * Inserts record data into the given slot.  The slot should not be currently
-   * in use.  <slot_number> must be less than <header_.num_slots>.
+   * Inserts record data into the given slot, taking it off the chain of free
+   * slots.  The slot should not be currently in use.  <slot_number> must be
+   * less than <header_.num_slots>.  Takes constant time if the slot is the
+   * first one on the chain, as it is for slots returned by getAvailableSlot()
+   * or just freed by deleteRecord().
    *
    * Callers are responsible for making sure there is enough space to hold the
    * record before calling this method.
@@ -321,6 +702,216 @@ class Page {
    */
   bool isUsed() const { return page_number() != INVALID_NUMBER; }
 
+  // The fixed-width format: a bitmap of occupied slots at the start of the
+  // data area, padded to a multiple of 8 bytes so that records whose width is
+  // a multiple of 8 are aligned, followed by the records, slot 1 first.  The
+  // helpers below take
+  // the width and capacity as arguments, so that FixedWidthPage gets them
+  // folded in as constants while the generic record operations pass the
+  // values from the header.
+
+  /**
+   * Returns the size in bytes of the bitmap of a fixed-width page.
+   *
+   * @param capacity  Number of slots on the page.
+   */
+  static constexpr std::size_t fixedBitmapBytes(const std::size_t capacity) {
+    return (capacity + 63) / 64 * 8;
+  }
+
+  /**
+   * Returns the number of records of <width> bytes a fixed-width page holds:
+   * the most for which the records and the bitmap fit in the data area.
+   *
+   * @param width   Record width in bytes.
+   */
+  static constexpr std::size_t fixedCapacity(const std::size_t width) {
+    // Without the padding, the bitmap and records would take 1/8 + width
+    // bytes per record; count down from there.
+    return fixedCapacityAtMost(width, DATA_SIZE * 8 / (width * 8 + 1));
+  }
+
+  /**
+   * Returns the largest number of records of <width> bytes, no more than
+   * <capacity>, which fit on a fixed-width page.
+   *
+   * @param width     Record width in bytes.
+   * @param capacity  Upper bound.
+   */
+  static constexpr std::size_t fixedCapacityAtMost(const std::size_t width,
+                                                   const std::size_t capacity) {
+    return fixedBitmapBytes(capacity) + capacity * width <= DATA_SIZE
+        ? capacity
+        : fixedCapacityAtMost(width, capacity - 1);
+  }
+
+  /**
+   * Returns the offset in the data area of a slot's record.
+   *
+   * @param slot_number   Number of slot.
+   * @param width         Record width in bytes.
+   * @param capacity      Number of slots on the page.
+   */
+  static std::size_t fixedRecordOffset(const SlotId slot_number,
+                                       const std::size_t width,
+                                       const std::size_t capacity) {
+    return fixedBitmapBytes(capacity) + (slot_number - 1) * width;
+  }
+
+  /**
+   * Returns whether the given slot of a fixed-width page holds a record.
+   *
+   * @param slot_number   Number of slot.
+   */
+  bool fixedSlotUsed(const SlotId slot_number) const {
+    return (static_cast<unsigned char>(data_[(slot_number - 1) / 8]) >>
+            ((slot_number - 1) % 8)) & 1;
+  }
+
+  /**
+   * Turns this page, which must hold no records, into a fixed-width page.
+   *
+   * @param width     Record width in bytes.
+   * @param capacity  Number of slots on the page.
+   */
+  void formatFixedWidth(const std::size_t width, const std::size_t capacity) {
+    std::memset(data_, '\0', fixedBitmapBytes(capacity));
+    header_.free_space_lower_bound = 0;
+    header_.free_space_upper_bound = 0;
+    header_.num_slots = capacity;
+    header_.num_free_slots = capacity;
+    header_.first_free_slot = 1;
+    header_.fragmented_bytes = 0;
+    header_.record_width = width;
+    header_.num_attributes = 0;
+  }
+
+  /**
+   * Marks the lowest free slot of a fixed-width page, which must not be full,
+   * as used.
+   *
+   * @return  Number of the slot.
+   */
+  SlotId fixedAllocateSlot() {
+    SlotId slot_number = header_.first_free_slot;
+    while (fixedSlotUsed(slot_number)) {
+      // Skip whole bytes of occupied slots.
+      const bool byte_full =
+          (slot_number - 1) % 8 == 0 &&
+          static_cast<unsigned char>(data_[(slot_number - 1) / 8]) == 0xff;
+      slot_number += byte_full ? 8 : 1;
+    }
+    data_[(slot_number - 1) / 8] |= 1 << ((slot_number - 1) % 8);
+    --header_.num_free_slots;
+    header_.first_free_slot = slot_number + 1;
+    return slot_number;
+  }
+
+  /**
+   * Marks a used slot of a fixed-width page as free.
+   *
+   * @param slot_number   Number of slot.
+   */
+  void fixedFreeSlot(const SlotId slot_number) {
+    data_[(slot_number - 1) / 8] &= ~(1 << ((slot_number - 1) % 8));
+    ++header_.num_free_slots;
+    if (slot_number < header_.first_free_slot) {
+      header_.first_free_slot = slot_number;
+    }
+  }
+
+  /**
+   * Inserts a record into the lowest free slot of a fixed-width page, which
+   * must not be full.
+   *
+   * @param record_data   First of the <width> bytes of the record.
+   * @param width         Record width in bytes.
+   * @param capacity      Number of slots on the page.
+   * @return  Slot the record went into.
+   */
+  SlotId fixedInsert(const char* record_data, const std::size_t width,
+                     const std::size_t capacity) {
+    const SlotId slot_number = fixedAllocateSlot();
+    std::memcpy(&data_[fixedRecordOffset(slot_number, width, capacity)],
+                record_data, width);
+    return slot_number;
+  }
+
+  /**
+   * Frees a used slot of a fixed-width page.
+   *
+   * @param slot_number   Number of slot.
+   * @param width         Record width in bytes.
+   * @param capacity      Number of slots on the page.
+   */
+  void fixedDelete(const SlotId slot_number, const std::size_t width,
+                   const std::size_t capacity) {
+    fixedFreeSlot(slot_number);
+    std::memset(&data_[fixedRecordOffset(slot_number, width, capacity)], '\0',
+                width);
+  }
+
+  // The PAX layout: the fixed-width bitmap, then an array of PaxAttribute
+  // padded to a multiple of 8 bytes, then one minipage per attribute, each
+  // padded likewise.
+
+  /**
+   * Turns this page, which must hold no records, into a PAX page for records
+   * with attributes of the given widths, fitting as many records as possible.
+   *
+   * @param attribute_widths  Width of each attribute in bytes.
+   * @throws  RecordWidthException  If there are no attributes, an attribute
+   *                                is empty, or a page can't hold two records.
+   */
+  void formatPax(const std::vector<std::uint16_t>& attribute_widths);
+
+  /**
+   * Returns the attribute array of a PAX page.
+   */
+  const PaxAttribute* paxAttributes() const {
+    return reinterpret_cast<const PaxAttribute*>(
+        &data_[fixedBitmapBytes(header_.num_slots)]);
+  }
+
+  /**
+   * Copies a record's attributes into their minipages.
+   *
+   * @param slot_number   Number of slot.
+   * @param record_data   Record, attributes in order.
+   */
+  void paxScatter(const SlotId slot_number, const char* record_data);
+
+  /**
+   * Copies a record's attributes out of their minipages.
+   *
+   * @param slot_number   Number of slot.
+   * @param record_data   Receives the record, attributes in order.
+   */
+  void paxGather(const SlotId slot_number, char* record_data) const;
+
+  /**
+   * Returns the next used slot of a fixed-width page after the given slot, or
+   * Page::INVALID_SLOT if there is none.  Skips empty bitmap bytes whole.
+   *
+   * @param start     Slot to start search at.
+   * @param capacity  Number of slots on the page.
+   */
+  SlotId fixedNextUsedSlot(const SlotId start,
+                           const std::size_t capacity) const {
+    // <index> is the zero-based index of the slot after <start>.
+    std::size_t index = start;
+    while (index < capacity) {
+      const unsigned bits =
+          static_cast<unsigned char>(data_[index / 8]) >> (index % 8);
+      if (bits != 0) {
+        index += __builtin_ctz(bits);
+        return index < capacity ? index + 1 : INVALID_SLOT;
+      }
+      index = (index / 8 + 1) * 8;
+    }
+    return INVALID_SLOT;
+  }
+
   /**
    * Header metadata.
    */
@@ -337,6 +928,9 @@ class Page {
   friend class PageFile;
   friend class BlobFile;
   friend class PageIterator;
+  friend class FileIterator;
+  friend class PaxPage;
+  template <std::size_t RECORD_SIZE> friend class FixedWidthPage;
 };
 
 static_assert(Page::SIZE > sizeof(PageHeader),
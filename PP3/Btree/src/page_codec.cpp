@@ -0,0 +1,235 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_codec.h"
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Number of bits of the hash used to find match candidates.
+ */
+const unsigned HASH_BITS = 12;
+
+/**
+ * Longest back-reference offset the format can express.
+ */
+const std::size_t MAX_OFFSET = 65535;
+
+/**
+ * Value of a token nibble which says more length bytes follow.
+ */
+const std::size_t NIBBLE_MAX = 15;
+
+inline uint32_t read32(const char* p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline uint64_t read64(const char* p) {
+  uint64_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline unsigned hash(const uint32_t value) {
+  return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/**
+ * Appends the extra bytes for a length whose nibble was saturated.
+ *
+ * @return  New output position, or NULL if the output is full.
+ */
+char* writeLength(std::size_t length, char* op, const char* op_end) {
+  while (length >= 255) {
+    if (op == op_end) {
+      return NULL;
+    }
+    *op++ = static_cast<char>(255);
+    length -= 255;
+  }
+  if (op == op_end) {
+    return NULL;
+  }
+  *op++ = static_cast<char>(length);
+  return op;
+}
+
+/**
+ * Reads the extra bytes of a length whose nibble was saturated.
+ *
+ * @return  False if the input runs out.
+ */
+bool readLength(const unsigned char*& ip, const unsigned char* ip_end,
+                std::size_t& length) {
+  unsigned char byte;
+  do {
+    if (ip == ip_end) {
+      return false;
+    }
+    byte = *ip++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/**
+ * Appends a sequence of <num_literals> literals at <literals> followed by a
+ * match of <match_length> bytes at <offset> back (or no match if
+ * <match_length> is 0).
+ *
+ * @return  New output position, or NULL if the output is full.
+ */
+char* writeSequence(const char* literals, const std::size_t num_literals,
+                    const std::size_t offset, const std::size_t match_length,
+                    char* op, const char* op_end) {
+  if (op == op_end) {
+    return NULL;
+  }
+  const std::size_t match_code =
+      match_length > 0 ? match_length - PageCodec::MIN_MATCH : 0;
+  char* token = op++;
+  *token = static_cast<char>(
+      ((num_literals < NIBBLE_MAX ? num_literals : NIBBLE_MAX) << 4) |
+      (match_code < NIBBLE_MAX ? match_code : NIBBLE_MAX));
+  if (num_literals >= NIBBLE_MAX) {
+    op = writeLength(num_literals - NIBBLE_MAX, op, op_end);
+    if (op == NULL) {
+      return NULL;
+    }
+  }
+  if (static_cast<std::size_t>(op_end - op) < num_literals) {
+    return NULL;
+  }
+  std::memcpy(op, literals, num_literals);
+  op += num_literals;
+  if (match_length == 0) {
+    return op;
+  }
+
+  if (op_end - op < 2) {
+    return NULL;
+  }
+  *op++ = static_cast<char>(offset & 0xff);
+  *op++ = static_cast<char>(offset >> 8);
+  if (match_code >= NIBBLE_MAX) {
+    op = writeLength(match_code - NIBBLE_MAX, op, op_end);
+  }
+  return op;
+}
+
+}
+
+std::size_t PageCodec::compress(const char* src, const std::size_t src_size,
+                                char* dst, const std::size_t dst_capacity) {
+  // Positions are kept plus one, so that 0 means no candidate yet.
+  uint16_t table[1 << HASH_BITS];
+  std::memset(table, 0, sizeof(table));
+
+  char* op = dst;
+  const char* op_end = dst + dst_capacity;
+  std::size_t anchor = 0;
+  std::size_t pos = 0;
+  while (pos + MIN_MATCH <= src_size) {
+    const uint32_t value = read32(src + pos);
+    const unsigned h = hash(value);
+    const std::size_t candidate = table[h];
+    table[h] = static_cast<uint16_t>(pos + 1);
+    if (candidate == 0 || pos + 1 - candidate > MAX_OFFSET ||
+        read32(src + candidate - 1) != value) {
+      ++pos;
+      continue;
+    }
+
+    const std::size_t match_start = candidate - 1;
+    std::size_t match_length = MIN_MATCH;
+    while (pos + match_length + sizeof(uint64_t) <= src_size &&
+           read64(src + match_start + match_length) ==
+           read64(src + pos + match_length)) {
+      match_length += sizeof(uint64_t);
+    }
+    while (pos + match_length < src_size &&
+           src[match_start + match_length] == src[pos + match_length]) {
+      ++match_length;
+    }
+    op = writeSequence(src + anchor, pos - anchor, pos - match_start,
+                       match_length, op, op_end);
+    if (op == NULL) {
+      return 0;
+    }
+    pos += match_length;
+    anchor = pos;
+  }
+
+  if (anchor < src_size) {
+    op = writeSequence(src + anchor, src_size - anchor, 0 /* offset */,
+                       0 /* match_length */, op, op_end);
+    if (op == NULL) {
+      return 0;
+    }
+  }
+  return op - dst;
+}
+
+bool PageCodec::decompress(const char* src, const std::size_t src_size,
+                           char* dst, const std::size_t dst_size) {
+  const unsigned char* ip = reinterpret_cast<const unsigned char*>(src);
+  const unsigned char* ip_end = ip + src_size;
+  std::size_t out = 0;
+  while (ip < ip_end) {
+    const unsigned token = *ip++;
+    std::size_t num_literals = token >> 4;
+    if (num_literals == NIBBLE_MAX && !readLength(ip, ip_end, num_literals)) {
+      return false;
+    }
+    if (static_cast<std::size_t>(ip_end - ip) < num_literals ||
+        dst_size - out < num_literals) {
+      return false;
+    }
+    std::memcpy(dst + out, ip, num_literals);
+    ip += num_literals;
+    out += num_literals;
+    if (ip == ip_end) {
+      break;
+    }
+
+    if (ip_end - ip < 2) {
+      return false;
+    }
+    const std::size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    std::size_t match_length = token & NIBBLE_MAX;
+    if (match_length == NIBBLE_MAX && !readLength(ip, ip_end, match_length)) {
+      return false;
+    }
+    match_length += MIN_MATCH;
+    if (offset == 0 || offset > out || dst_size - out < match_length) {
+      return false;
+    }
+    // The match may overlap the bytes it produces, repeating the last <offset>
+    // bytes; copy it in chunks no longer than what has been produced so far.
+    const char* match = dst + out - offset;
+    char* op = dst + out;
+    out += match_length;
+    while (match_length > 0) {
+      const std::size_t chunk = std::min<std::size_t>(op - match, match_length);
+      std::memcpy(op, match, chunk);
+      op += chunk;
+      match_length -= chunk;
+    }
+  }
+  return out == dst_size;
+}
+
+}
@@ -0,0 +1,59 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace badgerdb {
+
+/**
+ * @brief Byte-oriented LZ77 codec for compressing pages on disk.
+ *
+ * Fast and self-contained rather than tight: it is meant for pages which are
+ * mostly zero padding and repetitive fixed-width records.  The compressed
+ * form is a series of sequences, each a token byte (literal count in the high
+ * nibble, match length minus MIN_MATCH in the low nibble; 15 means more
+ * length bytes follow, each adding up to 255), the literals, then a 2-byte
+ * little-endian back-reference offset and any extra match length bytes.  The
+ * last sequence has literals only.
+ */
+class PageCodec {
+ public:
+  /**
+   * Shortest match worth encoding.
+   */
+  static const std::size_t MIN_MATCH = 4;
+
+  /**
+   * Compresses <src_size> bytes of <src> into <dst>.
+   *
+   * @param src           Data to compress.
+   * @param src_size      Number of bytes of data; at most 65535.
+   * @param dst           Buffer for the compressed data.
+   * @param dst_capacity  Size of <dst>.
+   * @return  Size of the compressed data, or 0 if it doesn't fit in <dst>.
+   */
+  static std::size_t compress(const char* src, const std::size_t src_size,
+                              char* dst, const std::size_t dst_capacity);
+
+  /**
+   * Decompresses <src_size> bytes of compressed data into exactly <dst_size>
+   * bytes at <dst>.
+   *
+   * @param src       Compressed data.
+   * @param src_size  Number of bytes of compressed data.
+   * @param dst       Buffer for the decompressed data.
+   * @param dst_size  Expected size of the decompressed data.
+   * @return  True on success; false if the data is corrupt or decompresses to
+   *          a different size.
+   */
+  static bool decompress(const char* src, const std::size_t src_size,
+                         char* dst, const std::size_t dst_size);
+};
+
+}
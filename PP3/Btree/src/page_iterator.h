@@ -36,7 +36,7 @@ class PageIterator {
    *
    * @param page  Page to iterate over.
    */
-  PageIterator(Page* page)
+  PageIterator(const Page* page)
       : page_(page)  {
     assert(page_ != NULL);
     const SlotId used_slot = getNextUsedSlot(Page::INVALID_SLOT /* start */);
@@ -50,16 +50,21 @@ class PageIterator {
    * @param page        Page to iterate over.
    * @param record_id   ID of record to start iterator at.
    */
-  PageIterator(Page* page, const RecordId& record_id)
+  PageIterator(const Page* page, const RecordId& record_id)
       : page_(page),
         current_record_(record_id) {
   }
 
   /**
-   * Advances the iterator to the next record in the page.
+   * Advances the iterator to the next record in the page.  An iterator at
+   * the end stays there.
    */
 	inline PageIterator& operator++() {
     assert(page_ != NULL);
+    if (current_record_.slot_number == Page::INVALID_SLOT) {
+      // Already at the end.
+      return *this;
+    }
     const SlotId used_slot = getNextUsedSlot(current_record_.slot_number);
     current_record_ = {page_->page_number(), used_slot, 0};
 
@@ -70,6 +75,10 @@ class PageIterator {
 		PageIterator tmp = *this;   // copy ourselves
 
     assert(page_ != NULL);
+    if (current_record_.slot_number == Page::INVALID_SLOT) {
+      // Already at the end.
+      return tmp;
+    }
     const SlotId used_slot = getNextUsedSlot(current_record_.slot_number);
     current_record_ = {page_->page_number(), used_slot, 0};
 
@@ -92,27 +101,41 @@ class PageIterator {
   }
 
   /**
-   * Dereferences the iterator, returning a copy of the current record in the
-   * page.
+   * Dereferences the iterator, returning a view of the current record where
+   * it is stored in the page.  Convert it to std::string for a copy.  Records
+   * of PAX pages are assembled in the iterator, so the view only lasts until
+   * the iterator is dereferenced again or advanced.
    *
    * @return  Record in page.
    */
-	inline std::string operator*() const {
-		return page_->getRecord(current_record_); 
+	inline RecordView operator*() const {
+    if (page_->isPax()) {
+      // Attributes are stored apart; assemble the record in <record_>.
+      page_->validateRecordId(current_record_);
+      record_.resize(page_->header_.record_width);
+      page_->paxGather(current_record_.slot_number, &record_[0]);
+      return RecordView(record_);
+    }
+		return page_->getRecordView(current_record_); 
 	}
 
   /**
    * Returns the next used slot in the page after the given slot or
-   * Page::INVALID_SLOT if no slots are used after the given slot.
+   * Page::INVALID_SLOT if no slots are used after the given slot.  Slots
+   * holding forwarding stubs are skipped, as their records are visited on
+   * the pages they moved to.
    *
    * @param start   Slot to start search at.
    * @return  Next used slot after given slot or Page::INVALID_SLOT.
    */
   SlotId getNextUsedSlot(const SlotId start) const {
+    if (page_->isFixedWidth()) {
+      return page_->fixedNextUsedSlot(start, page_->header_.num_slots);
+    }
     SlotId slot_number = Page::INVALID_SLOT;
     for (SlotId i = start + 1; i <= page_->header_.num_slots; ++i) {
-      const PageSlot* slot = page_->getSlot(i);
-      if (slot->used) {
+      const PageSlot& slot = page_->getSlot(i);
+      if (slot.used() && !slot.isForward()) {
         slot_number = i;
         break;
       }
@@ -129,13 +152,18 @@ class PageIterator {
   /**
    * Page we're iterating over.
    */
-  Page* page_;
+  const Page* page_;
 
   /**
    * ID of record iterator is currently pointing to.
    */
   RecordId current_record_;
 
+  /**
+   * Current record of a PAX page, assembled by operator*.
+   */
+  mutable std::string record_;
+
   //FRIEND_TEST(PageTest, GetNextUsedSlot);
   //FRIEND_TEST(BufferTest, GetNextUsedSlot);
 };
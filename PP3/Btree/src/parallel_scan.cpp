@@ -0,0 +1,216 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "parallel_scan.h"
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include "file_iterator.h"
+#include "page_iterator.h"
+#include "exceptions/bad_scan_param_exception.h"
+
+namespace badgerdb {
+
+const std::size_t ParallelScan::DEFAULT_MORSEL_PAGES;
+
+ParallelScan::ParallelScan(PageFile *scanFile, BufMgr *bufferMgr,
+                           unsigned numWorkers, std::size_t pagesPerMorsel)
+{
+  if (pagesPerMorsel == 0)
+  {
+    throw BadScanParamException();
+  }
+  file = scanFile;
+  bufMgr = bufferMgr;
+  workerCount = numWorkers;
+  if (workerCount == 0)
+  {
+    workerCount = std::thread::hardware_concurrency();
+    if (workerCount == 0)
+    {
+      workerCount = 1;
+    }
+  }
+  morselPages = pagesPerMorsel;
+  zoneAttribute = -1;
+  zoneLow = zoneHigh = 0;
+  for (unsigned i = 0; i < workerCount; ++i)
+  {
+    queues.push_back(new MorselQueue());
+  }
+}
+
+ParallelScan::~ParallelScan()
+{
+  for (std::size_t i = 0; i < queues.size(); ++i)
+  {
+    delete queues[i];
+  }
+}
+
+void ParallelScan::setPredicate(const ScanPredicate& scanPredicate)
+{
+  predicate = scanPredicate;
+}
+
+void ParallelScan::setZoneRange(std::size_t attribute, double low, double high)
+{
+  if (attribute >= file->zoneAttributes().size())
+  {
+    throw BadScanParamException();
+  }
+  zoneAttribute = attribute;
+  zoneLow = low;
+  zoneHigh = high;
+}
+
+void ParallelScan::run(const Sink& sink)
+{
+  // the workers read the file on disk, so it must hold what the pool does
+  bufMgr->syncFile(file);
+  planMorsels();
+
+  std::atomic<bool> stop(false);
+  std::mutex errorLock;
+  std::exception_ptr error;
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < workerCount; ++i)
+  {
+    workers.push_back(std::thread([this, i, &sink, &stop, &errorLock, &error]()
+    {
+      try
+      {
+        work(i, sink, stop);
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> guard(errorLock);
+        if (!error)
+        {
+          error = std::current_exception();
+        }
+        stop = true;
+      }
+    }));
+  }
+  for (std::size_t i = 0; i < workers.size(); ++i)
+  {
+    workers[i].join();
+  }
+
+  for (unsigned i = 0; i < workerCount; ++i)
+  {
+    queues[i]->morsels.clear();
+  }
+  if (error)
+  {
+    std::rethrow_exception(error);
+  }
+}
+
+void ParallelScan::planMorsels()
+{
+  // the directory says which pages are used without reading them
+  pageNumbers.clear();
+  for (FileIterator it = file->begin(); it != file->end(); ++it)
+  {
+    if (zoneAttribute < 0 ||
+        it.getDirectoryEntry().zones[zoneAttribute].overlaps(zoneLow, zoneHigh))
+    {
+      pageNumbers.push_back(it.getCurrentPageNo());
+    }
+  }
+
+  // deal out contiguous shares, so each worker mostly reads sequentially
+  const std::size_t numMorsels =
+      (pageNumbers.size() + morselPages - 1) / morselPages;
+  for (std::size_t m = 0; m < numMorsels; ++m)
+  {
+    Morsel morsel;
+    morsel.first = m * morselPages;
+    morsel.count = std::min(morselPages, pageNumbers.size() - morsel.first);
+    queues[m * workerCount / numMorsels]->morsels.push_back(morsel);
+  }
+}
+
+bool ParallelScan::takeMorsel(unsigned worker, Morsel& morsel)
+{
+  {
+    MorselQueue& own = *queues[worker];
+    std::lock_guard<std::mutex> guard(own.lock);
+    if (!own.morsels.empty())
+    {
+      morsel = own.morsels.front();
+      own.morsels.pop_front();
+      return true;
+    }
+  }
+  // steal from the back, away from where the owner is working
+  for (unsigned i = 1; i < workerCount; ++i)
+  {
+    MorselQueue& victim = *queues[(worker + i) % workerCount];
+    std::lock_guard<std::mutex> guard(victim.lock);
+    if (!victim.morsels.empty())
+    {
+      morsel = victim.morsels.back();
+      victim.morsels.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ParallelScan::work(unsigned worker, const Sink& sink,
+                        std::atomic<bool>& stop)
+{
+  std::vector<Page> pages(morselPages);
+  Morsel morsel;
+  while (!stop && takeMorsel(worker, morsel))
+  {
+    scanMorsel(worker, morsel, pages, sink);
+  }
+}
+
+void ParallelScan::scanMorsel(unsigned worker, const Morsel& morsel,
+                              std::vector<Page>& pages, const Sink& sink)
+{
+  // read each run of consecutive page numbers with a single read
+  std::size_t i = 0;
+  while (i < morsel.count)
+  {
+    std::size_t run = 1;
+    while (i + run < morsel.count &&
+           pageNumbers[morsel.first + i + run] ==
+               pageNumbers[morsel.first + i] + run)
+    {
+      ++run;
+    }
+    std::vector<Page*> targets(run);
+    for (std::size_t j = 0; j < run; ++j)
+    {
+      targets[j] = &pages[i + j];
+    }
+    file->readPagesInto(pageNumbers[morsel.first + i], targets);
+    i += run;
+  }
+
+  for (std::size_t p = 0; p < morsel.count; ++p)
+  {
+    Page* page = &pages[p];
+    for (PageIterator it = page->begin(); it != page->end(); ++it)
+    {
+      const RecordView record = *it;
+      if (predicate.empty() || predicate.matches(record))
+      {
+        sink(worker, page->getHomeRecordId(it.getCurrentRecord()), record);
+      }
+    }
+  }
+}
+
+}
@@ -0,0 +1,178 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "scan_predicate.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Range of pages of a relation handed to one worker of a
+ *        ParallelScan at a time.
+ */
+struct Morsel {
+  /**
+   * Index of the morsel's first page in the scan's list of pages.
+   */
+  std::size_t first;
+
+  /**
+   * Number of pages in the morsel.
+   */
+  std::size_t count;
+};
+
+/**
+ * @brief Scans the records of a relation with several threads.
+ *
+ * The used pages of the file, as listed by its page directory, are split
+ * into morsels of consecutive pages.  Each worker thread starts with a
+ * contiguous share of the morsels, so that it mostly reads the file
+ * sequentially, and once it runs out steals morsels from the back of other
+ * workers' shares, so a worker held up by slow pages doesn't hold up the
+ * scan.
+ *
+ * Workers read their pages straight into buffers of their own, a run of
+ * consecutive pages per read, rather than through the BufMgr, which is not
+ * threadsafe.  So that they still see every change, run() first writes out
+ * the pages of the file held dirty in the buffer pool, and refuses to scan
+ * while one of them is pinned.
+ *
+ * Records are handed to a sink, which is told the worker calling it so that
+ * it can collect results per worker without locking.  A predicate and a zone
+ * range can restrict the records as for FileScan.
+ *
+ * @warning A ParallelScan object must only be used from one thread at a
+ *          time; the sink is called from all the workers at once.
+ */
+class ParallelScan
+{
+ public:
+  /**
+   * Called with the worker index, home record ID and contents of each record
+   * returned.  The view is valid until the sink returns.
+   */
+  typedef std::function<void(unsigned, const RecordId&, const RecordView&)>
+      Sink;
+
+  /**
+   * Number of pages of a morsel by default.
+   */
+  static const std::size_t DEFAULT_MORSEL_PAGES = 64;
+
+  /**
+   * Opens a scan of a relation whose pages are read and changed through
+   * <bufMgr>.  The file object must be the one the buffer pool's pages of the
+   * relation belong to.
+   *
+   * @param file          File of the relation.
+   * @param bufMgr        Buffer manager the relation's pages are changed in.
+   * @param numWorkers    Number of worker threads, or 0 for one per hardware
+   *                      thread.
+   * @param morselPages   Number of pages of each morsel.
+   * @throws  BadScanParamException   If morselPages is 0.
+   */
+  ParallelScan(PageFile *file, BufMgr *bufMgr, unsigned numWorkers = 0,
+               std::size_t morselPages = DEFAULT_MORSEL_PAGES);
+
+  ~ParallelScan();
+
+  //restricts the scan to records satisfying <predicate>.  call before run
+  void setPredicate(const ScanPredicate& predicate);
+
+  //skips pages whose zone map says they hold no value of zone attribute
+  //<attribute> of the file in [low, high], as FileScan::setZoneRange.  call
+  //before run
+  void setZoneRange(std::size_t attribute, double low, double high);
+
+  //returns the number of worker threads
+  unsigned numWorkers() const { return workerCount; }
+
+  //scans the whole relation, passing every record to <sink>, and returns
+  //once all the workers are done.  an exception thrown by a worker (or the
+  //sink) stops the scan and is rethrown here.  throws PagePinnedException,
+  //before scanning anything, if a page of the file is pinned dirty
+  void run(const Sink& sink);
+
+ private:
+  /**
+   * Morsels not yet taken by any worker, one queue per worker.
+   */
+  struct MorselQueue {
+    std::mutex            lock;
+    std::deque<Morsel>    morsels;
+  };
+
+  /**
+   * File which is being scanned.  Only read, which is safe from several
+   * threads.
+   */
+  PageFile      *file;
+
+  /**
+   * Buffer manager whose dirty pages of the file are written out before the
+   * scan.  Not used by the workers.
+   */
+  BufMgr        *bufMgr;
+
+  unsigned      workerCount;
+  std::size_t   morselPages;
+
+  ScanPredicate predicate;
+
+  /**
+   * Zone attribute pages are skipped by, or -1 to scan every page.
+   */
+  int           zoneAttribute;
+  double        zoneLow;
+  double        zoneHigh;
+
+  /**
+   * Numbers of the pages to scan, in file order.
+   */
+  std::vector<PageId> pageNumbers;
+
+  std::vector<MorselQueue*> queues;
+
+  /**
+   * Lists the pages to scan and deals the morsels out to the workers.
+   */
+  void planMorsels();
+
+  /**
+   * Takes the next morsel of a worker: the first of its own, or else the last
+   * of another worker's.
+   *
+   * @return  False if there are none left.
+   */
+  bool takeMorsel(unsigned worker, Morsel& morsel);
+
+  /**
+   * Body of a worker thread.
+   */
+  void work(unsigned worker, const Sink& sink, std::atomic<bool>& stop);
+
+  /**
+   * Scans the pages of a morsel.
+   */
+  void scanMorsel(unsigned worker, const Morsel& morsel,
+                  std::vector<Page>& pages, const Sink& sink);
+};
+
+}
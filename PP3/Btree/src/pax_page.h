@@ -0,0 +1,202 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include "page.h"
+#include "types.h"
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/invalid_record_exception.h"
+#include "exceptions/record_width_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Access to a page holding fixed-width records by attribute (PAX).
+ *
+ * A PAX page stores its records' values of each attribute together in a
+ * minipage of their own, so a scan that reads a few attributes of every
+ * record touches only their minipages and reads each as a dense array.  Like
+ * a fixed-width page it keeps a bitmap of occupied slots, and pages stay
+ * ordinary Page objects: record IDs are page and slot numbers, and Page's
+ * record operations, PageIterator and FileScan work on PAX pages by
+ * assembling each record from its attributes (except Page::getRecordView,
+ * as the bytes of a record are not contiguous).
+ *
+ * Records passed to and returned by this class hold the attributes in order
+ * with no padding between them.  A PaxPage does not own its page; it is only
+ * valid while the page is (e.g. while the page is pinned in the buffer pool).
+ *
+ * @warning This class is not threadsafe.
+ */
+class PaxPage {
+ public:
+  /**
+   * Formats the given page, which must hold no records (e.g. one just
+   * returned by PageFile::allocatePage), for records with attributes of the
+   * given widths.
+   *
+   * @param page              Page to access.  Must not be null.
+   * @param attribute_widths  Width of each attribute in bytes.
+   * @throws  RecordWidthException  If the page holds records, the widths
+   *                                are empty or include 0, or a page can't
+   *                                hold two records.
+   */
+  PaxPage(Page* page, const std::vector<std::uint16_t>& attribute_widths)
+      : page_(page) {
+    assert(page_ != NULL);
+    if (page_->isFixedWidth() || page_->header_.num_slots != 0) {
+      throw RecordWidthException(page_->page_number(),
+                                 page_->header_.record_width, 0);
+    }
+    page_->formatPax(attribute_widths);
+  }
+
+  /**
+   * Wraps the given page, which must already be a PAX page.
+   *
+   * @param page  Page to access.  Must not be null.
+   * @throws  RecordWidthException  If the page is not a PAX page.
+   */
+  explicit PaxPage(Page* page)
+      : page_(page) {
+    assert(page_ != NULL);
+    if (!page_->isPax()) {
+      throw RecordWidthException(page_->page_number(),
+                                 page_->header_.record_width, 0);
+    }
+  }
+
+  /**
+   * Returns the page being accessed.
+   */
+  Page* page() const { return page_; }
+
+  /**
+   * Returns the number of attributes of the records.
+   */
+  std::size_t numAttributes() const { return page_->header_.num_attributes; }
+
+  /**
+   * Returns the width in bytes of the given attribute.
+   *
+   * @param attribute   Index of attribute.
+   */
+  std::size_t attributeWidth(const std::size_t attribute) const {
+    assert(attribute < numAttributes());
+    return page_->paxAttributes()[attribute].width;
+  }
+
+  /**
+   * Returns the width in bytes of a whole record.
+   */
+  std::size_t recordWidth() const { return page_->header_.record_width; }
+
+  /**
+   * Returns the number of records the page holds when full.
+   */
+  std::size_t capacity() const { return page_->header_.num_slots; }
+
+  /**
+   * Returns the number of records on the page.
+   */
+  std::size_t numRecords() const {
+    return page_->header_.num_slots - page_->header_.num_free_slots;
+  }
+
+  /**
+   * Returns true if the page has no free slot left.
+   */
+  bool isFull() const { return page_->header_.num_free_slots == 0; }
+
+  /**
+   * Copies a record into the lowest free slot.
+   *
+   * @param record_data   First of the recordWidth() bytes of the record.
+   * @return  ID of the new record.
+   * @throws  InsufficientSpaceException  If the page is full.
+   */
+  RecordId insertRecord(const void* record_data) {
+    if (isFull()) {
+      throw InsufficientSpaceException(page_->page_number(), recordWidth(), 0);
+    }
+    const SlotId slot_number = page_->fixedAllocateSlot();
+    page_->paxScatter(slot_number, static_cast<const char*>(record_data));
+    const RecordId record_id = {page_->page_number(), slot_number, 0};
+    return record_id;
+  }
+
+  /**
+   * Copies the record with the given ID out of the page.
+   *
+   * @param record_id     ID of record.
+   * @param record_data   Receives the recordWidth() bytes of the record.
+   * @throws  InvalidRecordException  If the ID has a bad page or slot number.
+   */
+  void readRecord(const RecordId& record_id, void* record_data) const {
+    page_->validateRecordId(record_id);
+    page_->paxGather(record_id.slot_number, static_cast<char*>(record_data));
+  }
+
+  /**
+   * Returns the minipage of the given attribute: its value for every slot,
+   * slot 1 first, attributeWidth() bytes each.  Values in free slots are
+   * zero; check isUsed() or nextUsedSlot() when the page may have some.
+   *
+   * @param attribute   Index of attribute.
+   * @return  First byte of the value for slot 1.
+   */
+  const char* column(const std::size_t attribute) const {
+    assert(attribute < numAttributes());
+    return &page_->data_[page_->paxAttributes()[attribute].offset];
+  }
+
+  /**
+   * Returns the minipage of the given attribute as an array of T, which must
+   * be as wide as the attribute.  Minipages are aligned to 8 bytes.
+   *
+   * @param attribute   Index of attribute.
+   * @return  Value for slot 1; slot n is at index n - 1.
+   */
+  template <typename T>
+  const T* columnAs(const std::size_t attribute) const {
+    assert(sizeof(T) == attributeWidth(attribute));
+    return reinterpret_cast<const T*>(column(attribute));
+  }
+
+  /**
+   * Returns true if the given slot holds a record.
+   *
+   * @param slot_number   Number of slot, from 1 to capacity().
+   */
+  bool isUsed(const SlotId slot_number) const {
+    return page_->fixedSlotUsed(slot_number);
+  }
+
+  /**
+   * Returns the next used slot after the given slot, or Page::INVALID_SLOT if
+   * there is none.  Start at Page::INVALID_SLOT for the first used slot.
+   *
+   * @param start   Slot to start search at.
+   * @return  Next used slot after given slot or Page::INVALID_SLOT.
+   */
+  SlotId nextUsedSlot(const SlotId start) const {
+    return page_->fixedNextUsedSlot(start, capacity());
+  }
+
+ private:
+  /**
+   * Page being accessed.
+   */
+  Page* page_;
+};
+
+}
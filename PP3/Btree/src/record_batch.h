@@ -0,0 +1,261 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include "page.h"
+#include "scan_predicate.h"
+#include "types.h"
+
+namespace badgerdb {
+
+class FileScan;
+
+/**
+ * @brief Rows returned by FileScan::scanNextBatch(), as arrays: one of
+ *        record IDs, one of record views, and one per requested column.
+ *
+ * A column is a fixed-width attribute at a fixed offset of every record.
+ * Its values are copied into a contiguous array as the batch is filled, so
+ * that filters and aggregates over it can run a tight loop without touching
+ * the records again.  A record too short to hold an attribute has zeros for
+ * it.
+ *
+ * Views point into the scan's pinned page (or, for a PAX page, into the
+ * batch), so they are only valid until the scan moves on.  The batch's
+ * arrays are reused from one batch to the next, so steady-state scans do no
+ * allocation.
+ *
+ * @warning This class is not threadsafe.
+ */
+class RecordBatch {
+ public:
+  /**
+   * Constructs an empty batch with no columns.
+   */
+  RecordBatch()
+      : size_(0) {
+  }
+
+  /**
+   * Adds a column to extract from every record.  Call before filling the
+   * batch.
+   *
+   * @param offset  Offset of the attribute in the record.
+   * @param width   Width of the attribute in bytes.
+   * @return  Index of the column.
+   */
+  std::size_t addColumn(const std::size_t offset, const std::size_t width) {
+    assert(width > 0 && size_ == 0);
+    Column column;
+    column.offset = offset;
+    column.width = width;
+    columns_.push_back(column);
+    return columns_.size() - 1;
+  }
+
+  /**
+   * Returns the number of rows in the batch.
+   */
+  std::size_t size() const { return size_; }
+
+  /**
+   * Returns true if the batch has no rows.
+   */
+  bool empty() const { return size_ == 0; }
+
+  /**
+   * Returns the record IDs of the rows, as FileScan::scanNext() would.
+   */
+  const RecordId* recordIds() const { return rids_.data(); }
+
+  /**
+   * Returns views of the records of the rows.
+   */
+  const RecordView* records() const { return records_.data(); }
+
+  /**
+   * Returns the number of columns.
+   */
+  std::size_t numColumns() const { return columns_.size(); }
+
+  /**
+   * Returns the values of a column, the given column's width bytes per row.
+   *
+   * @param column  Index of column.
+   * @return  First byte of the value for the first row.
+   */
+  const char* column(const std::size_t column) const {
+    assert(column < columns_.size());
+    return columns_[column].values.data();
+  }
+
+  /**
+   * Returns the values of a column as an array of T, which must be as wide
+   * as the column.
+   *
+   * @param column  Index of column.
+   * @return  Value for the first row.
+   */
+  template <typename T>
+  const T* columnAs(const std::size_t column) const {
+    assert(column < columns_.size() && sizeof(T) == columns_[column].width);
+    return reinterpret_cast<const T*>(columns_[column].values.data());
+  }
+
+ private:
+  /**
+   * @brief Column of a batch.
+   */
+  struct Column {
+    std::size_t offset;
+    std::size_t width;
+
+    /**
+     * Values for the rows.  The array is allocated with operator new, so it
+     * is aligned for any numeric type.
+     */
+    std::vector<char> values;
+  };
+
+  /**
+   * Empties the batch, keeping its columns, and makes room for <max_rows>
+   * rows.
+   *
+   * @param max_rows  Number of rows the batch will be filled with at most.
+   */
+  void reset(const std::size_t max_rows) {
+    size_ = 0;
+    if (rids_.size() < max_rows) {
+      rids_.resize(max_rows);
+      records_.resize(max_rows);
+    }
+    copies_.clear();
+    copy_offsets_.clear();
+  }
+
+  /**
+   * Adds a row.
+   *
+   * @param record_id   ID of the record.
+   * @param record      The record.
+   * @param copy        Whether the view is about to be invalidated, so the
+   *                    record must be copied into the batch.
+   */
+  void append(const RecordId& record_id, const RecordView& record,
+              const bool copy) {
+    rids_[size_] = record_id;
+    if (copy) {
+      copy_offsets_.push_back(size_);
+      records_[size_] = RecordView(NULL, copies_.size());
+      copies_.insert(copies_.end(), record.begin(), record.end());
+    } else {
+      records_[size_] = record;
+    }
+    ++size_;
+  }
+
+  /**
+   * Adds rows for the records in the used slots of <page> after slot
+   * <start>, in slot order, until the batch holds <max_rows> rows or the page
+   * has no more records, leaving out records <predicate> rejects.  Views and
+   * record IDs are filled straight into the batch's arrays, so the views point
+   * into the page and are only valid while it stays pinned.
+   *
+   * @param page        Page to take the records from; not a PAX page.
+   * @param start       Slot of the last record of the page already seen.
+   * @param max_rows    Number of rows to fill the batch up to, at most the
+   *                    number reset() made room for.
+   * @param predicate   Records to keep; an empty predicate keeps them all.
+   * @return  Slot of the last record seen, or Page::INVALID_SLOT if the page
+   *          has no more records.
+   */
+  SlotId appendFromPage(const Page& page, const SlotId start,
+                        const std::size_t max_rows,
+                        const ScanPredicate& predicate) {
+    assert(max_rows <= rids_.size());
+    SlotId last_slot = start;
+    while (size_ < max_rows && last_slot != Page::INVALID_SLOT) {
+      RecordId* rids = &rids_[size_];
+      RecordView* records = &records_[size_];
+      std::size_t count = page.getRecordViews(last_slot, max_rows - size_,
+                                              rids, records, last_slot);
+      if (!predicate.empty()) {
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+          if (predicate.matches(records[i])) {
+            rids[kept] = rids[i];
+            records[kept] = records[i];
+            ++kept;
+          }
+        }
+        count = kept;
+      }
+      size_ += count;
+    }
+    return last_slot;
+  }
+
+  /**
+   * Points the views of copied rows at their copies and extracts the
+   * columns, once no more rows will be added.
+   */
+  void finish() {
+    for (std::size_t i = 0; i < copy_offsets_.size(); ++i) {
+      RecordView& view = records_[copy_offsets_[i]];
+      const std::size_t start = view.size();
+      const std::size_t end = i + 1 < copy_offsets_.size()
+          ? records_[copy_offsets_[i + 1]].size() : copies_.size();
+      view = RecordView(copies_.data() + start, end - start);
+    }
+
+    // a column at a time, so each is one tight loop
+    for (std::size_t i = 0; i < columns_.size(); ++i) {
+      Column& column = columns_[i];
+      column.values.resize(size_ * column.width);
+      char* value = column.values.data();
+      for (std::size_t row = 0; row < size_; ++row, value += column.width) {
+        const RecordView& record = records_[row];
+        if (record.size() >= column.offset + column.width) {
+          std::memcpy(value, record.data() + column.offset, column.width);
+        } else {
+          std::memset(value, 0, column.width);
+        }
+      }
+    }
+  }
+
+  /**
+   * Number of rows.  The arrays below are longer, so that appendFromPage()
+   * can fill them in place.
+   */
+  std::size_t size_;
+
+  std::vector<RecordId> rids_;
+  std::vector<RecordView> records_;
+  std::vector<Column> columns_;
+
+  /**
+   * Copies of records whose views would not outlive the batch.
+   */
+  std::vector<char> copies_;
+
+  /**
+   * Rows whose records are in copies_.  Until finish(), their views hold the
+   * offset of the copy as their size.
+   */
+  std::vector<std::size_t> copy_offsets_;
+
+  friend class FileScan;
+};
+
+}
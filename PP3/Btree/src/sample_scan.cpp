@@ -0,0 +1,154 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "sample_scan.h"
+
+#include <cmath>
+#include "file_iterator.h"
+#include "exceptions/bad_scan_param_exception.h"
+#include "exceptions/end_of_file_exception.h"
+
+namespace badgerdb {
+
+SampleScan::SampleScan(const std::string &name, BufMgr *bufferMgr,
+                       SampleMode sampleMode, double sampleFraction,
+                       std::uint32_t seed)
+  : random(seed)
+{
+  if (!(sampleFraction > 0 && sampleFraction <= 1))
+  {
+    throw BadScanParamException();
+  }
+  file = new PageFile(name, false);	//dont create new file
+  ownsFile = true;
+  bufMgr = bufferMgr;
+  mode = sampleMode;
+  fraction = sampleFraction;
+  init();
+}
+
+SampleScan::SampleScan(PageFile *sampleFile, BufMgr *bufferMgr,
+                       SampleMode sampleMode, double sampleFraction,
+                       std::uint32_t seed)
+  : random(seed)
+{
+  if (!(sampleFraction > 0 && sampleFraction <= 1))
+  {
+    throw BadScanParamException();
+  }
+  file = sampleFile;
+  ownsFile = false;
+  bufMgr = bufferMgr;
+  mode = sampleMode;
+  fraction = sampleFraction;
+  init();
+}
+
+SampleScan::~SampleScan()
+{
+  if (curPage != NULL)
+  {
+    bufMgr->unPinPage(file, pageNumbers[pageIndex], false);
+    curPage = NULL;
+  }
+  if (ownsFile)
+  {
+    // pages in the buffer pool are keyed by the File object, which is going
+    bufMgr->flushFile(file);
+    delete file;
+  }
+}
+
+void SampleScan::init()
+{
+  curPage = NULL;
+  pageIndex = 0;
+
+  // the directory lists the pages without reading them
+  std::vector<PageId> allPages;
+  for (FileIterator it = file->begin(); it != file->end(); ++it)
+  {
+    allPages.push_back(it.getCurrentPageNo());
+  }
+
+  if (mode == RECORDS)
+  {
+    pageNumbers.swap(allPages);
+    weight = 1 / fraction;
+    return;
+  }
+
+  // choose the pages by selection sampling (Knuth's Algorithm S), which
+  // picks each subset of the size equally likely and yields it in order
+  const std::size_t total = allPages.size();
+  std::size_t wanted =
+      static_cast<std::size_t>(std::floor(total * fraction + 0.5));
+  if (wanted == 0 && total > 0)
+  {
+    wanted = 1;
+  }
+  for (std::size_t i = 0; i < total && pageNumbers.size() < wanted; i++)
+  {
+    if ((total - i) * nextRandom() < wanted - pageNumbers.size())
+    {
+      pageNumbers.push_back(allPages[i]);
+    }
+  }
+  weight = wanted > 0 ? static_cast<double>(total) / wanted : 1;
+}
+
+double SampleScan::nextRandom()
+{
+  return random() / 4294967296.0;
+}
+
+void SampleScan::scanNext(RecordId& outRid)
+{
+  while (true)
+  {
+    if (curPage != NULL)
+    {
+      ++pageRecordIter;
+    }
+    while (curPage == NULL ||
+           pageRecordIter.getCurrentRecord().slot_number == Page::INVALID_SLOT)
+    {
+      // move on to the next sampled page
+      if (curPage != NULL)
+      {
+        bufMgr->unPinPage(file, pageNumbers[pageIndex], false);
+        curPage = NULL;
+        pageIndex++;
+      }
+      if (pageIndex >= pageNumbers.size())
+      {
+        throw EndOfFileException();
+      }
+      bufMgr->readPage(file, pageNumbers[pageIndex], curPage);
+      pageRecordIter = curPage->begin();
+    }
+
+    if (mode == PAGES || nextRandom() < fraction)
+    {
+      outRid = curPage->getHomeRecordId(pageRecordIter.getCurrentRecord());
+      return;
+    }
+  }
+}
+
+// returns a copy of the current record
+std::string SampleScan::getRecord()
+{
+  return getRecordView().toString();
+}
+
+RecordView SampleScan::getRecordView()
+{
+  return *pageRecordIter;
+}
+
+}
@@ -0,0 +1,133 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "types.h"
+#include "page.h"
+#include "buffer.h"
+#include "page_iterator.h"
+
+namespace badgerdb {
+
+/**
+ * @brief This class is used to scan a random sample of the records in a
+ *        relation, e.g. to estimate statistics without a full scan.
+ *
+ * A PAGES sample takes a uniformly random subset of the relation's pages,
+ * of the given fraction of them, and returns every record on them; only the
+ * sampled pages are read.  A RECORDS sample reads every page and keeps each
+ * record independently with the given probability.  Either way pages are
+ * read in file order, and the same seed gives the same sample of an
+ * unchanged relation.
+ *
+ * Every record returned comes with a weight, the inverse of its chance of
+ * being sampled, so that e.g. the sum of the weights estimates the number of
+ * records in the relation.
+ */
+class SampleScan
+{
+ public:
+  /**
+   * Unit of sampling.
+   */
+  enum SampleMode
+  {
+    PAGES,    /* a random subset of the pages, all their records */
+    RECORDS   /* each record with the given probability */
+  };
+
+  /**
+   * Opens a sample of the named relation.  Like a FileScan opened by name,
+   * it flushes the relation from the buffer pool when it ends.
+   *
+   * @param name      Name of the relation's file.
+   * @param bufMgr    Buffer pool to read pages through.
+   * @param mode      Unit of sampling.
+   * @param fraction  Fraction of pages or probability of records to sample,
+   *                  in (0, 1].
+   * @param seed      Seed of the random choices.
+   * @throws  BadScanParamException   If fraction is out of range.
+   */
+  SampleScan(const std::string &name, BufMgr *bufMgr, SampleMode mode,
+             double fraction, std::uint32_t seed);
+
+  //samples <file>, which must stay open until the sample is destroyed, and
+  //leaves its pages cached
+  SampleScan(PageFile *file, BufMgr *bufMgr, SampleMode mode,
+             double fraction, std::uint32_t seed);
+
+  ~SampleScan();
+
+  //return RecordId of next record of the sample.  throws EndOfFileException
+  //at the end of the sample
+  void scanNext(RecordId& outRid);
+
+  //read current record, returning a copy of it
+  std::string getRecord();
+
+  //view current record in place; valid until the scan moves to another page
+  //(on a PAX page, until the next scanNext)
+  RecordView getRecordView();
+
+  //returns the weight of the records returned: how many records of the
+  //relation each stands for
+  double getWeight() const { return weight; }
+
+  //returns the number of pages the sample reads
+  std::size_t numSampledPages() const { return pageNumbers.size(); }
+
+ private:
+  PageFile      *file;
+
+  /**
+   * True if the scan opened file itself, and so must flush and close it.
+   */
+  bool          ownsFile;
+
+	BufMgr				*bufMgr;
+
+  SampleMode    mode;
+  double        fraction;
+  double        weight;
+
+  /**
+   * Random numbers of the sample; std::mt19937 gives the same sequence
+   * everywhere for a seed.
+   */
+  std::mt19937  random;
+
+  /**
+   * Numbers of the pages to read, in file order, and the index of the
+   * current one.
+   */
+  std::vector<PageId> pageNumbers;
+  std::size_t   pageIndex;
+
+  /**
+   * Current page being scanned, or NULL before the first and after the last.
+   */
+  const Page*   curPage;
+
+  PageIterator  pageRecordIter;
+
+  /**
+   * Checks the parameters and chooses the pages to read.
+   */
+  void init();
+
+  /**
+   * Returns a random number in [0, 1).
+   */
+  double nextRandom();
+};
+
+}
@@ -0,0 +1,259 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include "page.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Comparison of an attribute at a fixed offset of a record with a
+ *        constant.
+ */
+struct ScanCondition {
+  /**
+   * Types of attribute.  A STRING attribute has the length of the constant
+   * and is compared byte by byte.
+   */
+  enum Type {
+    INTEGER = 0,
+    DOUBLE = 1,
+    STRING = 2
+  };
+
+  /**
+   * Comparisons of the attribute (on the left) with the constant.
+   */
+  enum Comparison {
+    LT,   /* Less Than */
+    LTE,  /* Less Than or Equal to */
+    EQ,   /* Equal to */
+    NE,   /* Not Equal to */
+    GTE,  /* Greater Than or Equal to */
+    GT    /* Greater Than */
+  };
+
+  /**
+   * Returns a condition on an int attribute.
+   *
+   * @param offset      Offset of the attribute in the record.
+   * @param comparison  Comparison made.
+   * @param value       Constant compared with.
+   */
+  static ScanCondition ofInteger(const std::size_t offset,
+                                 const Comparison comparison,
+                                 const int value) {
+    ScanCondition condition(offset, INTEGER, comparison);
+    condition.int_value = value;
+    return condition;
+  }
+
+  /**
+   * Returns a condition on a double attribute.
+   *
+   * @param offset      Offset of the attribute in the record.
+   * @param comparison  Comparison made.
+   * @param value       Constant compared with.
+   */
+  static ScanCondition ofDouble(const std::size_t offset,
+                                const Comparison comparison,
+                                const double value) {
+    ScanCondition condition(offset, DOUBLE, comparison);
+    condition.double_value = value;
+    return condition;
+  }
+
+  /**
+   * Returns a condition on a string attribute of value.size() bytes.
+   *
+   * @param offset      Offset of the attribute in the record.
+   * @param comparison  Comparison made.
+   * @param value       Constant compared with.
+   */
+  static ScanCondition ofString(const std::size_t offset,
+                                const Comparison comparison,
+                                const std::string& value) {
+    ScanCondition condition(offset, STRING, comparison);
+    condition.string_value = value;
+    return condition;
+  }
+
+  /**
+   * Returns true if the record satisfies the condition.  A record too short
+   * to hold the attribute doesn't.
+   *
+   * @param record  Record to test.
+   */
+  bool matches(const RecordView& record) const {
+    int order;
+    switch (type) {
+      case INTEGER: {
+        if (record.size() < sizeof(int) ||
+            offset > record.size() - sizeof(int)) {
+          return false;
+        }
+        int value;
+        std::memcpy(&value, record.data() + offset, sizeof(value));
+        order = value < int_value ? -1 : (value > int_value ? 1 : 0);
+        break;
+      }
+      case DOUBLE: {
+        if (record.size() < sizeof(double) ||
+            offset > record.size() - sizeof(double)) {
+          return false;
+        }
+        double value;
+        std::memcpy(&value, record.data() + offset, sizeof(value));
+        if (value != value) {
+          return comparison == NE;  // NaN is unordered
+        }
+        order = value < double_value ? -1 : (value > double_value ? 1 : 0);
+        break;
+      }
+      default: {
+        if (record.size() < string_value.size() ||
+            offset > record.size() - string_value.size()) {
+          return false;
+        }
+        order = std::memcmp(record.data() + offset, string_value.data(),
+                            string_value.size());
+        break;
+      }
+    }
+    switch (comparison) {
+      case LT:  return order < 0;
+      case LTE: return order <= 0;
+      case EQ:  return order == 0;
+      case NE:  return order != 0;
+      case GTE: return order >= 0;
+      default:  return order > 0;
+    }
+  }
+
+  /**
+   * Offset of the attribute in the record.
+   */
+  std::size_t offset;
+
+  /**
+   * Type of the attribute.
+   */
+  Type type;
+
+  /**
+   * Comparison made.
+   */
+  Comparison comparison;
+
+  /**
+   * Constant of an INTEGER condition.
+   */
+  int int_value;
+
+  /**
+   * Constant of a DOUBLE condition.
+   */
+  double double_value;
+
+  /**
+   * Constant of a STRING condition.
+   */
+  std::string string_value;
+
+ private:
+  ScanCondition(const std::size_t offset, const Type type,
+                const Comparison comparison)
+      : offset(offset),
+        type(type),
+        comparison(comparison),
+        int_value(0),
+        double_value(0) {
+  }
+};
+
+/**
+ * @brief Conjunction of conditions on records, evaluated by FileScan
+ *        against the record bytes in the pinned page.
+ *
+ * Records failing the predicate are skipped by the scan without being
+ * copied out of the buffer pool.  Conditions on attributes at fixed offsets
+ * are checked first, then any filters, which are arbitrary callables over a
+ * view of the record.  An empty predicate accepts every record.
+ */
+class ScanPredicate {
+ public:
+  /**
+   * Callable returning true for records to keep.
+   */
+  typedef std::function<bool(const RecordView&)> Filter;
+
+  /**
+   * Adds a condition which records must also satisfy.
+   *
+   * @param condition   Condition to add.
+   * @return  This predicate.
+   */
+  ScanPredicate& add(const ScanCondition& condition) {
+    conditions_.push_back(condition);
+    return *this;
+  }
+
+  /**
+   * Adds a filter which records must also pass.
+   *
+   * @param filter  Filter to add.
+   * @return  This predicate.
+   */
+  ScanPredicate& add(const Filter& filter) {
+    filters_.push_back(filter);
+    return *this;
+  }
+
+  /**
+   * Returns true if the predicate accepts every record.
+   */
+  bool empty() const { return conditions_.empty() && filters_.empty(); }
+
+  /**
+   * Returns true if the record satisfies every condition and passes every
+   * filter.
+   *
+   * @param record  Record to test.
+   */
+  bool matches(const RecordView& record) const {
+    for (std::size_t i = 0; i < conditions_.size(); ++i) {
+      if (!conditions_[i].matches(record)) {
+        return false;
+      }
+    }
+    for (std::size_t i = 0; i < filters_.size(); ++i) {
+      if (!filters_[i](record)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  /**
+   * Conditions on attributes.
+   */
+  std::vector<ScanCondition> conditions_;
+
+  /**
+   * Filters over whole records.
+   */
+  std::vector<Filter> filters_;
+};
+
+}